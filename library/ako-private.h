@@ -17,8 +17,26 @@
 #endif
 // clang-format on
 
+// Static probes (USDT), provider 'ako', for bpftrace or perf to attach to any build
+// without it calling anything. Each is a 'nop' plus an ELF note, see 'AKO_PROBES'
+#if (AKO_PROBES == 1) && (AKO_FREESTANDING == 0)
+#include <sys/sdt.h>
+#define AKO_PROBE4(name, a, b, c, d) DTRACE_PROBE4(ako, name, a, b, c, d)
+#define AKO_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(ako, name, a, b, c, d, e)
+#endif
+
+// clang-format off
+#ifndef AKO_PROBE4
+#define AKO_PROBE4(name, a, b, c, d) {}    // Whitespace
+#define AKO_PROBE5(name, a, b, c, d, e) {} // Ditto
+#endif
+// clang-format on
+
 #define AKO_DEV_NOISE 10
 
+#define AKO_BATCH_TILES 16         // Tiny tiles lift together, in batches of this size
+#define AKO_BATCH_MAX_DIMENSION 32 // If both dimensions are equal or under this
+
 
 #define AKO_EXPORT __attribute__((visibility("default")))
 
@@ -32,11 +50,35 @@ struct akoLiftHead
 	int16_t quantization;
 };
 
+struct akoBlockHead
+{
+	uint32_t block_size;
+};
+
+struct akoTileHead
+{
+	uint32_t wavelet; // Overrides the one in the image head
+};
+
+struct akoSignalBlockHead
+{
+	uint32_t size;        // Of what follows, in bytes
+	uint32_t compression; // AKO_COMPRESSION_NONE for samples as they are, not lifted
+};
+
+// bcn.c:
+
+void akoFormatToBcn(enum akoBcn, size_t channels, size_t tile_x, size_t tile_y, size_t tile_w, size_t tile_h,
+                    size_t image_w, const uint8_t* in, uint8_t* out);
+
 // compression.c:
 
-size_t akoCompress(enum akoCompression, size_t channels, size_t tile_w, size_t tile_h, coeff_t* input, void* output);
-size_t akoDecompress(enum akoCompression, size_t decompressed_size, size_t output_size, const void* input,
-                     void* output);
+size_t akoCompress(enum akoCompression, size_t code_blocks, size_t channels, size_t tile_w, size_t tile_h,
+                   coeff_t* input, void* output); // Output takes up to a tile plus a block head (if stored)
+size_t akoDecompress(enum akoCompression, size_t code_blocks, size_t channels, size_t tile_w, size_t tile_h,
+                     size_t decompressed_size, size_t output_size, size_t input_size, const void* input, void* output);
+size_t akoCompressedSize(enum akoCompression, size_t code_blocks, size_t channels, size_t tile_w, size_t tile_h,
+                         size_t input_size, const void* input); // Walks block heads, without decompressing
 
 // developer.c:
 
@@ -50,11 +92,26 @@ void akoFormatToInterleavedU8Rgb(enum akoColor, size_t channels, size_t width, s
                                  size_t out_stride, int16_t* in,
                                  uint8_t* out); // Destroys 'in'
 
+void akoFormatYuv420ToPlanarI16(enum akoYuvLayout, size_t tile_x, size_t tile_y, size_t width, size_t height,
+                                size_t image_w, size_t image_h, size_t out_planes_spacing, const uint8_t* in,
+                                int16_t* out);
+void akoFormatToYuv420(enum akoYuvLayout, size_t tile_x, size_t tile_y, size_t width, size_t height, size_t image_w,
+                       size_t image_h, size_t in_planes_spacing, const int16_t* in, uint8_t* out);
+
 // head.c:
 
-enum akoStatus akoHeadWrite(size_t channels, size_t image_w, size_t image_h, const struct akoSettings*, void* out);
+enum akoStatus akoHeadWrite(size_t channels, size_t image_w, size_t image_h, const struct akoSettings*,
+                            int tiles_heads, int subsampled_chroma, void* out);
 enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_image_w, size_t* out_image_h,
-                           struct akoSettings* out_s);
+                           struct akoSettings* out_s, int* out_tiles_heads, int* out_subsampled_chroma);
+
+enum akoStatus akoSignalHeadWrite(size_t length, const struct akoSettings*, void* out);
+enum akoStatus akoSignalHeadRead(const void* in, size_t* out_length, struct akoSettings* out_s);
+
+enum akoStatus akoVolumeHeadWrite(size_t channels, size_t width, size_t height, size_t depth, size_t bricks_depth,
+                                  const struct akoSettings*, void* out);
+enum akoStatus akoVolumeHeadRead(const void* in, size_t* out_channels, size_t* out_width, size_t* out_height,
+                                 size_t* out_depth, size_t* out_bricks_depth, struct akoSettings* out_s);
 
 // kagari.c
 
@@ -76,24 +133,53 @@ uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, con
 size_t akoKagariEncode(size_t input_size, size_t output_size, const void* input, void* output);
 size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const void* input, void* output);
 
+size_t akoKagariEncode2d(size_t width, size_t height, size_t stride, size_t output_size, const int16_t* input,
+                         void* output); // Rectangles inside planes of 'stride' width
+size_t akoKagariDecode2d(size_t width, size_t height, size_t stride, size_t input_size, const void* input,
+                         int16_t* output);
+
 // lifting.c
 
 void akoLift(size_t tile_no, const struct akoSettings*, size_t channels, size_t tile_w, size_t tile_h,
-             size_t planes_space, int16_t* in, int16_t* output);
+             size_t planes_space, int subsampled_chroma, size_t batch, int16_t* in, int16_t* output);
 void akoUnlift(const struct akoSettings* s, size_t channels, size_t tile_no, size_t tile_w, size_t tile_h,
-               size_t out_planes_space, coeff_t* input, coeff_t* out);
+               size_t out_planes_space, int subsampled_chroma, coeff_t* input, coeff_t* out,
+               void (*level_callback)(size_t w, size_t h, size_t planes_spacing, coeff_t* planes, void* user_data),
+               void* level_data); // Callback sees every lowpass under the tile, coarsest first
 
 // misc.c:
 
+struct akoCallbacks akoCallbacksOrDefault(const struct akoCallbacks* c);
+int akoCallbacksCanAllocate(const struct akoCallbacks* c);
+
 size_t akoDividePlusOneRule(size_t x);
+size_t akoDownscaledDimension(size_t d, int levels);
 size_t akoPlanesSpacing(size_t tile_w, size_t tile_h);
 
 size_t akoTileDataSize(size_t tile_w, size_t tile_h);
 size_t akoTileDimension(size_t tile_pos, size_t image_d, size_t tiles_dimension);
 
-size_t akoImageTilesNo(size_t image_w, size_t image_h, size_t tiles_dimension);
-size_t akoImageMaxTileDataSize(size_t image_w, size_t image_h, size_t tiles_dimension);
-size_t akoImageMaxPlanesSpacingSize(size_t image_w, size_t image_h, size_t tiles_dimension);
+size_t akoImageTilesNo(size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h);
+size_t akoImageMaxTileDataSize(size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h);
+size_t akoImageMaxPlanesSpacingSize(size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h);
+size_t akoTilesHeight(const struct akoSettings*);
+
+struct akoTilesIterator
+{
+	enum akoOrder order;
+	size_t tiles_w;
+	size_t tiles_h;
+	size_t cols;
+	size_t rows;
+	size_t col;
+	size_t row;
+	size_t code; // Morton
+	unsigned square_bits;
+};
+
+void akoTilesIteratorInit(enum akoOrder, size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h,
+                          struct akoTilesIterator* out);
+void akoTilesIteratorNext(struct akoTilesIterator*, size_t* out_tile_x, size_t* out_tile_y); // In pixels
 
 void* akoIterateLifts(const struct akoSettings* s, size_t channels, size_t tile_w, size_t tile_h, void* input,
                       void (*lp_callback)(const struct akoSettings*, size_t ch, size_t tile_w, size_t tile_h,
@@ -109,6 +195,32 @@ void* akoIterateLifts(const struct akoSettings* s, size_t channels, size_t tile_
 int16_t akoGate(int factor, int factor_mul, size_t tile_w, size_t tile_h, size_t current_w, size_t current_h);
 int16_t akoQuantization(int factor, int factor_mul, size_t tile_w, size_t tile_h, size_t current_w, size_t current_h);
 
+double akoQuantizeTile(const struct akoSettings*, int factor, int apply, size_t channels, size_t tile_w, size_t tile_h,
+                       coeff_t* inout);
+int akoTargetQuantization(const struct akoSettings*, size_t tile_no, size_t channels, size_t tile_w, size_t tile_h,
+                          size_t planes_spacing, size_t reference_stride, const uint8_t* reference, coeff_t* lossless,
+                          coeff_t* scratch_a, coeff_t* scratch_b); // Without 'reference' (or scratch) only estimates
+
+// stats.c:
+
+uint64_t akoStatsClock(const struct akoStats* enabled);
+void akoStatsAdd(struct akoStats* shared, const struct akoStats* local);
+
+// summary.c:
+
+#define AKO_SUMMARY_GRID 8 // For fingerprints, 8x8 = 64 bits
+
+struct akoSummaryGrid
+{
+	uint64_t sum[AKO_SUMMARY_GRID * AKO_SUMMARY_GRID];
+};
+
+void akoSummaryStart(struct akoSummaryGrid*, struct akoSummary* out);
+void akoSummaryTile(size_t channels, size_t tile_x, size_t tile_y, size_t tile_w, size_t tile_h, size_t image_w,
+                    size_t image_h, const uint8_t* in, struct akoSummaryGrid*, struct akoSummary* out);
+void akoSummaryFinish(size_t channels, size_t image_w, size_t image_h, const struct akoSummaryGrid*,
+                      struct akoSummary* out);
+
 // wavelet-cdf53.c:
 
 void akoCdf53LiftH(enum akoWrap, size_t current_h, size_t target_w, size_t fake_last, size_t in_stride,
@@ -9,13 +9,16 @@
 #define AKO_VERSION_MINOR 2
 #define AKO_VERSION_PATCH 0
 
-#define AKO_FORMAT_VERSION 2
+#define AKO_FORMAT_VERSION 3
+#define AKO_SIGNAL_FORMAT_VERSION 1
+#define AKO_VOLUME_FORMAT_VERSION 1
 
 #define AKO_MAX_CHANNELS 16
 #define AKO_MAX_WIDTH 4294967295
 #define AKO_MAX_HEIGHT 4294967295
 #define AKO_MIN_TILES_DIMENSION 8
 #define AKO_MAX_TILES_DIMENSION 2147483648
+#define AKO_MAX_CODE_BLOCKS_DIMENSION 131072
 
 
 enum akoStatus
@@ -38,6 +41,10 @@ enum akoStatus
 	AKO_NO_ENOUGH_MEMORY,
 	AKO_INVALID_FLAGS,
 	AKO_BROKEN_INPUT,
+	AKO_LIMITS_EXCEEDED,
+	AKO_OUTPUT_LIMIT_EXCEEDED,
+	AKO_INCOMPATIBLE_INPUTS,
+	AKO_INVALID_TILES_ORDER,
 };
 
 enum akoWavelet
@@ -72,6 +79,25 @@ enum akoCompression
 	AKO_COMPRESSION_NONE,
 };
 
+enum akoOrder
+{
+	AKO_ORDER_RASTER = 0,
+	AKO_ORDER_MORTON, // Tiles in Z-order, a 2x2 group of tiles, then the next group, etc.
+};
+
+enum akoYuvLayout
+{
+	AKO_YUV_I420 = 0, // Y plane, then U and V planes at half width and height
+	AKO_YUV_NV12,     // Y plane, then U and V interleaved in a single plane at half width and height
+};
+
+enum akoBcn
+{
+	AKO_BC1 = 0, // 8 bytes per 4x4 block, Rgb (gray goes to all three)
+	AKO_BC3,     // 16 bytes per block, Rgb plus alpha (last channel if two or four, opaque otherwise)
+	AKO_BC4,     // 8 bytes per block, first channel alone
+};
+
 enum akoEvent
 {
 	AKO_EVENT_NONE = 0,
@@ -89,13 +115,51 @@ struct akoSettings
 	enum akoColor color;
 	enum akoWrap wrap;
 	enum akoCompression compression;
-	size_t tiles_dimension;
+	size_t tiles_dimension; // 0 = No tiles
+	size_t tiles_height;    // 0 = Same as 'tiles_dimension'. With no tiles dimension, tiles span the image width
+	enum akoOrder order;    // In which tiles are processed and stored
+	size_t code_blocks;     // 0 = One compressed stream per tile, otherwise wavelet planes are divided in
+	                        // independent streams of this dimension (a power of two from 8)
 
 	int quantization;
 	int gate;
 
 	int chroma_loss;
 	int discard_non_visible;
+
+	int downscale; // Encode only, finest wavelet levels to drop. Output is half the size per level
+
+	float target_psnr; // Encode only, in decibels (0 = disabled). Replaces 'quantization' with the largest one
+	                   // that, per tile, keeps the Psnr at or above this value. Only estimated (around a decibel
+	                   // off) for Yuv inputs and downscales. Targets past the lossless one give lossless tiles
+};
+
+struct akoStats
+{
+	// Accumulated by the library, never reset. Every call adds its numbers once
+	// at the end with atomic additions, so many threads can share one instance
+	uint64_t encodes;
+	uint64_t decodes;
+	uint64_t failures;
+
+	uint64_t tiles;
+	uint64_t pixels;
+	uint64_t image_bytes; // Uncompressed, read by encoders or written by decoders
+	uint64_t blob_bytes;  // Compressed, written by encoders or read by decoders
+
+	uint64_t format_ns; // Stage times, always zero in freestanding builds
+	uint64_t wavelet_ns;
+	uint64_t compression_ns; // Includes copying tiles from or to the blob (even uncompressed)
+};
+
+struct akoSummary
+{
+	// Side outputs of akoEncodeExt(), from input pixels while tiles get encoded
+	uint64_t histogram[AKO_MAX_CHANNELS][256]; // Per channel
+	uint8_t average[AKO_MAX_CHANNELS];         // Ditto, rounded
+
+	uint64_t fingerprint; // Average hash, a bit per cell of an 8x8 grid (first bit top left), set if the cell
+	                      // is brighter than the whole image. Similar images differ in few bits
 };
 
 struct akoCallbacks
@@ -106,12 +170,42 @@ struct akoCallbacks
 
 	void (*events)(size_t, size_t, enum akoEvent, void*);
 	void* events_data;
+
+	// Decoder limits, checked before any allocation (0 = no limit)
+	size_t max_pixels;
+	size_t max_tiles;
+	size_t max_memory; // In bytes, accounts for workareas and output image
+
+	// Encoder limit, in bytes (0 = no limit). Encoding stops at the first tile that
+	// exceeds it, returning zero with an AKO_OUTPUT_LIMIT_EXCEEDED status
+	size_t max_output_size;
+
+	// Encoder time budget, in milliseconds (0 = no budget). Measuring throughput as it
+	// goes, remaining tiles switch to cheaper wavelets (CDF53, then Haar) whenever the
+	// budget is at risk, and back when not. Tiles record the wavelet they use. Best
+	// effort, the budget can't be met if Haar is too slow already. No effect in
+	// freestanding builds, nor with AKO_WAVELET_NONE
+	float time_budget;
+
+	// Caller provided memory, if not NULL all allocations happen here and above three
+	// callbacks are never called. Required size is given by akoEncodeWorkareaSize() and
+	// akoDecodeWorkareaSize(). Outputs point inside it, so don't free them
+	void* workarea;
+	size_t workarea_size;
+
+	// If not NULL, lock-free statistics. Unlike 'events' it can be shared between
+	// threads, read it with akoStatsRead() while others are still running
+	struct akoStats* stats;
+
+	// If not NULL, akoEncodeExt() fills it, saving callers passes over the image
+	// to compute these. Complete only when encoding succeeds, Yuv encoders ignore it
+	struct akoSummary* summary;
 };
 
 struct akoHead
 {
 	uint8_t magic[3]; // "Ako"
-	uint8_t version;  // 2 (AKO_FORMAT_VERSION)
+	uint8_t version;  // 3 (AKO_FORMAT_VERSION), 2 is also read
 
 	uint32_t width;  // 0 = Invalid
 	uint32_t height; // Ditto
@@ -123,7 +217,42 @@ struct akoHead
 	// bits 8-9   : Color,           0 = YCOCG, 1 = Subtract Green, 2 = None, 3 = Internal
 	// bits 10-11 : Compression,     0 = Elias Coding, 1 = rAns, 2 = No compression
 	// bits 12-16 : Tiles dimension, 0 = No tiles, 1 = 8x8, 2 = 16x16, 3 = 32x32, 4 = 64x64, etc...
-	// bits 17-32 : Unused bits (always zero)
+	// bits 17-21 : Tiles height,    0 = Same as dimension, 1 = 8, 2 = 16, 3 = 32, etc... (version 3)
+	// bits 22    : Tiles order,     0 = Raster, 1 = Morton (version 3)
+	// bits 23-26 : Code-blocks,     0 = One stream per tile, 1 = 8x8, 2 = 16x16, etc... (version 3)
+	// bits 27    : Tiles heads,     0 = No, 1 = Tiles start with an akoTileHead (version 3)
+	// bits 28    : Chroma,          0 = Full resolution, 1 = Yuv 4:2:0, finest chroma highpasses are zero (version 3)
+	// bits 29-32 : Unused bits (always zero)
+};
+
+struct akoSignalHead
+{
+	uint8_t magic[3]; // "AkS"
+	uint8_t version;  // 1 (AKO_SIGNAL_FORMAT_VERSION)
+
+	uint32_t flags;
+	// bits 0-1   : Wrap,            0 = Clamp, 1 = Mirror, 2 = Repeat, 3 = Zero
+	// bits 2-3   : Wavelet,         0 = DD137, 1 = CDF53, 2 = Haar, 3 = None
+	// bits 4-5   : Compression,     0 = Elias Coding, 1 = rAns, 2 = No compression
+	// bits 6-10  : Blocks length,   0 = One block, 1 = 8, 2 = 16, 3 = 32, etc...
+	// bits 11-32 : Unused bits (always zero)
+
+	uint64_t length; // In samples, 0 = Invalid
+};
+
+struct akoVolumeHead
+{
+	uint8_t magic[3]; // "AkV"
+	uint8_t version;  // 1 (AKO_VOLUME_FORMAT_VERSION)
+
+	uint32_t width;  // 0 = Invalid
+	uint32_t height; // Ditto
+	uint32_t depth;  // Ditto, in slices
+
+	uint32_t flags;
+	// bits 0-21  : As in akoHead (channels, wrap, wavelet, color, compression and tiles dimensions)
+	// bits 22-26 : Bricks depth,    0 = All slices, 1 = 2, 2 = 4, 3 = 8, 4 = 16, etc...
+	// bits 27-32 : Unused bits (always zero)
 };
 
 
@@ -132,12 +261,93 @@ size_t akoEncodeExt(const struct akoCallbacks*, const struct akoSettings*, size_
 uint8_t* akoDecodeExt(const struct akoCallbacks*, size_t input_size, const void* in, struct akoSettings* out_s,
                       size_t* out_channels, size_t* out_w, size_t* out_h, enum akoStatus* out_status);
 
+// Yuv 4:2:0 frames, as cameras and video decoders give them. Chroma is lifted from
+// its native resolution, no color transformation involved. Decoding these files
+// with akoDecodeExt() gives three channels of Yuv at full resolution
+size_t akoEncodeYuv420Ext(const struct akoCallbacks*, const struct akoSettings*, enum akoYuvLayout, size_t image_w,
+                          size_t image_h, const void* in, void** out, enum akoStatus* out_status);
+uint8_t* akoDecodeYuv420Ext(const struct akoCallbacks*, size_t input_size, const void* in, enum akoYuvLayout,
+                            struct akoSettings* out_s, size_t* out_w, size_t* out_h, enum akoStatus* out_status);
+
+// Gpu textures, each tile goes into 4x4 blocks once decoded, while still in cache, rather
+// than in a second pass over the image. Blocks are in rows, left to right, as graphic
+// APIs take them, their size given by akoBcnSize(). Not available with a workarea
+uint8_t* akoDecodeBcnExt(const struct akoCallbacks*, size_t input_size, const void* in, enum akoBcn,
+                         struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                         enum akoStatus* out_status);
+size_t akoBcnSize(enum akoBcn, size_t image_w, size_t image_h); // In bytes, 0 if not a valid format
+
+// Image followed by 'levels' versions of it, each half the size of the previous one (rounding
+// up), as tiled viewers want them. None past one pixel, so a large value gives all of them.
+// Levels come from lowpasses that decoding produces anyway, those too coarse for a tile to
+// have are box filtered. Not available with a workarea
+uint8_t* akoDecodePyramidExt(const struct akoCallbacks*, size_t input_size, const void* in, size_t levels,
+                             struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                             enum akoStatus* out_status);
+size_t akoPyramidLevel(size_t channels, size_t image_w, size_t image_h, size_t level, size_t* out_w,
+                       size_t* out_h); // Offset of a level in above output, in bytes
+
+// Tiles that differ between two files, found comparing their compressed bytes
+// without decoding anything. Both should come from images of the same dimensions
+// encoded with the same tiles settings. Output lists changed tiles, may be none
+// of them, in file order. Not available with a workarea
+struct akoTileRect
+{
+	size_t x;
+	size_t y;
+	size_t width;
+	size_t height;
+};
+
+struct akoTileRect* akoDiffExt(const struct akoCallbacks*, size_t a_size, const void* a, size_t b_size, const void* b,
+                               size_t* out_changed_no, size_t* out_tiles_no, enum akoStatus* out_status);
+
+// One dimensional signals, as int16 telemetry or audio. Always lossless. Samples go
+// in blocks of 'tiles_dimension' length (0 = a single block, of up to 2^31 - 1
+// samples), each lifted with 'wavelet' and compressed on its own. Decoding a range
+// only touches blocks under it, others are skipped by their size. Other settings
+// are ignored. Decoding limits treat samples as pixels. Not available with a workarea
+size_t akoEncodeSignalExt(const struct akoCallbacks*, const struct akoSettings*, size_t length, const int16_t* in,
+                          void** out, enum akoStatus* out_status);
+int16_t* akoDecodeSignalExt(const struct akoCallbacks*, size_t input_size, const void* in, size_t from,
+                            size_t length, struct akoSettings* out_s, size_t* out_length, size_t* out_total_length,
+                            enum akoStatus* out_status); // A 'length' of 0 decodes until the end
+
+// Volumes, as CT or MRI stacks: 'depth' slices of 'image_w' by 'image_h' voxels, one after
+// the other. Slices go in bricks of 'bricks_depth' (a power of two, 0 = all of them) by a
+// tile, lifted along slices then as images are, and compressed together. Bricks decode on
+// their own, so reading a sub-volume only touches those under it. Wavelet can't be none,
+// tiles order, code-blocks, downscale and Psnr targets are ignored. Decoding limits treat
+// voxels as pixels. Not available with a workarea
+struct akoBox
+{
+	size_t x;
+	size_t y;
+	size_t z;
+	size_t width; // 0 = Until the end, also for below two
+	size_t height;
+	size_t depth;
+};
+
+size_t akoEncodeVolumeExt(const struct akoCallbacks*, const struct akoSettings*, size_t bricks_depth, size_t channels,
+                          size_t image_w, size_t image_h, size_t depth, const void* in, void** out,
+                          enum akoStatus* out_status);
+uint8_t* akoDecodeVolumeExt(const struct akoCallbacks*, size_t input_size, const void* in, const struct akoBox* box,
+                            struct akoSettings* out_s, size_t* out_channels, struct akoBox* out_box,
+                            enum akoStatus* out_status); // NULL 'box' for everything, 'out_box' gives what was decoded
+
+size_t akoEncodeWorkareaSize(const struct akoSettings*, size_t channels, size_t image_w, size_t image_h);
+size_t akoDecodeWorkareaSize(const struct akoCallbacks*, size_t input_size, const void* in, enum akoStatus* out_status);
+
 struct akoSettings akoDefaultSettings();
-struct akoCallbacks akoDefaultCallbacks();
-void akoDefaultFree(void*);
+struct akoCallbacks akoDefaultCallbacks(); // Not in freestanding builds (AKO_FREESTANDING)
+void akoDefaultFree(void*);                // Ditto
 
 const char* akoStatusString(enum akoStatus);
 
+void akoStatsRead(const struct akoStats*, struct akoStats* out);
+void akoStatsReset(struct akoStats*);
+
 int akoVersionMajor();
 int akoVersionMinor();
 int akoVersionPatch();
@@ -0,0 +1,250 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ako-private.h"
+
+
+// Fast and simple: endpoints are the bounding box of a block, a bit inset to
+// reduce the error of extremes, then pixels take the nearest palette entry. No
+// endpoints refinement, what here matters is that it happens while tiles are
+// still in cache.
+
+
+static inline uint16_t sTo565(const int* rgb)
+{
+	return (uint16_t)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+}
+
+
+static inline void sFrom565(uint16_t c, int* out_rgb)
+{
+	const int r = (c >> 11) & 31;
+	const int g = (c >> 5) & 63;
+	const int b = c & 31;
+
+	out_rgb[0] = (r << 3) | (r >> 2);
+	out_rgb[1] = (g << 2) | (g >> 4);
+	out_rgb[2] = (b << 3) | (b >> 2);
+}
+
+
+static void sColorBlock(const uint8_t* rgb, uint8_t* out)
+{
+	int min[3] = {255, 255, 255};
+	int max[3] = {0, 0, 0};
+
+	for (size_t i = 0; i < 16; i++)
+	{
+		for (size_t c = 0; c < 3; c++)
+		{
+			min[c] = (rgb[i * 3 + c] < min[c]) ? rgb[i * 3 + c] : min[c];
+			max[c] = (rgb[i * 3 + c] > max[c]) ? rgb[i * 3 + c] : max[c];
+		}
+	}
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		const int inset = (max[c] - min[c]) >> 4;
+		min[c] += inset;
+		max[c] -= inset;
+	}
+
+	// Above box diagonal follows green, where red or blue go against it
+	// flip them (otherwise colors in between come out grayish)
+	{
+		int mean[3] = {0, 0, 0};
+		for (size_t i = 0; i < 16; i++)
+			for (size_t c = 0; c < 3; c++)
+				mean[c] += rgb[i * 3 + c];
+
+		for (size_t c = 0; c < 3; c += 2)
+		{
+			int covariance = 0;
+			for (size_t i = 0; i < 16; i++)
+				covariance += (rgb[i * 3 + c] * 16 - mean[c]) * (rgb[i * 3 + 1] * 16 - mean[1]) / 16;
+
+			if (covariance < 0)
+			{
+				const int temp = min[c];
+				min[c] = max[c];
+				max[c] = temp;
+			}
+		}
+	}
+
+	uint16_t c0 = sTo565(max);
+	uint16_t c1 = sTo565(min);
+	uint32_t indices = 0;
+
+	if (c0 < c1) // Four colors mode requires 'c0' to be the greater
+	{
+		const uint16_t temp = c0;
+		c0 = c1;
+		c1 = temp;
+	}
+
+	if (c0 != c1)
+	{
+		int palette[4][3];
+		sFrom565(c0, palette[0]);
+		sFrom565(c1, palette[1]);
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			palette[2][c] = (palette[0][c] * 2 + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + palette[1][c] * 2) / 3;
+		}
+
+		for (size_t i = 0; i < 16; i++)
+		{
+			uint32_t best = 0;
+			int best_distance = 0x7FFFFFFF;
+
+			for (uint32_t p = 0; p < 4; p++)
+			{
+				const int dr = rgb[i * 3 + 0] - palette[p][0];
+				const int dg = rgb[i * 3 + 1] - palette[p][1];
+				const int db = rgb[i * 3 + 2] - palette[p][2];
+				const int distance = dr * dr + dg * dg + db * db;
+
+				if (distance < best_distance)
+				{
+					best_distance = distance;
+					best = p;
+				}
+			}
+
+			indices |= best << (i * 2);
+		}
+	}
+
+	// Little endian, first pixel in lowest bits
+	out[0] = (uint8_t)(c0 & 0xFF);
+	out[1] = (uint8_t)(c0 >> 8);
+	out[2] = (uint8_t)(c1 & 0xFF);
+	out[3] = (uint8_t)(c1 >> 8);
+
+	for (size_t i = 0; i < 4; i++)
+		out[4 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+
+static void sSingleBlock(const uint8_t* v, uint8_t* out)
+{
+	// As BC4, or alpha in BC3
+	int min = 255;
+	int max = 0;
+
+	for (size_t i = 0; i < 16; i++)
+	{
+		min = (v[i] < min) ? v[i] : min;
+		max = (v[i] > max) ? v[i] : max;
+	}
+
+	uint64_t indices = 0;
+
+	if (max != min) // Eight values mode, 'a0' greater than 'a1'
+	{
+		const int range = max - min;
+
+		for (size_t i = 0; i < 16; i++)
+		{
+			// Position from min to max, then to an index where
+			// 0 = max, 1 = min, and 2-7 go from max to min
+			const int p = ((v[i] - min) * 7 + range / 2) / range;
+			const uint64_t index = (p == 7) ? 0 : (p == 0) ? 1 : (uint64_t)(8 - p);
+
+			indices |= index << (i * 3);
+		}
+	}
+
+	out[0] = (uint8_t)max;
+	out[1] = (uint8_t)min;
+
+	for (size_t i = 0; i < 6; i++)
+		out[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+
+static inline size_t sBlockSize(enum akoBcn format)
+{
+	return (format == AKO_BC3) ? 16 : 8;
+}
+
+
+AKO_EXPORT size_t akoBcnSize(enum akoBcn format, size_t image_w, size_t image_h)
+{
+	if (format != AKO_BC1 && format != AKO_BC3 && format != AKO_BC4)
+		return 0;
+
+	return ((image_w + 3) / 4) * ((image_h + 3) / 4) * sBlockSize(format);
+}
+
+
+void akoFormatToBcn(enum akoBcn format, size_t channels, size_t tile_x, size_t tile_y, size_t tile_w, size_t tile_h,
+                    size_t image_w, const uint8_t* in, uint8_t* out)
+{
+	// Input is an interleaved tile, at a position multiple of four (tiles are of
+	// eight or more, powers of two), blocks past its borders repeat last pixels
+	const size_t blocks_w = (image_w + 3) / 4;
+	const size_t block_size = sBlockSize(format);
+
+	uint8_t rgb[16 * 3];
+	uint8_t single[16];
+
+	for (size_t by = 0; by < (tile_h + 3) / 4; by++)
+	{
+		for (size_t bx = 0; bx < (tile_w + 3) / 4; bx++)
+		{
+			for (size_t i = 0; i < 16; i++)
+			{
+				const size_t x = (bx * 4 + i % 4 < tile_w) ? (bx * 4 + i % 4) : (tile_w - 1);
+				const size_t y = (by * 4 + i / 4 < tile_h) ? (by * 4 + i / 4) : (tile_h - 1);
+				const uint8_t* pixel = in + (y * tile_w + x) * channels;
+
+				for (size_t c = 0; c < 3; c++)
+					rgb[i * 3 + c] = (channels >= 3) ? pixel[c] : pixel[0]; // Gray to all
+
+				if (format == AKO_BC3)
+					single[i] = (channels == 4) ? pixel[3] : (channels == 2) ? pixel[1] : 255;
+				else
+					single[i] = pixel[0];
+			}
+
+			uint8_t* block = out + ((tile_y / 4 + by) * blocks_w + tile_x / 4 + bx) * block_size;
+
+			if (format == AKO_BC1)
+				sColorBlock(rgb, block);
+			else if (format == AKO_BC3)
+			{
+				sSingleBlock(single, block);
+				sColorBlock(rgb, block + 8);
+			}
+			else
+				sSingleBlock(single, block);
+		}
+	}
+}
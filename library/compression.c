@@ -27,40 +27,288 @@ SOFTWARE.
 #include "ako-private.h"
 
 
-struct akoBlockHead
+// Code-blocks: every lowpass and highpass plane is divided in rectangles of
+// 'code_blocks' side, each one an independent Kagari stream with its own block
+// head. A first block holds lift heads, as otherwise they are single values
+// scattered between planes. Order is the one of akoIterateLifts()
+
+#define HEADS_MAX (AKO_MAX_CHANNELS * 64)
+
+struct sBlocksData
 {
-	uint32_t block_size;
+	size_t code_blocks;
+
+	uint8_t* cursor; // Encoder
+	const uint8_t* end;
+
+	const uint8_t* in_cursor; // Decoder
+	const uint8_t* in_end;
+	int skip; // Just walk over blocks
+
+	int16_t heads[HEADS_MAX];
+	size_t heads_no;
+
+	int failure;
 };
 
 
-size_t akoCompress(enum akoCompression method, size_t channels, size_t tile_w, size_t tile_h, coeff_t* input,
-                   void* output)
+static inline size_t sMin(size_t a, size_t b)
+{
+	return (a < b) ? a : b;
+}
+
+
+static int sEncodeBlock(size_t w, size_t h, size_t stride, const coeff_t* in, uint8_t** cursor, const uint8_t* end)
+{
+	if ((size_t)(end - *cursor) <= sizeof(struct akoBlockHead))
+		return 1;
+
+	struct akoBlockHead* head = (struct akoBlockHead*)(*cursor);
+	const size_t size = akoKagariEncode2d(w, h, stride, (size_t)(end - *cursor) - sizeof(struct akoBlockHead), in,
+	                                      *cursor + sizeof(struct akoBlockHead));
+	if (size == 0)
+		return 1;
+
+	head->block_size = (uint32_t)size;
+	*cursor += sizeof(struct akoBlockHead) + size;
+	return 0;
+}
+
+static int sDecodeBlock(size_t w, size_t h, size_t stride, const uint8_t** cursor, const uint8_t* end, coeff_t* out)
+{
+	const struct akoBlockHead* head = (const struct akoBlockHead*)(*cursor);
+
+	if ((size_t)(end - *cursor) < sizeof(struct akoBlockHead) ||
+	    head->block_size > (size_t)(end - *cursor) - sizeof(struct akoBlockHead))
+		return 1;
+
+	const size_t size =
+	    akoKagariDecode2d(w, h, stride, (size_t)head->block_size, *cursor + sizeof(struct akoBlockHead), out);
+	if (size == 0 || size != head->block_size)
+		return 1;
+
+	*cursor += sizeof(struct akoBlockHead) + size;
+	return 0;
+}
+
+
+static int sSkipBlock(const uint8_t** cursor, const uint8_t* end)
+{
+	const struct akoBlockHead* head = (const struct akoBlockHead*)(*cursor);
+
+	if ((size_t)(end - *cursor) < sizeof(struct akoBlockHead) ||
+	    head->block_size > (size_t)(end - *cursor) - sizeof(struct akoBlockHead))
+		return 1;
+
+	*cursor += sizeof(struct akoBlockHead) + head->block_size;
+	return 0;
+}
+
+
+static void sPlane(struct sBlocksData* data, size_t w, size_t h, coeff_t* plane)
+{
+	for (size_t y = 0; y < h; y += data->code_blocks)
+	{
+		for (size_t x = 0; x < w; x += data->code_blocks)
+		{
+			const size_t block_w = sMin(data->code_blocks, w - x);
+			const size_t block_h = sMin(data->code_blocks, h - y);
+
+			if (data->failure != 0)
+				return;
+
+			if (data->cursor != NULL)
+				data->failure = sEncodeBlock(block_w, block_h, w, plane + (w * y + x), &data->cursor, data->end);
+			else if (data->skip != 0)
+				data->failure = sSkipBlock(&data->in_cursor, data->in_end);
+			else
+				data->failure =
+				    sDecodeBlock(block_w, block_h, w, &data->in_cursor, data->in_end, plane + (w * y + x));
+		}
+	}
+}
+
+
+static void sLpCallback(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h, size_t target_w,
+                        size_t target_h, coeff_t* lp, void* user_data)
+{
+	sPlane(user_data, target_w, target_h, lp);
+}
+
+static void sHpCallback(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h,
+                        const struct akoLiftHead* head, size_t current_w, size_t current_h, size_t target_w,
+                        size_t target_h, coeff_t* aux, coeff_t* hp_c, coeff_t* hp_b, coeff_t* hp_d, void* user_data)
+{
+	sPlane(user_data, current_w, current_h, hp_c);
+	sPlane(user_data, current_w, current_h, hp_b);
+	sPlane(user_data, current_w, current_h, hp_d);
+}
+
+
+static void sLpNothing(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h, size_t target_w,
+                       size_t target_h, coeff_t* lp, void* user_data)
+{
+}
+
+static void sHpGatherHead(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h,
+                          const struct akoLiftHead* head, size_t current_w, size_t current_h, size_t target_w,
+                          size_t target_h, coeff_t* aux, coeff_t* hp_c, coeff_t* hp_b, coeff_t* hp_d, void* user_data)
+{
+	struct sBlocksData* data = user_data;
+	data->heads[data->heads_no++] = head->quantization;
+}
+
+static void sHpCountHead(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h,
+                         const struct akoLiftHead* head, size_t current_w, size_t current_h, size_t target_w,
+                         size_t target_h, coeff_t* aux, coeff_t* hp_c, coeff_t* hp_b, coeff_t* hp_d, void* user_data)
+{
+	struct sBlocksData* data = user_data;
+	data->heads_no++;
+}
+
+static void sHpScatterHead(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h,
+                           const struct akoLiftHead* head, size_t current_w, size_t current_h, size_t target_w,
+                           size_t target_h, coeff_t* aux, coeff_t* hp_c, coeff_t* hp_b, coeff_t* hp_d, void* user_data)
+{
+	struct sBlocksData* data = user_data;
+	((struct akoLiftHead*)head)->quantization = data->heads[data->heads_no++];
+}
+
+
+static size_t sCompressBlocks(size_t code_blocks, size_t channels, size_t tile_w, size_t tile_h, coeff_t* input,
+                              size_t output_size, void* output)
+{
+	struct sBlocksData data = {0};
+	data.code_blocks = code_blocks;
+	data.cursor = output;
+	data.end = (uint8_t*)output + output_size;
+
+	// Lift heads, in its own block
+	akoIterateLifts(NULL, channels, tile_w, tile_h, input, sLpNothing, sHpGatherHead, &data);
+
+	if (data.heads_no != 0 && sEncodeBlock(data.heads_no, 1, 0, data.heads, &data.cursor, data.end) != 0)
+		return 0;
+
+	// Coefficients
+	akoIterateLifts(NULL, channels, tile_w, tile_h, input, sLpCallback, sHpCallback, &data);
+
+	if (data.failure != 0)
+		return 0;
+
+	return (size_t)(data.cursor - (uint8_t*)output);
+}
+
+
+static size_t sDecompressBlocks(size_t code_blocks, size_t channels, size_t tile_w, size_t tile_h, size_t input_size,
+                                const void* input, coeff_t* output)
+{
+	struct sBlocksData data = {0};
+	data.code_blocks = code_blocks;
+	data.in_cursor = input;
+	data.in_end = (const uint8_t*)input + input_size;
+
+	// Lift heads, first as we need to know how many are
+	akoIterateLifts(NULL, channels, tile_w, tile_h, output, sLpNothing, sHpCountHead, &data);
+
+	if (data.heads_no != 0 && sDecodeBlock(data.heads_no, 1, 0, &data.in_cursor, data.in_end, data.heads) != 0)
+		return 0;
+
+	// Coefficients, then put heads in place
+	akoIterateLifts(NULL, channels, tile_w, tile_h, output, sLpCallback, sHpCallback, &data);
+
+	if (data.failure != 0)
+		return 0;
+
+	data.heads_no = 0;
+	akoIterateLifts(NULL, channels, tile_w, tile_h, output, sLpNothing, sHpScatterHead, &data);
+
+	return (size_t)(data.in_cursor - (const uint8_t*)input);
+}
+
+
+// Tiles that don't compress (tiny ones, noise) are stored as they are, behind a
+// single block head as large as the tile. Compressed tiles never reach that size,
+// Kagari outputs, code-blocks or not, have to fit in the tile minus a block head
+
+static size_t sStore(size_t input_size, const void* input, void* output)
+{
+	struct akoBlockHead* h = output;
+	h->block_size = (uint32_t)input_size;
+
+	for (size_t i = 0; i < input_size; i++)
+		((uint8_t*)output)[sizeof(struct akoBlockHead) + i] = ((const uint8_t*)input)[i];
+
+	AKO_DEV_PRINTF("E\tStored %zu bytes\n", input_size);
+	return input_size + sizeof(struct akoBlockHead);
+}
+
+static int sStored(size_t decompressed_size, size_t input_size, const void* input)
+{
+	const struct akoBlockHead* h = input;
+	return (input_size >= sizeof(struct akoBlockHead) && (size_t)h->block_size == decompressed_size);
+}
+
+
+size_t akoCompress(enum akoCompression method, size_t code_blocks, size_t channels, size_t tile_w, size_t tile_h,
+                   coeff_t* input, void* output)
 {
 	(void)method;
 	const size_t input_size = akoTileDataSize(tile_w, tile_h) * channels;
 	const size_t output_size = input_size;
 
+	if (code_blocks != 0)
+	{
+		const size_t compressed_size =
+		    sCompressBlocks(code_blocks, channels, tile_w, tile_h, input, output_size, output);
+		AKO_DEV_PRINTF("E\tCompressed %zu -> %zu bytes, in code-blocks\n", input_size, compressed_size);
+
+		return (compressed_size != 0) ? compressed_size : sStore(input_size, input, output);
+	}
+
 	struct akoBlockHead* h = output;
 
 	const size_t compressed_size = akoKagariEncode(input_size, output_size - sizeof(struct akoBlockHead), input,
 	                                               (uint8_t*)output + sizeof(struct akoBlockHead));
 
 	if (compressed_size == 0)
-		return 0;
+		return sStore(input_size, input, output);
 
-	h->block_size = compressed_size;
+	h->block_size = (uint32_t)compressed_size;
 	AKO_DEV_PRINTF("E\tCompressed %zu -> %u bytes\n", input_size, h->block_size);
 
 	return compressed_size + sizeof(struct akoBlockHead);
 }
 
 
-size_t akoDecompress(enum akoCompression method, size_t decompressed_size, size_t output_size, const void* input,
-                     void* output)
+size_t akoDecompress(enum akoCompression method, size_t code_blocks, size_t channels, size_t tile_w, size_t tile_h,
+                     size_t decompressed_size, size_t output_size, size_t input_size, const void* input, void* output)
 {
 	(void)method;
+
+	if (sStored(decompressed_size, input_size, input) != 0)
+	{
+		if (decompressed_size > output_size || decompressed_size > input_size - sizeof(struct akoBlockHead))
+			return 0;
+
+		for (size_t i = 0; i < decompressed_size; i++)
+			((uint8_t*)output)[i] = ((const uint8_t*)input)[sizeof(struct akoBlockHead) + i];
+
+		return decompressed_size + sizeof(struct akoBlockHead);
+	}
+
+	if (code_blocks != 0)
+	{
+		if (decompressed_size > output_size)
+			return 0;
+
+		return sDecompressBlocks(code_blocks, channels, tile_w, tile_h, input_size, input, output);
+	}
+
 	const struct akoBlockHead* h = input;
 
+	if (input_size < sizeof(struct akoBlockHead) || h->block_size > input_size - sizeof(struct akoBlockHead))
+		return 0;
+
 	const size_t compressed_size = akoKagariDecode(decompressed_size / sizeof(int16_t), (size_t)h->block_size,
 	                                               output_size, (uint8_t*)input + sizeof(struct akoBlockHead), output);
 
@@ -71,3 +319,40 @@ size_t akoDecompress(enum akoCompression method, size_t decompressed_size, size_
 
 	return compressed_size + sizeof(struct akoBlockHead);
 }
+
+
+size_t akoCompressedSize(enum akoCompression method, size_t code_blocks, size_t channels, size_t tile_w,
+                         size_t tile_h, size_t input_size, const void* input)
+{
+	(void)method;
+
+	if (code_blocks != 0)
+	{
+		// A stored tile walks as a single block
+		const uint8_t* cursor = input;
+		if (sStored(akoTileDataSize(tile_w, tile_h) * channels, input_size, input) != 0)
+			return (sSkipBlock(&cursor, cursor + input_size) == 0) ? (size_t)(cursor - (const uint8_t*)input) : 0;
+
+		struct sBlocksData data = {0};
+		data.code_blocks = code_blocks;
+		data.in_cursor = input;
+		data.in_end = (const uint8_t*)input + input_size;
+		data.skip = 1;
+
+		// Iterating lifts here only gives planes dimensions, nothing under 'input' is read
+		akoIterateLifts(NULL, channels, tile_w, tile_h, (void*)input, sLpNothing, sHpCountHead, &data);
+
+		if (data.heads_no != 0 && sSkipBlock(&data.in_cursor, data.in_end) != 0)
+			return 0;
+
+		akoIterateLifts(NULL, channels, tile_w, tile_h, (void*)input, sLpCallback, sHpCallback, &data);
+
+		if (data.failure != 0)
+			return 0;
+
+		return (size_t)(data.in_cursor - (const uint8_t*)input);
+	}
+
+	const uint8_t* cursor = input;
+	return (sSkipBlock(&cursor, cursor + input_size) == 0) ? (size_t)(cursor - (const uint8_t*)input) : 0;
+}
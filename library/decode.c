@@ -27,24 +27,303 @@ SOFTWARE.
 #include "ako-private.h"
 
 
-static inline void sEvent(size_t tile_no, size_t total_tiles, enum akoEvent event, void* data,
-                          void (*callback)(size_t, size_t, enum akoEvent, void*))
+static inline void sEvent(size_t tile_no, size_t total_tiles, enum akoEvent event, size_t tile_w, size_t tile_h,
+                          const uint8_t* blob, const void* input, const struct akoCallbacks* c)
 {
-	if (callback != NULL)
-		callback(tile_no, total_tiles, event, data);
+	// Probes carry what callbacks don't, tile dimensions and blob bytes read so far
+	const size_t blob_cursor = (size_t)(blob - (const uint8_t*)input);
+
+	switch (event)
+	{
+	case AKO_EVENT_FORMAT_START:
+		AKO_PROBE5(decode_format_start, tile_no, total_tiles, tile_w, tile_h, blob_cursor);
+		break;
+	case AKO_EVENT_FORMAT_END:
+		AKO_PROBE5(decode_format_end, tile_no, total_tiles, tile_w, tile_h, blob_cursor);
+		break;
+	case AKO_EVENT_WAVELET_START:
+		AKO_PROBE5(decode_wavelet_start, tile_no, total_tiles, tile_w, tile_h, blob_cursor);
+		break;
+	case AKO_EVENT_WAVELET_END:
+		AKO_PROBE5(decode_wavelet_end, tile_no, total_tiles, tile_w, tile_h, blob_cursor);
+		break;
+	case AKO_EVENT_COMPRESSION_START:
+		AKO_PROBE5(decode_compression_start, tile_no, total_tiles, tile_w, tile_h, blob_cursor);
+		break;
+	case AKO_EVENT_COMPRESSION_END:
+		AKO_PROBE5(decode_compression_end, tile_no, total_tiles, tile_w, tile_h, blob_cursor);
+		break;
+	default: break;
+	}
+
+	if (c->events != NULL)
+		c->events(tile_no, total_tiles, event, c->events_data);
 }
 
 
-AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size, const void* input,
-                                 struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
-                                 enum akoStatus* out_status)
+static enum akoStatus sCheckLimits(const struct akoCallbacks* c, const struct akoSettings* s, int tiles_heads,
+                                   size_t input_size, size_t channels, size_t image_w, size_t image_h,
+                                   size_t* out_tiles_no, size_t* out_tile_total_size, size_t* out_memory)
+{
+	// Everything here happens before allocating, from header values alone, so a
+	// hostile file can't make us reserve memory or spin over tiles it doesn't have
+
+	if (image_h != 0 && image_w > SIZE_MAX / image_h) // Would overflow
+		return AKO_NO_ENOUGH_MEMORY;
+
+	const size_t pixels = image_w * image_h;
+
+	if (c->max_pixels != 0 && pixels > c->max_pixels)
+		return AKO_LIMITS_EXCEEDED;
+
+	// Sizes below are proportional to this, with a factor of a bit less than four
+	// (two bytes per coefficient, plus lift heads and planes spacing)
+	if (channels != 0 && pixels > SIZE_MAX / channels)
+		return AKO_NO_ENOUGH_MEMORY;
+
+	const size_t image_size = pixels * channels;
+	if (image_size > (SIZE_MAX / 16))
+		return AKO_NO_ENOUGH_MEMORY;
+
+	const size_t tiles_no = akoImageTilesNo(image_w, image_h, s->tiles_dimension, akoTilesHeight(s));
+	if (c->max_tiles != 0 && tiles_no > c->max_tiles)
+		return AKO_LIMITS_EXCEEDED;
+
+	// Input should be large enough to hold what the head claims. If compressed every
+	// tile has a block head, and Rle can't pack more than 'AKO_ELIAS_MAX' coefficients
+	// in some 33 bits (a conservative bound of two times that per byte is used here)
+	const size_t min_input_size = ((s->compression != AKO_COMPRESSION_NONE)
+	                                   ? tiles_no * sizeof(struct akoBlockHead) + image_size / (AKO_ELIAS_MAX * 2)
+	                                   : image_size * sizeof(int16_t)) +
+	                              ((tiles_heads != 0) ? tiles_no * sizeof(struct akoTileHead) : 0);
+
+	if (min_input_size > input_size - sizeof(struct akoHead))
+		return AKO_BROKEN_INPUT;
+
+	const size_t tile_total_size =
+	    (akoImageMaxTileDataSize(image_w, image_h, s->tiles_dimension, akoTilesHeight(s)) +
+	     akoImageMaxPlanesSpacingSize(image_w, image_h, s->tiles_dimension, akoTilesHeight(s))) *
+	    channels;
+
+	const size_t memory = tile_total_size * 2 + ((tiles_no > 1) ? image_size : 0);
+	if (c->max_memory != 0 && memory > c->max_memory)
+		return AKO_LIMITS_EXCEEDED;
+
+	// Bye!
+	*out_tiles_no = tiles_no;
+	*out_tile_total_size = tile_total_size;
+	*out_memory = memory;
+	return AKO_OK;
+}
+
+
+AKO_EXPORT size_t akoDecodeWorkareaSize(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                        enum akoStatus* out_status)
+{
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
+	struct akoSettings s = {0};
+	enum akoStatus status = AKO_INVALID_INPUT;
+
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+
+	int tiles_heads;
+
+	size_t tiles_no;
+	size_t tile_total_size;
+	size_t memory = 0;
+
+	if (input != NULL)
+	{
+		status = AKO_BROKEN_INPUT;
+
+		if (input_size >= sizeof(struct akoHead) &&
+		    (status = akoHeadRead(input, &channels, &image_w, &image_h, &s, &tiles_heads, NULL)) == AKO_OK)
+			status = sCheckLimits(&checked_c, &s, tiles_heads, input_size, channels, image_w, image_h, &tiles_no,
+			                      &tile_total_size, &memory);
+	}
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return (status == AKO_OK) ? memory : 0;
+}
+
+
+AKO_EXPORT size_t akoPyramidLevel(size_t channels, size_t image_w, size_t image_h, size_t level, size_t* out_w,
+                                  size_t* out_h)
+{
+	size_t offset = 0;
+
+	for (size_t l = 0; l < level; l++)
+	{
+		offset += image_w * image_h * channels;
+		image_w = akoDividePlusOneRule(image_w);
+		image_h = akoDividePlusOneRule(image_h);
+	}
+
+	if (out_w != NULL)
+		*out_w = image_w;
+	if (out_h != NULL)
+		*out_h = image_h;
+
+	return offset;
+}
+
+
+static void sDecimateU8(size_t channels, size_t w, size_t h, size_t in_stride, const uint8_t* in, size_t out_stride,
+                        uint8_t* out)
+{
+	// Box filter, repeating last col/row if odd. Strides in pixels
+	for (size_t r = 0; r < akoDividePlusOneRule(h); r++)
+	{
+		const uint8_t* a = in + in_stride * channels * (r * 2);
+		const uint8_t* b = in + in_stride * channels * ((r * 2 + 1 < h) ? (r * 2 + 1) : (r * 2));
+
+		for (size_t c = 0; c < akoDividePlusOneRule(w); c++)
+		{
+			const size_t c1 = (c * 2) * channels;
+			const size_t c2 = ((c * 2 + 1 < w) ? (c * 2 + 1) : (c * 2)) * channels;
+
+			for (size_t ch = 0; ch < channels; ch++)
+				out[(out_stride * r + c) * channels + ch] =
+				    (uint8_t)(((unsigned)a[c1 + ch] + a[c2 + ch] + b[c1 + ch] + b[c2 + ch] + 2) / 4);
+		}
+	}
+}
+
+
+struct sPyramid
+{
+	size_t levels;
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+	enum akoColor color;
+	uint8_t* image;   // All levels, one after the other
+	int16_t* scratch; // Formatting destroys its input
+
+	size_t tile_x;
+	size_t tile_y;
+	size_t tile_w;
+	size_t tile_h;
+	size_t tile_levels; // Deepest one that current tile got from lowpasses
+	size_t filled;      // Deepest one that all tiles filled so far
+};
+
+static void sPyramidLevel(size_t w, size_t h, size_t planes_spacing, coeff_t* planes, void* raw_data)
 {
+	struct sPyramid* p = raw_data;
+
+	size_t level = 0;
+	for (size_t tw = p->tile_w, th = p->tile_h; (tw != w || th != h) && level <= p->levels; level++)
+	{
+		tw = akoDividePlusOneRule(tw);
+		th = akoDividePlusOneRule(th);
+	}
+
+	if (level > p->levels)
+		return;
+
+	for (size_t ch = 0; ch < p->channels; ch++)
+		for (size_t i = 0; i < w * h; i++)
+			p->scratch[w * h * ch + i] = planes[(w * h + planes_spacing) * ch + i];
+
+	size_t level_w;
+	uint8_t* out = p->image + akoPyramidLevel(p->channels, p->image_w, p->image_h, level, &level_w, NULL);
+
+	akoFormatToInterleavedU8Rgb(p->color, p->channels, w, h, 0, level_w, p->scratch,
+	                            out + ((p->tile_y >> level) * level_w + (p->tile_x >> level)) * p->channels);
+
+	if (level > p->tile_levels)
+		p->tile_levels = level;
+}
+
+static void sPyramidTile(struct sPyramid* p)
+{
+	// Levels under those lifted, while tile boundaries still fall on whole pixels
+	size_t w = p->tile_w;
+	size_t h = p->tile_h;
+	size_t level = 1;
+
+	for (; level <= p->levels && ((p->tile_x >> level) << level) == p->tile_x &&
+	       ((p->tile_y >> level) << level) == p->tile_y;
+	     level++)
+	{
+		size_t in_w;
+		size_t out_w;
+		const uint8_t* in = p->image + akoPyramidLevel(p->channels, p->image_w, p->image_h, level - 1, &in_w, NULL);
+		uint8_t* out = p->image + akoPyramidLevel(p->channels, p->image_w, p->image_h, level, &out_w, NULL);
+
+		if (level > p->tile_levels)
+			sDecimateU8(p->channels, w, h, in_w,
+			            in + ((p->tile_y >> (level - 1)) * in_w + (p->tile_x >> (level - 1))) * p->channels, out_w,
+			            out + ((p->tile_y >> level) * out_w + (p->tile_x >> level)) * p->channels);
+
+		w = akoDividePlusOneRule(w);
+		h = akoDividePlusOneRule(h);
+	}
+
+	if (level - 1 < p->filled)
+		p->filled = level - 1;
+}
+
+static void sPyramidFinish(struct sPyramid* p)
+{
+	// Levels where tiles overlap, from whole previous ones
+	for (size_t level = p->filled + 1; level <= p->levels; level++)
+	{
+		size_t in_w;
+		size_t in_h;
+		size_t out_w;
+		const uint8_t* in = p->image + akoPyramidLevel(p->channels, p->image_w, p->image_h, level - 1, &in_w, &in_h);
+		uint8_t* out = p->image + akoPyramidLevel(p->channels, p->image_w, p->image_h, level, &out_w, NULL);
+
+		sDecimateU8(p->channels, in_w, in_h, in_w, in, out_w, out);
+	}
+}
+
+
+static enum akoStatus sTileHead(const struct akoSettings* s, const uint8_t** blob, const uint8_t* end,
+                                enum akoWavelet* out_wavelet)
+{
+	struct akoTileHead tile_head;
+
+	if (sizeof(struct akoTileHead) > (size_t)(end - *blob))
+		return AKO_BROKEN_INPUT;
+
+	for (size_t i = 0; i < sizeof(struct akoTileHead); i++)
+		((uint8_t*)&tile_head)[i] = (*blob)[i];
+
+	// Only lifting can change, sizes are the same for all wavelets
+	if (s->wavelet == AKO_WAVELET_NONE ||
+	    (tile_head.wavelet != AKO_WAVELET_DD137 && tile_head.wavelet != AKO_WAVELET_CDF53 &&
+	     tile_head.wavelet != AKO_WAVELET_HAAR))
+		return AKO_BROKEN_INPUT;
+
+	*out_wavelet = (enum akoWavelet)tile_head.wavelet;
+	*blob += sizeof(struct akoTileHead); // Update blob
+	return AKO_OK;
+}
+
+
+static uint8_t* sDecode(const struct akoCallbacks* c, size_t input_size, const void* input,
+                        const enum akoYuvLayout* yuv, const enum akoBcn* bcn, size_t pyramid_levels,
+                        struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                        enum akoStatus* out_status)
+{
+	// Output is interleaved, or Yuv 4:2:0 if 'yuv' is not NULL, or BCn blocks if 'bcn' is
+	// not NULL. With 'pyramid_levels' halved versions of the image follow it, see
+	// akoPyramidLevel()
 	struct akoSettings s = {0};
 	enum akoStatus status;
 
 	size_t channels;
 	size_t image_w;
 	size_t image_h;
+	int tiles_heads;
+	int subsampled_chroma;
 
 	uint8_t* image = NULL;
 	const uint8_t* blob = input;
@@ -52,10 +331,16 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 	void* workarea_a = NULL;
 	void* workarea_b = NULL;
 
+	struct sPyramid pyramid = {0};
+
+	struct akoStats stats = {0}; // Flushed to the shared one at return
+	uint64_t stage_start;
+
 	// Check callbacks and input
-	const struct akoCallbacks checked_c = (c != NULL) ? *c : akoDefaultCallbacks();
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
 
-	if (checked_c.malloc == NULL || checked_c.realloc == NULL || checked_c.free == NULL)
+	if (akoCallbacksCanAllocate(&checked_c) == 0 ||
+	    ((pyramid_levels != 0 || bcn != NULL) && checked_c.workarea != NULL))
 	{
 		status = AKO_INVALID_CALLBACKS;
 		goto return_failure;
@@ -68,35 +353,112 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 	}
 
 	// Read head
-	if ((blob + sizeof(struct akoHead)) > (const uint8_t*)input + sizeof(struct akoHead))
+	if (input_size < sizeof(struct akoHead))
 	{
 		status = AKO_BROKEN_INPUT;
 		goto return_failure;
 	}
 
-	if ((status = akoHeadRead(blob, &channels, &image_w, &image_h, &s)) != AKO_OK)
+	if ((status = akoHeadRead(blob, &channels, &image_w, &image_h, &s, &tiles_heads, &subsampled_chroma)) != AKO_OK)
+		goto return_failure;
+
+	if (yuv != NULL && subsampled_chroma == 0) // Not going to downsample it
+	{
+		status = AKO_INVALID_COLOR_TRANSFORMATION;
 		goto return_failure;
+	}
+
+	for (size_t l = 0, w = image_w, h = image_h; l < pyramid_levels; l++) // Nothing past one pixel
+	{
+		if (w == 1 && h == 1)
+			pyramid_levels = l;
+
+		w = akoDividePlusOneRule(w);
+		h = akoDividePlusOneRule(h);
+	}
 
 	blob += sizeof(struct akoHead); // Update blob
 
 	// Allocate workareas and image
-	const size_t tiles_no = akoImageTilesNo(image_w, image_h, s.tiles_dimension);
-	const size_t tile_total_size = (akoImageMaxTileDataSize(image_w, image_h, s.tiles_dimension) +
-	                                akoImageMaxPlanesSpacingSize(image_w, image_h, s.tiles_dimension)) *
-	                               channels;
+	size_t tiles_no;
+	size_t tile_total_size;
+	size_t memory;
+
+	if ((status = sCheckLimits(&checked_c, &s, tiles_heads, input_size, channels, image_w, image_h, &tiles_no,
+	                           &tile_total_size, &memory)) != AKO_OK)
+		goto return_failure;
 
-	workarea_a = checked_c.malloc(tile_total_size);
-	workarea_b = checked_c.malloc(tile_total_size);
+	const size_t image_size =
+	    (yuv != NULL)   ? image_w * image_h + akoDividePlusOneRule(image_w) * akoDividePlusOneRule(image_h) * 2
+	    : (bcn != NULL) ? akoBcnSize(*bcn, image_w, image_h)
+	                    : akoPyramidLevel(channels, image_w, image_h, pyramid_levels + 1, NULL, NULL);
 
-	if (workarea_a == NULL || workarea_b == NULL)
+	if (bcn != NULL) // Blocks, rather than an interleaved image, always allocated
 	{
-		status = AKO_NO_ENOUGH_MEMORY;
-		goto return_failure;
+		memory += image_size - ((tiles_no > 1) ? image_w * image_h * channels : 0);
+
+		if (checked_c.max_memory != 0 && memory > checked_c.max_memory)
+		{
+			status = AKO_LIMITS_EXCEEDED;
+			goto return_failure;
+		}
 	}
 
-	if (tiles_no > 1) // Recycle
+	if (pyramid_levels != 0) // Levels, plus scratch memory, take at most this much
 	{
-		if ((image = checked_c.malloc(image_w * image_h * channels)) == NULL)
+		memory += image_size + tile_total_size - ((tiles_no > 1) ? image_w * image_h * channels : 0);
+
+		if (checked_c.max_memory != 0 && memory > checked_c.max_memory)
+		{
+			status = AKO_LIMITS_EXCEEDED;
+			goto return_failure;
+		}
+	}
+
+	if (checked_c.workarea != NULL)
+	{
+		if (checked_c.workarea_size < memory)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+
+		workarea_a = checked_c.workarea;
+		workarea_b = (uint8_t*)checked_c.workarea + tile_total_size;
+	}
+	else
+	{
+		workarea_a = checked_c.malloc(tile_total_size);
+		workarea_b = checked_c.malloc(tile_total_size);
+
+		if (workarea_a == NULL || workarea_b == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+	}
+
+	if (pyramid_levels != 0)
+	{
+		pyramid.levels = pyramid_levels;
+		pyramid.channels = channels;
+		pyramid.image_w = image_w;
+		pyramid.image_h = image_h;
+		pyramid.color = s.color;
+		pyramid.filled = pyramid_levels;
+
+		if ((image = pyramid.image = checked_c.malloc(image_size)) == NULL ||
+		    (pyramid.scratch = checked_c.malloc(tile_total_size)) == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+	}
+	else if (tiles_no > 1 || bcn != NULL) // Recycle
+	{
+		if (checked_c.workarea != NULL)
+			image = (uint8_t*)checked_c.workarea + tile_total_size * 2;
+		else if ((image = checked_c.malloc(image_size)) == NULL)
 		{
 			status = AKO_NO_ENOUGH_MEMORY;
 			goto return_failure;
@@ -113,8 +475,11 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 	AKO_DEV_PRINTF("\nD\tTiles no: %zu, Tile total size: %zu\n", tiles_no, tile_total_size);
 
 	// Iterate tiles
-	size_t tile_x = 0;
-	size_t tile_y = 0;
+	struct akoTilesIterator tiles;
+	akoTilesIteratorInit(s.order, image_w, image_h, s.tiles_dimension, akoTilesHeight(&s), &tiles);
+
+	size_t tile_x;
+	size_t tile_y;
 
 	size_t tile_data_size; // Size of data needed to operate per tile.
 	                       // Both encoder/decoder calculate this value just by reading the
@@ -127,8 +492,10 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 
 	for (size_t t = 0; t < tiles_no; t++)
 	{
+		akoTilesIteratorNext(&tiles, &tile_x, &tile_y);
+
 		const size_t tile_w = akoTileDimension(tile_x, image_w, s.tiles_dimension);
-		const size_t tile_h = akoTileDimension(tile_y, image_h, s.tiles_dimension);
+		const size_t tile_h = akoTileDimension(tile_y, image_h, akoTilesHeight(&s));
 
 		if (s.wavelet != AKO_WAVELET_NONE)
 		{
@@ -141,13 +508,23 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 			planes_spacing = 0; // No DWT, no spacing needed
 		}
 
+		// 0. Tile head
+		struct akoSettings tile_s = s;
+
+		if (tiles_heads != 0 &&
+		    (status = sTileHead(&s, &blob, (const uint8_t*)input + input_size, &tile_s.wavelet)) != AKO_OK)
+			goto return_failure;
+
 		// 1. Decompress
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_START, checked_c.events_data, checked_c.events);
+		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_START, tile_w, tile_h, blob, input, &checked_c);
+		stage_start = akoStatsClock(checked_c.stats);
 		{
 			if (s.compression != AKO_COMPRESSION_NONE)
 			{
 				const size_t compressed_size =
-				    akoDecompress(s.compression, tile_data_size, tile_data_size + planes_spacing, blob, workarea_a);
+				    akoDecompress(s.compression, s.code_blocks, channels, tile_w, tile_h, tile_data_size,
+				                  tile_data_size + planes_spacing, input_size - (size_t)(blob - (const uint8_t*)input),
+				                  blob, workarea_a);
 
 				if (compressed_size == 0)
 				{
@@ -160,7 +537,7 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 			else
 			{
 				// Check input
-				if ((blob + tile_data_size) > (const uint8_t*)input + input_size)
+				if (tile_data_size > input_size - (size_t)(blob - (const uint8_t*)input))
 				{
 					status = AKO_BROKEN_INPUT;
 					goto return_failure;
@@ -173,14 +550,24 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 				blob += tile_data_size; // Update blob
 			}
 		}
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_END, checked_c.events_data, checked_c.events);
+		stats.compression_ns += akoStatsClock(checked_c.stats) - stage_start;
+		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_END, tile_w, tile_h, blob, input, &checked_c);
 
 		// 2. Wavelet transform
 		if (s.wavelet != AKO_WAVELET_NONE)
 		{
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_START, checked_c.events_data, checked_c.events);
-			akoUnlift(&s, channels, t, tile_w, tile_h, planes_spacing, workarea_a, workarea_b);
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_END, checked_c.events_data, checked_c.events);
+			sEvent(t, tiles_no, AKO_EVENT_WAVELET_START, tile_w, tile_h, blob, input, &checked_c);
+			stage_start = akoStatsClock(checked_c.stats);
+			pyramid.tile_x = tile_x;
+			pyramid.tile_y = tile_y;
+			pyramid.tile_w = tile_w;
+			pyramid.tile_h = tile_h;
+			pyramid.tile_levels = 0;
+
+			akoUnlift(&tile_s, channels, t, tile_w, tile_h, planes_spacing, (yuv != NULL), workarea_a, workarea_b,
+			          (pyramid_levels != 0) ? sPyramidLevel : NULL, &pyramid);
+			stats.wavelet_ns += akoStatsClock(checked_c.stats) - stage_start;
+			sEvent(t, tiles_no, AKO_EVENT_WAVELET_END, tile_w, tile_h, blob, input, &checked_c);
 		}
 
 		// 3. Developers, developers, developers
@@ -198,29 +585,58 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 
 		// 4. Format
 		{
-			sEvent(t, tiles_no, AKO_EVENT_FORMAT_START, checked_c.events_data, checked_c.events);
+			sEvent(t, tiles_no, AKO_EVENT_FORMAT_START, tile_w, tile_h, blob, input, &checked_c);
+			stage_start = akoStatsClock(checked_c.stats);
 
 			int16_t* from = (s.wavelet != AKO_WAVELET_NONE) ? workarea_b : workarea_a;
-			akoFormatToInterleavedU8Rgb(s.color, channels, tile_w, tile_h, planes_spacing, image_w, from,
-			                            image + (image_w * tile_y + tile_x) * channels);
 
-			sEvent(t, tiles_no, AKO_EVENT_FORMAT_END, checked_c.events_data, checked_c.events);
-		}
+			if (yuv != NULL)
+				akoFormatToYuv420(*yuv, tile_x, tile_y, tile_w, tile_h, image_w, image_h, planes_spacing, from,
+				                  image);
+			else if (bcn != NULL)
+			{
+				// Interleaved into the other workarea, and from there to blocks
+				uint8_t* scratch = (from == workarea_b) ? workarea_a : workarea_b;
+				akoFormatToInterleavedU8Rgb(s.color, channels, tile_w, tile_h, planes_spacing, tile_w, from, scratch);
+				akoFormatToBcn(*bcn, channels, tile_x, tile_y, tile_w, tile_h, image_w, scratch, image);
+			}
+			else
+				akoFormatToInterleavedU8Rgb(s.color, channels, tile_w, tile_h, planes_spacing, image_w, from,
+				                            image + (image_w * tile_y + tile_x) * channels);
 
-		// 5. Next tile
-		tile_x += s.tiles_dimension;
-		if (tile_x >= image_w)
-		{
-			tile_x = 0;
-			tile_y += s.tiles_dimension;
+			if (pyramid_levels != 0)
+			{
+				if (s.wavelet == AKO_WAVELET_NONE)
+				{
+					pyramid.tile_x = tile_x;
+					pyramid.tile_y = tile_y;
+					pyramid.tile_w = tile_w;
+					pyramid.tile_h = tile_h;
+					pyramid.tile_levels = 0;
+				}
+
+				sPyramidTile(&pyramid);
+			}
+
+			stats.format_ns += akoStatsClock(checked_c.stats) - stage_start;
+			sEvent(t, tiles_no, AKO_EVENT_FORMAT_END, tile_w, tile_h, blob, input, &checked_c);
 		}
 	}
 
+	if (pyramid_levels != 0)
+	{
+		sPyramidFinish(&pyramid);
+		checked_c.free(pyramid.scratch);
+	}
+
 	// Bye!
-	if (workarea_a != image)
-		checked_c.free(workarea_a);
-	if (workarea_b != image)
-		checked_c.free(workarea_b);
+	if (checked_c.workarea == NULL)
+	{
+		if (workarea_a != image)
+			checked_c.free(workarea_a);
+		if (workarea_b != image)
+			checked_c.free(workarea_b);
+	}
 
 	if (out_s != NULL)
 		*out_s = s;
@@ -231,18 +647,250 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 	if (out_h != NULL)
 		*out_h = image_h;
 
+	stats.decodes = 1;
+	stats.tiles = tiles_no;
+	stats.pixels = image_w * image_h;
+	stats.image_bytes = image_size;
+	stats.blob_bytes = (size_t)(blob - (const uint8_t*)input);
+	akoStatsAdd(checked_c.stats, &stats);
+
 	if (out_status != NULL)
 		*out_status = AKO_OK;
 
 	return image;
 
 return_failure:
-	if (image != workarea_a && image != workarea_b)
-		checked_c.free(image);
-	if (workarea_a != NULL)
-		checked_c.free(workarea_a);
-	if (workarea_b != NULL)
-		checked_c.free(workarea_b);
+	if (checked_c.workarea == NULL)
+	{
+		if (image != NULL && image != workarea_a && image != workarea_b)
+			checked_c.free(image);
+		if (workarea_a != NULL)
+			checked_c.free(workarea_a);
+		if (workarea_b != NULL)
+			checked_c.free(workarea_b);
+		if (pyramid.scratch != NULL)
+			checked_c.free(pyramid.scratch);
+	}
+
+	stats.failures = 1;
+	akoStatsAdd(checked_c.stats, &stats);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return NULL;
+}
+
+
+AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                 struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                                 enum akoStatus* out_status)
+{
+	return sDecode(c, input_size, input, NULL, NULL, 0, out_s, out_channels, out_w, out_h, out_status);
+}
+
+
+AKO_EXPORT uint8_t* akoDecodePyramidExt(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                        size_t levels, struct akoSettings* out_s, size_t* out_channels, size_t* out_w,
+                                        size_t* out_h, enum akoStatus* out_status)
+{
+	return sDecode(c, input_size, input, NULL, NULL, levels, out_s, out_channels, out_w, out_h, out_status);
+}
+
+
+AKO_EXPORT uint8_t* akoDecodeBcnExt(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                    enum akoBcn format, struct akoSettings* out_s, size_t* out_channels,
+                                    size_t* out_w, size_t* out_h, enum akoStatus* out_status)
+{
+	if (akoBcnSize(format, 1, 1) == 0)
+	{
+		if (out_status != NULL)
+			*out_status = AKO_INVALID_INPUT;
+		return NULL;
+	}
+
+	return sDecode(c, input_size, input, NULL, &format, 0, out_s, out_channels, out_w, out_h, out_status);
+}
+
+
+AKO_EXPORT uint8_t* akoDecodeYuv420Ext(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                       enum akoYuvLayout layout, struct akoSettings* out_s, size_t* out_w,
+                                       size_t* out_h, enum akoStatus* out_status)
+{
+	if (layout != AKO_YUV_I420 && layout != AKO_YUV_NV12)
+	{
+		if (out_status != NULL)
+			*out_status = AKO_INVALID_INPUT;
+		return NULL;
+	}
+
+	return sDecode(c, input_size, input, &layout, NULL, 0, out_s, NULL, out_w, out_h, out_status);
+}
+
+
+static enum akoStatus sTilePayload(const struct akoSettings* s, int tiles_heads, size_t channels, size_t tile_w,
+                                   size_t tile_h, const uint8_t** blob, const uint8_t* end,
+                                   enum akoWavelet* out_wavelet, const uint8_t** out_payload, size_t* out_size)
+{
+	// Where a tile is in the blob, from heads alone
+	enum akoStatus status;
+	*out_wavelet = s->wavelet;
+
+	if (tiles_heads != 0 && (status = sTileHead(s, blob, end, out_wavelet)) != AKO_OK)
+		return status;
+
+	size_t size;
+	if (s->compression != AKO_COMPRESSION_NONE)
+	{
+		if ((size = akoCompressedSize(s->compression, s->code_blocks, channels, tile_w, tile_h,
+		                              (size_t)(end - *blob), *blob)) == 0)
+			return AKO_BROKEN_INPUT;
+	}
+	else
+	{
+		size = (s->wavelet != AKO_WAVELET_NONE) ? akoTileDataSize(tile_w, tile_h) * channels
+		                                        : tile_w * tile_h * channels * sizeof(int16_t);
+		if (size > (size_t)(end - *blob))
+			return AKO_BROKEN_INPUT;
+	}
+
+	*out_payload = *blob;
+	*out_size = size;
+	*blob += size; // Update blob
+	return AKO_OK;
+}
+
+
+AKO_EXPORT struct akoTileRect* akoDiffExt(const struct akoCallbacks* c, size_t a_size, const void* a, size_t b_size,
+                                          const void* b, size_t* out_changed_no, size_t* out_tiles_no,
+                                          enum akoStatus* out_status)
+{
+	struct akoSettings s[2] = {0};
+	enum akoStatus status;
+
+	size_t channels[2];
+	size_t image_w[2];
+	size_t image_h[2];
+	int tiles_heads[2];
+	int subsampled_chroma[2];
+
+	const uint8_t* blob[2] = {a, b};
+	const uint8_t* end[2] = {(const uint8_t*)a + a_size, (const uint8_t*)b + b_size};
+
+	struct akoTileRect* changed = NULL;
+	size_t changed_no = 0;
+
+	// Check callbacks and inputs
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
+
+	if (akoCallbacksCanAllocate(&checked_c) == 0 || checked_c.workarea != NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	if (a == NULL || b == NULL)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	// Read heads
+	size_t tiles_no;
+	size_t tile_total_size;
+	size_t memory;
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		const size_t input_size = (size_t)(end[i] - blob[i]);
+
+		if (input_size < sizeof(struct akoHead))
+		{
+			status = AKO_BROKEN_INPUT;
+			goto return_failure;
+		}
+
+		if ((status = akoHeadRead(blob[i], &channels[i], &image_w[i], &image_h[i], &s[i], &tiles_heads[i],
+		                          &subsampled_chroma[i])) != AKO_OK ||
+		    (status = sCheckLimits(&checked_c, &s[i], tiles_heads[i], input_size, channels[i], image_w[i],
+		                           image_h[i], &tiles_no, &tile_total_size, &memory)) != AKO_OK)
+			goto return_failure;
+
+		blob[i] += sizeof(struct akoHead); // Update blob
+	}
+
+	// Tiles should be the same, holding the same amount of coefficients
+	if (channels[0] != channels[1] || image_w[0] != image_w[1] || image_h[0] != image_h[1] ||
+	    s[0].tiles_dimension != s[1].tiles_dimension || akoTilesHeight(&s[0]) != akoTilesHeight(&s[1]) ||
+	    s[0].order != s[1].order || s[0].compression != s[1].compression || s[0].code_blocks != s[1].code_blocks ||
+	    subsampled_chroma[0] != subsampled_chroma[1] ||
+	    (s[0].wavelet == AKO_WAVELET_NONE) != (s[1].wavelet == AKO_WAVELET_NONE))
+	{
+		status = AKO_INCOMPATIBLE_INPUTS;
+		goto return_failure;
+	}
+
+	// Otherwise identical tiles decode differently
+	const int all_changed = (s[0].color != s[1].color || s[0].wrap != s[1].wrap);
+
+	if ((changed = checked_c.malloc(sizeof(struct akoTileRect) * tiles_no)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Iterate tiles, comparing compressed bytes
+	struct akoTilesIterator tiles;
+	akoTilesIteratorInit(s[0].order, image_w[0], image_h[0], s[0].tiles_dimension, akoTilesHeight(&s[0]), &tiles);
+
+	for (size_t t = 0; t < tiles_no; t++)
+	{
+		size_t tile_x;
+		size_t tile_y;
+		akoTilesIteratorNext(&tiles, &tile_x, &tile_y);
+
+		const size_t tile_w = akoTileDimension(tile_x, image_w[0], s[0].tiles_dimension);
+		const size_t tile_h = akoTileDimension(tile_y, image_h[0], akoTilesHeight(&s[0]));
+
+		enum akoWavelet wavelet[2];
+		const uint8_t* payload[2];
+		size_t size[2];
+
+		for (size_t i = 0; i < 2; i++)
+		{
+			if ((status = sTilePayload(&s[i], tiles_heads[i], channels[0], tile_w, tile_h, &blob[i], end[i],
+			                           &wavelet[i], &payload[i], &size[i])) != AKO_OK)
+				goto return_failure;
+		}
+
+		int equal = (all_changed == 0 && wavelet[0] == wavelet[1] && size[0] == size[1]);
+		for (size_t i = 0; i < size[0] && equal != 0; i++)
+			equal = (payload[0][i] == payload[1][i]);
+
+		if (equal == 0)
+		{
+			changed[changed_no].x = tile_x;
+			changed[changed_no].y = tile_y;
+			changed[changed_no].width = tile_w;
+			changed[changed_no].height = tile_h;
+			changed_no += 1;
+		}
+	}
+
+	// Bye!
+	if (out_changed_no != NULL)
+		*out_changed_no = changed_no;
+	if (out_tiles_no != NULL)
+		*out_tiles_no = tiles_no;
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return changed;
+
+return_failure:
+	if (changed != NULL)
+		checked_c.free(changed);
+
 	if (out_status != NULL)
 		*out_status = status;
 
@@ -27,39 +27,241 @@ SOFTWARE.
 #include "ako-private.h"
 
 
-static inline void sEvent(size_t tile_no, size_t total_tiles, enum akoEvent event, void* data,
-                          void (*callback)(size_t, size_t, enum akoEvent, void*))
+static inline void sEvent(size_t tile_no, size_t total_tiles, enum akoEvent event, size_t tile_w, size_t tile_h,
+                          size_t blob_size, const struct akoCallbacks* c)
 {
-	if (callback != NULL)
-		callback(tile_no, total_tiles, event, data);
+	// Probes carry what callbacks don't, tile dimensions and blob bytes so far
+	switch (event)
+	{
+	case AKO_EVENT_FORMAT_START:
+		AKO_PROBE5(encode_format_start, tile_no, total_tiles, tile_w, tile_h, blob_size);
+		break;
+	case AKO_EVENT_FORMAT_END:
+		AKO_PROBE5(encode_format_end, tile_no, total_tiles, tile_w, tile_h, blob_size);
+		break;
+	case AKO_EVENT_WAVELET_START:
+		AKO_PROBE5(encode_wavelet_start, tile_no, total_tiles, tile_w, tile_h, blob_size);
+		break;
+	case AKO_EVENT_WAVELET_END:
+		AKO_PROBE5(encode_wavelet_end, tile_no, total_tiles, tile_w, tile_h, blob_size);
+		break;
+	case AKO_EVENT_COMPRESSION_START:
+		AKO_PROBE5(encode_compression_start, tile_no, total_tiles, tile_w, tile_h, blob_size);
+		break;
+	case AKO_EVENT_COMPRESSION_END:
+		AKO_PROBE5(encode_compression_end, tile_no, total_tiles, tile_w, tile_h, blob_size);
+		break;
+	default: break;
+	}
+
+	if (c->events != NULL)
+		c->events(tile_no, total_tiles, event, c->events_data);
 }
 
 
-AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSettings* s, size_t channels,
-                               size_t image_w, size_t image_h, const void* in, void** out, enum akoStatus* out_status)
+static void sSizes(const struct akoSettings* s, size_t channels, size_t image_w, size_t image_h,
+                   size_t* out_tiles_no, size_t* out_tile_total_size, size_t* out_max_blob_size)
+{
+	const size_t tiles_h = akoTilesHeight(s);
+	const size_t tiles_no = akoImageTilesNo(image_w, image_h, s->tiles_dimension, tiles_h);
+	const size_t max_tile_data_size = akoImageMaxTileDataSize(image_w, image_h, s->tiles_dimension, tiles_h) * channels;
+
+	*out_tiles_no = tiles_no;
+	*out_tile_total_size = max_tile_data_size +
+	                       akoImageMaxPlanesSpacingSize(image_w, image_h, s->tiles_dimension, tiles_h) * channels +
+	                       sizeof(struct akoBlockHead);
+
+	// Compression never outputs more than its input, plus a block head when storing it
+	*out_max_blob_size = sizeof(struct akoHead) +
+	                     (max_tile_data_size + sizeof(struct akoTileHead) + sizeof(struct akoBlockHead)) * tiles_no;
+}
+
+
+static size_t sWorkareasNo(const struct akoSettings* s)
+{
+	// Psnr targets decode candidates to measure them, that takes a third one
+	// (not with downscales, there is no reference to measure against)
+	return (s->target_psnr > 0.0F && s->downscale == 0) ? 3 : 2;
+}
+
+
+struct sBudget
+{
+	uint64_t start;
+	uint64_t budget; // In nanoseconds
+	uint64_t ns[3];  // Spent per wavelet, DD137, CDF53 and Haar
+	uint64_t pixels[3];
+};
+
+static enum akoWavelet sBudgetWavelet(const struct sBudget* b, enum akoWavelet wavelet, uint64_t now,
+                                      size_t remaining_pixels)
+{
+	// Finest wavelet that, at the throughput measured so far, finishes
+	// remaining pixels in time. Not measured ones get a chance to be
+	for (int w = (int)wavelet; w < (int)AKO_WAVELET_HAAR; w++)
+	{
+		if (b->pixels[w] == 0)
+			return (enum akoWavelet)w;
+
+		const double prediction =
+		    (double)(now - b->start) + (double)remaining_pixels * (double)b->ns[w] / (double)b->pixels[w];
+
+		if (prediction <= (double)b->budget)
+			return (enum akoWavelet)w;
+	}
+
+	return AKO_WAVELET_HAAR;
+}
+
+
+static int sBatchable(const struct akoSettings* s, const struct akoTilesIterator* tiles, size_t tile_x, size_t tile_y,
+                      size_t image_w, size_t image_h)
+{
+	// Current tile, and those that follow, are full sized?
+	struct akoTilesIterator ahead = *tiles;
+	size_t x = tile_x;
+	size_t y = tile_y;
+
+	for (size_t b = 0; b < AKO_BATCH_TILES; b++)
+	{
+		if (b != 0)
+			akoTilesIteratorNext(&ahead, &x, &y);
+
+		if (akoTileDimension(x, image_w, s->tiles_dimension) != s->tiles_dimension ||
+		    akoTileDimension(y, image_h, akoTilesHeight(s)) != akoTilesHeight(s))
+			return 0;
+	}
+
+	return 1;
+}
+
+
+static void sBatchFormat(const struct akoSettings* s, const struct akoTilesIterator* tiles, size_t tile_x,
+                         size_t tile_y, size_t channels, size_t image_w, size_t planes_spacing, const void* in,
+                         int16_t* workarea, int16_t* batch_in)
+{
+	// Format tiles one by one, then interleave they rows as akoLift() wants them in a batch
+	const size_t tile_w = s->tiles_dimension;
+	const size_t tile_h = akoTilesHeight(s);
+	const size_t plane_size = (tile_w * tile_h + planes_spacing) * AKO_BATCH_TILES;
+
+	struct akoTilesIterator ahead = *tiles;
+	size_t x = tile_x;
+	size_t y = tile_y;
+
+	for (size_t b = 0; b < AKO_BATCH_TILES; b++)
+	{
+		if (b != 0)
+			akoTilesIteratorNext(&ahead, &x, &y);
+
+		akoFormatToPlanarI16Yuv(s->discard_non_visible, s->color, channels, tile_w, tile_h, image_w, planes_spacing,
+		                        (const uint8_t*)in + ((image_w * y) + x) * channels, workarea);
+
+		for (size_t ch = 0; ch < channels; ch++)
+		{
+			const int16_t* plane = workarea + (tile_w * tile_h + planes_spacing) * ch;
+
+			for (size_t r = 0; r < tile_h; r++)
+				for (size_t c = 0; c < tile_w; c++)
+					batch_in[plane_size * ch + (r * AKO_BATCH_TILES + b) * tile_w + c] = plane[r * tile_w + c];
+		}
+	}
+}
+
+
+static enum akoStatus sHeadWrite(const struct akoSettings* s, size_t channels, size_t image_w, size_t image_h,
+                                 int tiles_heads, int subsampled_chroma, struct akoHead* out)
+{
+	// With 'downscale' the file describes a smaller image, with smaller tiles
+	struct akoSettings head_s = *s;
+
+	if (s->downscale != 0)
+	{
+		if (s->downscale < 0 || s->downscale > 32)
+			return AKO_INVALID_DIMENSIONS;
+
+		if (s->wavelet == AKO_WAVELET_NONE)
+			return AKO_INVALID_WAVELET_TRANSFORMATION;
+
+		head_s.tiles_dimension >>= s->downscale;
+		head_s.tiles_height >>= s->downscale;
+
+		if ((s->tiles_dimension != 0 && head_s.tiles_dimension < AKO_MIN_TILES_DIMENSION) ||
+		    (s->tiles_height != 0 && head_s.tiles_height < AKO_MIN_TILES_DIMENSION))
+			return AKO_INVALID_TILES_DIMENSIONS;
+	}
+
+	return akoHeadWrite(channels, akoDownscaledDimension(image_w, s->downscale),
+	                    akoDownscaledDimension(image_h, s->downscale), &head_s, tiles_heads, subsampled_chroma, out);
+}
+
+
+AKO_EXPORT size_t akoEncodeWorkareaSize(const struct akoSettings* s, size_t channels, size_t image_w, size_t image_h)
+{
+	const struct akoSettings checked_s = (s != NULL) ? *s : akoDefaultSettings();
+	struct akoHead head;
+
+	size_t tiles_no;
+	size_t tile_total_size;
+	size_t max_blob_size;
+
+	if (sHeadWrite(&checked_s, channels, image_w, image_h, 0, 0, &head) != AKO_OK)
+		return 0;
+
+	sSizes(&checked_s, channels, image_w, image_h, &tiles_no, &tile_total_size, &max_blob_size);
+	return tile_total_size * sWorkareasNo(&checked_s) + max_blob_size;
+}
+
+
+static size_t sEncode(const struct akoCallbacks* c, const struct akoSettings* s, const enum akoYuvLayout* yuv,
+                      size_t channels, size_t image_w, size_t image_h, const void* in, void** out,
+                      enum akoStatus* out_status)
 {
+	// Input is interleaved, or Yuv 4:2:0 if 'yuv' is not NULL
 	enum akoStatus status;
 
 	size_t blob_size = 0;
+	size_t blob_capacity = 0;
 	uint8_t* blob = NULL;
 
 	void* workarea_a = NULL;
 	void* workarea_b = NULL;
+	void* workarea_c = NULL;
+	int16_t* batch_in = NULL;
+	int16_t* batch_out = NULL;
+
+	struct akoStats stats = {0}; // Flushed to the shared one at return
+	uint64_t stage_start;
+
+	struct akoSummaryGrid summary_grid;
 
 	// Check callbacks, settings and input
-	const struct akoCallbacks checked_c = (c != NULL) ? *c : akoDefaultCallbacks();
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
 	struct akoSettings checked_s = (s != NULL) ? *s : akoDefaultSettings();
 
-	if (checked_c.malloc == NULL || checked_c.realloc == NULL || checked_c.free == NULL)
+	if (akoCallbacksCanAllocate(&checked_c) == 0)
 	{
 		status = AKO_INVALID_CALLBACKS;
 		goto return_failure;
 	}
 
+	if (yuv != NULL)
+	{
+		checked_s.color = AKO_COLOR_NONE; // Already there
+
+		if (checked_s.downscale != 0) // Chroma is already one level down
+		{
+			status = AKO_INVALID_DIMENSIONS;
+			goto return_failure;
+		}
+	}
+
 	{
-		if (checked_s.color == AKO_COLOR_YCOCG && (checked_s.quantization > 0 || checked_s.gate > 0))
+		const int lossy = (checked_s.quantization > 0 || checked_s.gate > 0 || checked_s.target_psnr > 0.0F);
+
+		if (checked_s.color == AKO_COLOR_YCOCG && lossy != 0)
 			checked_s.color = AKO_COLOR_YCOCG_Q;
-		else if (checked_s.color == AKO_COLOR_YCOCG_Q && (checked_s.quantization <= 0 && checked_s.gate <= 0))
+		else if (checked_s.color == AKO_COLOR_YCOCG_Q && lossy == 0)
 			checked_s.color = AKO_COLOR_YCOCG;
 	}
 
@@ -69,39 +271,93 @@ AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSet
 		goto return_failure;
 	}
 
-	// Allocate blob
-	blob_size = sizeof(struct akoHead);
+	// Time budget, tiles need to record their wavelet
+	struct sBudget budget = {0};
+	const int tiles_heads = (checked_c.time_budget > 0.0F && checked_s.wavelet != AKO_WAVELET_NONE);
 
-	if ((blob = checked_c.malloc(blob_size)) == NULL)
+	if (tiles_heads != 0)
 	{
-		status = AKO_NO_ENOUGH_MEMORY;
-		goto return_failure;
+		budget.start = akoStatsClock(&stats); // Always enabled here
+		budget.budget = (uint64_t)((double)checked_c.time_budget * 1000000.0);
 	}
 
 	// Write head
-	if ((status = akoHeadWrite(channels, image_w, image_h, &checked_s, blob)) != AKO_OK)
+	struct akoHead head;
+	if ((status = sHeadWrite(&checked_s, channels, image_w, image_h, tiles_heads, (yuv != NULL), &head)) != AKO_OK)
 		goto return_failure;
 
-	// Allocate workareas
-	const size_t tiles_no = akoImageTilesNo(image_w, image_h, checked_s.tiles_dimension);
-	const size_t tile_total_size = (akoImageMaxTileDataSize(image_w, image_h, checked_s.tiles_dimension) +
-	                                akoImageMaxPlanesSpacingSize(image_w, image_h, checked_s.tiles_dimension)) *
-	                               channels;
+	// Allocate workareas and blob
+	size_t tiles_no;
+	size_t tile_total_size;
+	size_t max_blob_size;
+	sSizes(&checked_s, channels, image_w, image_h, &tiles_no, &tile_total_size, &max_blob_size);
 
-	workarea_a = checked_c.malloc(tile_total_size);
-	workarea_b = checked_c.malloc(tile_total_size);
+	if (checked_c.workarea != NULL)
+	{
+		if (checked_c.workarea_size < tile_total_size * sWorkareasNo(&checked_s) + max_blob_size)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
 
-	if (workarea_a == NULL || workarea_b == NULL)
+		workarea_a = checked_c.workarea;
+		workarea_b = (uint8_t*)checked_c.workarea + tile_total_size;
+		if (sWorkareasNo(&checked_s) > 2)
+			workarea_c = (uint8_t*)checked_c.workarea + tile_total_size * 2;
+		blob = (uint8_t*)checked_c.workarea + tile_total_size * sWorkareasNo(&checked_s);
+		blob_capacity = max_blob_size;
+	}
+	else
 	{
-		status = AKO_NO_ENOUGH_MEMORY;
-		goto return_failure;
+		workarea_a = checked_c.malloc(tile_total_size);
+		workarea_b = checked_c.malloc(tile_total_size);
+		if (sWorkareasNo(&checked_s) > 2)
+			workarea_c = checked_c.malloc(tile_total_size);
+		blob = checked_c.malloc(sizeof(struct akoHead));
+		blob_capacity = sizeof(struct akoHead);
+
+		if (workarea_a == NULL || workarea_b == NULL || (workarea_c == NULL && sWorkareasNo(&checked_s) > 2) ||
+		    blob == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+	}
+
+	// Tiny tiles lift in batches, for that they need a fixed wavelet and to
+	// be plain Rgb ones. Memory is not accounted on caller's workarea
+	if (checked_c.workarea == NULL && checked_s.wavelet != AKO_WAVELET_NONE && tiles_heads == 0 &&
+	    checked_s.target_psnr <= 0.0F && checked_s.downscale == 0 && yuv == NULL && tiles_no >= AKO_BATCH_TILES &&
+	    checked_s.tiles_dimension != 0 && checked_s.tiles_dimension <= AKO_BATCH_MAX_DIMENSION &&
+	    akoTilesHeight(&checked_s) <= AKO_BATCH_MAX_DIMENSION)
+	{
+		batch_in = checked_c.malloc(tile_total_size * AKO_BATCH_TILES);
+		batch_out = checked_c.malloc(tile_total_size * AKO_BATCH_TILES * 2); // Outputs, then auxiliary memory
+
+		if (batch_in == NULL || batch_out == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
 	}
 
+	*((struct akoHead*)blob) = head;
+	blob_size = sizeof(struct akoHead);
+
 	AKO_DEV_PRINTF("\nE\tTiles no: %zu, Tile total size: %zu\n", tiles_no, tile_total_size);
 
+	// Side outputs
+	struct akoSummary* summary = (yuv == NULL) ? checked_c.summary : NULL;
+	if (summary != NULL)
+		akoSummaryStart(&summary_grid, summary);
+
 	// Iterate tiles
-	size_t tile_x = 0;
-	size_t tile_y = 0;
+	struct akoTilesIterator tiles;
+	akoTilesIteratorInit(checked_s.order, image_w, image_h, checked_s.tiles_dimension, akoTilesHeight(&checked_s),
+	                     &tiles);
+
+	size_t tile_x;
+	size_t tile_y;
 
 	size_t tile_data_size; // Size of data needed to operate per tile.
 	                       // Both encoder/decoder calculate this value just by reading the
@@ -112,14 +368,20 @@ AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSet
 	                       // Spacing only lives here, at runtime, is not contained in the file.
 	                       // Saves us from extra mallocs() and helps with cache locality.
 
+	size_t batch_left = 0; // Tiles lifted ahead, waiting in 'batch_out'
+
 	for (size_t t = 0; t < tiles_no; t++)
 	{
+		akoTilesIteratorNext(&tiles, &tile_x, &tile_y);
+
 		const size_t tile_w = akoTileDimension(tile_x, image_w, checked_s.tiles_dimension);
-		const size_t tile_h = akoTileDimension(tile_y, image_h, checked_s.tiles_dimension);
+		const size_t tile_h = akoTileDimension(tile_y, image_h, akoTilesHeight(&checked_s));
+		const size_t out_tile_w = akoDownscaledDimension(tile_w, checked_s.downscale);
+		const size_t out_tile_h = akoDownscaledDimension(tile_h, checked_s.downscale);
 
 		if (checked_s.wavelet != AKO_WAVELET_NONE)
 		{
-			tile_data_size = akoTileDataSize(tile_w, tile_h) * channels;
+			tile_data_size = akoTileDataSize(out_tile_w, out_tile_h) * channels;
 			planes_spacing = akoPlanesSpacing(tile_w, tile_h);
 		}
 		else
@@ -128,36 +390,118 @@ AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSet
 			planes_spacing = 0; // No DWT, no spacing needed
 		}
 
+		// 0. Budget
+		struct akoSettings tile_s = checked_s;
+		uint64_t tile_start = 0;
+
+		if (tiles_heads != 0)
+		{
+			const size_t done_pixels = budget.pixels[0] + budget.pixels[1] + budget.pixels[2];
+
+			tile_start = akoStatsClock(&stats);
+			tile_s.wavelet = sBudgetWavelet(&budget, checked_s.wavelet, tile_start, image_w * image_h - done_pixels);
+		}
+
+		// 1-2. Format and wavelet transform ahead, a batch of tiles. Events
+		// cover all of them, starting at the first, ending at the last one
+		if (batch_in != NULL && batch_left == 0 && t + AKO_BATCH_TILES <= tiles_no &&
+		    sBatchable(&checked_s, &tiles, tile_x, tile_y, image_w, image_h) != 0)
+		{
+			const size_t last = t + AKO_BATCH_TILES - 1;
+
+			sEvent(t, tiles_no, AKO_EVENT_FORMAT_START, tile_w, tile_h, blob_size, &checked_c);
+			stage_start = akoStatsClock(checked_c.stats);
+			sBatchFormat(&checked_s, &tiles, tile_x, tile_y, channels, image_w, planes_spacing, in, workarea_a,
+			             batch_in);
+			stats.format_ns += akoStatsClock(checked_c.stats) - stage_start;
+			sEvent(last, tiles_no, AKO_EVENT_FORMAT_END, tile_w, tile_h, blob_size, &checked_c);
+
+			sEvent(t, tiles_no, AKO_EVENT_WAVELET_START, tile_w, tile_h, blob_size, &checked_c);
+			stage_start = akoStatsClock(checked_c.stats);
+			akoLift(t, &checked_s, channels, tile_w, tile_h, planes_spacing, 0, AKO_BATCH_TILES, batch_in, batch_out);
+			stats.wavelet_ns += akoStatsClock(checked_c.stats) - stage_start;
+			sEvent(last, tiles_no, AKO_EVENT_WAVELET_END, tile_w, tile_h, blob_size, &checked_c);
+
+			batch_left = AKO_BATCH_TILES;
+		}
+
 		// 1. Format
-		sEvent(t, tiles_no, AKO_EVENT_FORMAT_START, checked_c.events_data, checked_c.events);
+		if (batch_left == 0)
 		{
-			akoFormatToPlanarI16Yuv(checked_s.discard_non_visible, checked_s.color, channels, tile_w, tile_h, image_w,
-			                        planes_spacing, (const uint8_t*)in + ((image_w * tile_y) + tile_x) * channels,
-			                        workarea_a);
+			sEvent(t, tiles_no, AKO_EVENT_FORMAT_START, tile_w, tile_h, blob_size, &checked_c);
+			stage_start = akoStatsClock(checked_c.stats);
+			{
+				if (yuv == NULL)
+					akoFormatToPlanarI16Yuv(checked_s.discard_non_visible, checked_s.color, channels, tile_w, tile_h,
+					                        image_w, planes_spacing,
+					                        (const uint8_t*)in + ((image_w * tile_y) + tile_x) * channels, workarea_a);
+				else
+					akoFormatYuv420ToPlanarI16(*yuv, tile_x, tile_y, tile_w, tile_h, image_w, image_h, planes_spacing,
+					                           in, workarea_a);
+			}
+			stats.format_ns += akoStatsClock(checked_c.stats) - stage_start;
+			sEvent(t, tiles_no, AKO_EVENT_FORMAT_END, tile_w, tile_h, blob_size, &checked_c);
 		}
-		sEvent(t, tiles_no, AKO_EVENT_FORMAT_END, checked_c.events_data, checked_c.events);
+
+		// Side outputs, pixels just formatted still in cache (also in batches)
+		if (summary != NULL)
+			akoSummaryTile(channels, tile_x, tile_y, tile_w, tile_h, image_w, image_h, in, &summary_grid, summary);
 
 		// 2. Wavelet transform
-		if (checked_s.wavelet != AKO_WAVELET_NONE)
+		if (checked_s.wavelet != AKO_WAVELET_NONE && batch_left == 0)
 		{
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_START, checked_c.events_data, checked_c.events);
-			akoLift(t, &checked_s, channels, tile_w, tile_h, planes_spacing, workarea_a, workarea_b);
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_END, checked_c.events_data, checked_c.events);
+			sEvent(t, tiles_no, AKO_EVENT_WAVELET_START, tile_w, tile_h, blob_size, &checked_c);
+			stage_start = akoStatsClock(checked_c.stats);
+			if (checked_s.target_psnr <= 0.0F)
+				akoLift(t, &tile_s, channels, tile_w, tile_h, planes_spacing, (yuv != NULL), 1, workarea_a,
+				        workarea_b);
+			else
+			{
+				// Lift without losses, then quantize with the largest factor that,
+				// estimating from coefficients, hits the target. Then measure
+				// it against input pixels (if Rgb), going down if it misses
+				struct akoSettings lossless_s = tile_s;
+				lossless_s.quantization = 0;
+				lossless_s.gate = 0;
+				akoLift(t, &lossless_s, channels, tile_w, tile_h, planes_spacing, (yuv != NULL), 1, workarea_a,
+				        workarea_b);
+
+				const uint8_t* reference = (workarea_c != NULL && yuv == NULL)
+				                               ? ((const uint8_t*)in + (tile_y * image_w + tile_x) * channels)
+				                               : NULL;
+
+				const int factor =
+				    akoTargetQuantization(&tile_s, t, channels, out_tile_w, out_tile_h, planes_spacing,
+				                          image_w * channels, reference, workarea_b, workarea_a, workarea_c);
+				akoQuantizeTile(&tile_s, factor, 1, channels, out_tile_w, out_tile_h, workarea_b);
+			}
+			stats.wavelet_ns += akoStatsClock(checked_c.stats) - stage_start;
+			sEvent(t, tiles_no, AKO_EVENT_WAVELET_END, tile_w, tile_h, blob_size, &checked_c);
 		}
 
 		// 3. Compress
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_START, checked_c.events_data, checked_c.events);
+		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_START, tile_w, tile_h, blob_size, &checked_c);
+		stage_start = akoStatsClock(checked_c.stats);
 		{
 			uint8_t* from = (checked_s.wavelet != AKO_WAVELET_NONE) ? ((uint8_t*)workarea_b) : ((uint8_t*)workarea_a);
 			size_t compressed_size = tile_data_size;
 
+			if (batch_left != 0)
+			{
+				from = (uint8_t*)batch_out + tile_data_size * (AKO_BATCH_TILES - batch_left);
+				batch_left--;
+			}
+
+			const struct akoTileHead tile_head = {(uint32_t)tile_s.wavelet};
+			const size_t tile_head_size = (tiles_heads != 0) ? sizeof(struct akoTileHead) : 0;
+
 			// Compress, or not
 			if (checked_s.compression != AKO_COMPRESSION_NONE)
 			{
 				void* to = (checked_s.wavelet != AKO_WAVELET_NONE) ? workarea_a : workarea_b;
 
-				if ((compressed_size =
-				         akoCompress(checked_s.compression, channels, tile_w, tile_h, (coeff_t*)from, to)) == 0)
+				if ((compressed_size = akoCompress(checked_s.compression, checked_s.code_blocks, channels, out_tile_w,
+				                                   out_tile_h, (coeff_t*)from, to)) == 0)
 				{
 					status = AKO_ERROR;
 					goto return_failure;
@@ -166,22 +510,51 @@ AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSet
 				from = to;
 			}
 
-			// Make space
-			void* updated_blob = checked_c.realloc(blob, blob_size + compressed_size);
-			if (updated_blob == NULL)
+			// Too big already? Then there is no point to continue
+			if (checked_c.max_output_size != 0 &&
+			    blob_size + tile_head_size + compressed_size > checked_c.max_output_size)
 			{
-				status = AKO_NO_ENOUGH_MEMORY;
+				status = AKO_OUTPUT_LIMIT_EXCEEDED;
 				goto return_failure;
 			}
 
+			// Make space
+			if (blob_size + tile_head_size + compressed_size > blob_capacity)
+			{
+				void* updated_blob = NULL;
+				if (checked_c.workarea == NULL)
+					updated_blob = checked_c.realloc(blob, blob_size + tile_head_size + compressed_size);
+
+				if (updated_blob == NULL)
+				{
+					status = AKO_NO_ENOUGH_MEMORY;
+					goto return_failure;
+				}
+
+				blob = updated_blob;
+				blob_capacity = blob_size + tile_head_size + compressed_size;
+			}
+
+			// Tile head, bytewise as the blob offers no alignment
+			for (size_t i = 0; i < tile_head_size; i++)
+				blob[blob_size + i] = ((const uint8_t*)&tile_head)[i];
+
+			blob_size += tile_head_size;
+
 			// Copy as is
-			blob = updated_blob;
 			for (size_t i = 0; i < compressed_size; i++)
 				blob[blob_size + i] = from[i];
 
 			blob_size += compressed_size; // Update blob
 		}
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_END, checked_c.events_data, checked_c.events);
+		stats.compression_ns += akoStatsClock(checked_c.stats) - stage_start;
+		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_END, tile_w, tile_h, blob_size, &checked_c);
+
+		if (tiles_heads != 0)
+		{
+			budget.ns[tile_s.wavelet] += akoStatsClock(&stats) - tile_start;
+			budget.pixels[tile_s.wavelet] += tile_w * tile_h;
+		}
 
 		// 4. Developers, developers, developers
 		if (t < AKO_DEV_NOISE)
@@ -194,39 +567,89 @@ AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSet
 		{
 			AKO_DEV_PRINTF("E\t...\n");
 		}
-
-		// 5. Next tile
-		tile_x += checked_s.tiles_dimension;
-		if (tile_x >= image_w)
-		{
-			tile_x = 0;
-			tile_y += checked_s.tiles_dimension;
-		}
 	}
 
+	if (summary != NULL)
+		akoSummaryFinish(channels, image_w, image_h, &summary_grid, summary);
+
 	// Bye!
-	checked_c.free(workarea_a);
-	checked_c.free(workarea_b);
+	if (checked_c.workarea == NULL)
+	{
+		checked_c.free(workarea_a);
+		checked_c.free(workarea_b);
+		if (workarea_c != NULL)
+			checked_c.free(workarea_c);
+	}
+
+	if (batch_in != NULL)
+	{
+		checked_c.free(batch_in);
+		checked_c.free(batch_out);
+	}
+
+	stats.encodes = 1;
+	stats.tiles = tiles_no;
+	stats.pixels = image_w * image_h;
+	stats.image_bytes = (yuv == NULL)
+	                        ? image_w * image_h * channels
+	                        : image_w * image_h + akoDividePlusOneRule(image_w) * akoDividePlusOneRule(image_h) * 2;
+	stats.blob_bytes = blob_size;
+	akoStatsAdd(checked_c.stats, &stats);
 
 	if (out_status != NULL)
 		*out_status = AKO_OK;
 
 	if (out != NULL)
 		*out = blob;
-	else
+	else if (checked_c.workarea == NULL)
 		checked_c.free(blob); // Discard encoded data
 
 	return blob_size;
 
 return_failure:
-	if (workarea_a != NULL)
-		checked_c.free(workarea_a);
-	if (workarea_b != NULL)
-		checked_c.free(workarea_b);
+	if (checked_c.workarea == NULL)
+	{
+		if (workarea_a != NULL)
+			checked_c.free(workarea_a);
+		if (workarea_b != NULL)
+			checked_c.free(workarea_b);
+		if (workarea_c != NULL)
+			checked_c.free(workarea_c);
+		if (blob != NULL)
+			checked_c.free(blob);
+		if (batch_in != NULL)
+			checked_c.free(batch_in);
+		if (batch_out != NULL)
+			checked_c.free(batch_out);
+	}
+
+	stats.failures = 1;
+	akoStatsAdd(checked_c.stats, &stats);
+
 	if (out_status != NULL)
 		*out_status = status;
-	if (blob != NULL)
-		checked_c.free(blob);
 
 	return 0;
 }
+
+
+AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSettings* s, size_t channels,
+                               size_t image_w, size_t image_h, const void* in, void** out, enum akoStatus* out_status)
+{
+	return sEncode(c, s, NULL, channels, image_w, image_h, in, out, out_status);
+}
+
+
+AKO_EXPORT size_t akoEncodeYuv420Ext(const struct akoCallbacks* c, const struct akoSettings* s,
+                                     enum akoYuvLayout layout, size_t image_w, size_t image_h, const void* in,
+                                     void** out, enum akoStatus* out_status)
+{
+	if (layout != AKO_YUV_I420 && layout != AKO_YUV_NV12)
+	{
+		if (out_status != NULL)
+			*out_status = AKO_INVALID_INPUT;
+		return 0;
+	}
+
+	return sEncode(c, s, &layout, 3, image_w, image_h, in, out, out_status);
+}
@@ -309,3 +309,80 @@ void akoFormatToInterleavedU8Rgb(enum akoColor color, size_t channels, size_t wi
 			sInterleave(channels, width, in_plane, out_stride, in, out, out_end);
 	}
 }
+
+
+static inline uint8_t sSaturate(int16_t v)
+{
+	return (uint8_t)((v > 0) ? (v < 255) ? v : 255 : 0);
+}
+
+
+void akoFormatYuv420ToPlanarI16(enum akoYuvLayout layout, size_t tile_x, size_t tile_y, size_t width, size_t height,
+                                size_t image_w, size_t image_h, size_t out_planes_spacing, const uint8_t* in,
+                                int16_t* out)
+{
+	// Luma as is, chroma at its native resolution at the start of its planes
+	const size_t out_plane = (width * height) + out_planes_spacing;
+	const size_t chroma_w = akoDividePlusOneRule(width);
+	const size_t chroma_h = akoDividePlusOneRule(height);
+	const size_t image_chroma_w = akoDividePlusOneRule(image_w);
+	const size_t image_chroma_h = akoDividePlusOneRule(image_h);
+
+	for (size_t row = 0; row < height; row++)
+		for (size_t col = 0; col < width; col++)
+			out[row * width + col] = in[(tile_y + row) * image_w + tile_x + col];
+
+	in += image_w * image_h; // Chroma, at tile position
+	in += ((tile_y / 2) * image_chroma_w + (tile_x / 2)) * ((layout == AKO_YUV_NV12) ? 2 : 1);
+
+	for (size_t row = 0; row < chroma_h; row++)
+		for (size_t col = 0; col < chroma_w; col++)
+		{
+			if (layout == AKO_YUV_NV12)
+			{
+				out[out_plane * 1 + row * chroma_w + col] = in[row * image_chroma_w * 2 + col * 2 + 0];
+				out[out_plane * 2 + row * chroma_w + col] = in[row * image_chroma_w * 2 + col * 2 + 1];
+			}
+			else
+			{
+				out[out_plane * 1 + row * chroma_w + col] = in[row * image_chroma_w + col];
+				out[out_plane * 2 + row * chroma_w + col] =
+				    in[image_chroma_w * image_chroma_h + row * image_chroma_w + col];
+			}
+		}
+}
+
+
+void akoFormatToYuv420(enum akoYuvLayout layout, size_t tile_x, size_t tile_y, size_t width, size_t height,
+                       size_t image_w, size_t image_h, size_t in_planes_spacing, const int16_t* in, uint8_t* out)
+{
+	// Inverse of above, saturating
+	const size_t in_plane = (width * height) + in_planes_spacing;
+	const size_t chroma_w = akoDividePlusOneRule(width);
+	const size_t chroma_h = akoDividePlusOneRule(height);
+	const size_t image_chroma_w = akoDividePlusOneRule(image_w);
+	const size_t image_chroma_h = akoDividePlusOneRule(image_h);
+
+	for (size_t row = 0; row < height; row++)
+		for (size_t col = 0; col < width; col++)
+			out[(tile_y + row) * image_w + tile_x + col] = sSaturate(in[row * width + col]);
+
+	out += image_w * image_h;
+	out += ((tile_y / 2) * image_chroma_w + (tile_x / 2)) * ((layout == AKO_YUV_NV12) ? 2 : 1);
+
+	for (size_t row = 0; row < chroma_h; row++)
+		for (size_t col = 0; col < chroma_w; col++)
+		{
+			if (layout == AKO_YUV_NV12)
+			{
+				out[row * image_chroma_w * 2 + col * 2 + 0] = sSaturate(in[in_plane * 1 + row * chroma_w + col]);
+				out[row * image_chroma_w * 2 + col * 2 + 1] = sSaturate(in[in_plane * 2 + row * chroma_w + col]);
+			}
+			else
+			{
+				out[row * image_chroma_w + col] = sSaturate(in[in_plane * 1 + row * chroma_w + col]);
+				out[image_chroma_w * image_chroma_h + row * image_chroma_w + col] =
+				    sSaturate(in[in_plane * 2 + row * chroma_w + col]);
+			}
+		}
+}
@@ -32,8 +32,9 @@ SOFTWARE.
 
 
 static inline enum akoStatus sValidate(size_t channels, size_t width, size_t height, size_t tiles_dimension,
-                                       enum akoWrap wrap, enum akoWavelet wavelet, enum akoColor color,
-                                       enum akoCompression compression)
+                                       size_t tiles_height, size_t code_blocks, enum akoWrap wrap,
+                                       enum akoWavelet wavelet, enum akoColor color, enum akoCompression compression,
+                                       enum akoOrder order, int subsampled_chroma)
 {
 	if (channels > AKO_MAX_CHANNELS)
 		return AKO_INVALID_CHANNELS_NO;
@@ -45,6 +46,15 @@ static inline enum akoStatus sValidate(size_t channels, size_t width, size_t hei
 	    (tiles_dimension < AKO_MIN_TILES_DIMENSION || tiles_dimension > AKO_MAX_TILES_DIMENSION))
 		return AKO_INVALID_TILES_DIMENSIONS;
 
+	if (tiles_height != 0 && (tiles_height < AKO_MIN_TILES_DIMENSION || tiles_height > AKO_MAX_TILES_DIMENSION))
+		return AKO_INVALID_TILES_DIMENSIONS;
+
+	// Code-blocks only make sense dividing wavelet planes, and only there are compressed
+	if (code_blocks != 0 &&
+	    (code_blocks < AKO_MIN_TILES_DIMENSION || code_blocks > AKO_MAX_CODE_BLOCKS_DIMENSION ||
+	     wavelet == AKO_WAVELET_NONE || compression == AKO_COMPRESSION_NONE))
+		return AKO_INVALID_TILES_DIMENSIONS;
+
 	if (wrap != AKO_WRAP_CLAMP && wrap != AKO_WRAP_MIRROR && wrap != AKO_WRAP_REPEAT && wrap != AKO_WRAP_ZERO)
 		return AKO_INVALID_WRAP_MODE;
 
@@ -60,34 +70,71 @@ static inline enum akoStatus sValidate(size_t channels, size_t width, size_t hei
 	    compression != AKO_COMPRESSION_NONE)
 		return AKO_INVALID_COMPRESSION_METHOD;
 
+	if (order != AKO_ORDER_RASTER && order != AKO_ORDER_MORTON)
+		return AKO_INVALID_TILES_ORDER;
+
+	// Subsampled chroma is lifted from its native resolution, as a lowpass
+	if (subsampled_chroma != 0)
+	{
+		if (channels != 3)
+			return AKO_INVALID_CHANNELS_NO;
+		if (wavelet == AKO_WAVELET_NONE)
+			return AKO_INVALID_WAVELET_TRANSFORMATION;
+		if (color != AKO_COLOR_NONE)
+			return AKO_INVALID_COLOR_TRANSFORMATION;
+	}
+
 	return AKO_OK;
 }
 
 
-enum akoStatus akoHeadWrite(size_t channels, size_t width, size_t height, const struct akoSettings* s, void* out)
+static inline int sBinaryTilesDimension(size_t tiles_dimension, uint32_t* out)
 {
-	struct akoHead* h = out;
-
 	// To encode tiles dimensions we need some extra bit operations
-	size_t binary_tiles_dimension = 0;
-	if (s->tiles_dimension != 0)
+	uint32_t binary = 0;
+	if (tiles_dimension != 0)
 	{
-		for (size_t b = s->tiles_dimension; b > 1; b >>= 1)
-			binary_tiles_dimension++;
+		for (size_t b = tiles_dimension; b > 1; b >>= 1)
+			binary++;
 
-		if (((size_t)1 << binary_tiles_dimension) != s->tiles_dimension)
-			return AKO_INVALID_TILES_DIMENSIONS;
+		if (((size_t)1 << binary) != tiles_dimension)
+			return 1;
 
-		binary_tiles_dimension -= 2; // As AKO_MIN_TILES_DIMENSION is 8
+		binary -= 2; // As AKO_MIN_TILES_DIMENSION is 8
 	}
 
+	*out = binary;
+	return 0;
+}
+
+static inline size_t sTilesDimension(uint32_t binary)
+{
+	return (binary != 0) ? ((size_t)1 << (binary + 2)) : 0;
+}
+
+
+enum akoStatus akoHeadWrite(size_t channels, size_t width, size_t height, const struct akoSettings* s,
+                            int tiles_heads, int subsampled_chroma, void* out)
+{
+	struct akoHead* h = out;
+
 	// Validate
-	const enum akoStatus validation =
-	    sValidate(channels, width, height, s->tiles_dimension, s->wrap, s->wavelet, s->color, s->compression);
+	const enum akoStatus validation = sValidate(channels, width, height, s->tiles_dimension, s->tiles_height,
+	                                            s->code_blocks, s->wrap, s->wavelet, s->color, s->compression,
+	                                            s->order, subsampled_chroma);
 
 	if (validation != AKO_OK)
 		return validation;
 
+	uint32_t binary_tiles_dimension;
+	uint32_t binary_tiles_height;
+	uint32_t binary_code_blocks;
+
+	if (sBinaryTilesDimension(s->tiles_dimension, &binary_tiles_dimension) != 0 ||
+	    sBinaryTilesDimension(s->tiles_height, &binary_tiles_height) != 0 ||
+	    sBinaryTilesDimension(s->code_blocks, &binary_code_blocks) != 0)
+		return AKO_INVALID_TILES_DIMENSIONS;
+
 	// Write
 	h->magic[0] = 'A';
 	h->magic[1] = 'k';
@@ -103,6 +150,11 @@ enum akoStatus akoHeadWrite(size_t channels, size_t width, size_t height, const
 	h->flags |= (uint32_t)(s->color) << 8;
 	h->flags |= (uint32_t)(s->compression) << 10;
 	h->flags |= (uint32_t)(binary_tiles_dimension) << 12;
+	h->flags |= (uint32_t)(binary_tiles_height) << 17;
+	h->flags |= (uint32_t)(s->order) << 22;
+	h->flags |= (uint32_t)(binary_code_blocks) << 23;
+	h->flags |= (uint32_t)((tiles_heads != 0) ? 1 : 0) << 27;
+	h->flags |= (uint32_t)((subsampled_chroma != 0) ? 1 : 0) << 28;
 
 	// Bye!
 	return AKO_OK;
@@ -110,7 +162,7 @@ enum akoStatus akoHeadWrite(size_t channels, size_t width, size_t height, const
 
 
 enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_width, size_t* out_height,
-                           struct akoSettings* out_s)
+                           struct akoSettings* out_s, int* out_tiles_heads, int* out_subsampled_chroma)
 {
 	const struct akoHead* h = in;
 
@@ -118,10 +170,10 @@ enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_wid
 	if (h->magic[0] != 'A' || h->magic[1] != 'k' || h->magic[2] != 'o')
 		return AKO_INVALID_MAGIC;
 
-	if (h->version != AKO_FORMAT_VERSION)
+	if (h->version != AKO_FORMAT_VERSION && h->version != 2)
 		return AKO_UNSUPPORTED_VERSION;
 
-	if ((h->flags >> 15) != 0)
+	if ((h->flags >> ((h->version == 2) ? 17 : 29)) != 0)
 		return AKO_INVALID_FLAGS;
 
 	const size_t channels = (size_t)((h->flags & 0x000F)) + 1;
@@ -130,30 +182,255 @@ enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_wid
 	const enum akoColor color = (enum akoColor)((h->flags >> 8) & 0x0003);
 	const enum akoCompression compression = (enum akoCompression)((h->flags >> 10) & 0x0003);
 
-	size_t tiles_dimension = ((h->flags >> 12) & 0x001F);
-	if (tiles_dimension != 0)
+	const uint32_t binary_tiles_dimension = ((h->flags >> 12) & 0x001F);
+	const uint32_t binary_tiles_height = ((h->flags >> 17) & 0x001F);
+	const enum akoOrder order = (enum akoOrder)((h->flags >> 22) & 0x0001);
+	const uint32_t binary_code_blocks = ((h->flags >> 23) & 0x000F);
+	const int tiles_heads = (int)((h->flags >> 27) & 0x0001);
+	const int subsampled_chroma = (int)((h->flags >> 28) & 0x0001);
+
+	if (binary_tiles_dimension >= (32 - 2) || binary_tiles_height >= (32 - 2))
+		return AKO_INVALID_TILES_DIMENSIONS;
+
+	const size_t tiles_dimension = sTilesDimension(binary_tiles_dimension);
+	const size_t tiles_height = sTilesDimension(binary_tiles_height);
+	const size_t code_blocks = sTilesDimension(binary_code_blocks);
+
+	const enum akoStatus validation = sValidate(channels, (size_t)h->width, (size_t)h->height, tiles_dimension,
+	                                            tiles_height, code_blocks, wrap, wavelet, color, compression, order,
+	                                            subsampled_chroma);
+
+	if (validation != AKO_OK)
+		return validation;
+
+	// Write
+	if (out_channels != NULL)
+		*out_channels = channels;
+
+	if (out_width != NULL)
+		*out_width = (size_t)h->width;
+
+	if (out_height != NULL)
+		*out_height = (size_t)h->height;
+
+	if (out_s != NULL)
 	{
-		if (tiles_dimension < (32 - 2))
-			tiles_dimension = (size_t)1 << (tiles_dimension + 2);
-		else
+		out_s->wrap = wrap;
+		out_s->wavelet = wavelet;
+		out_s->color = color;
+		out_s->compression = compression;
+		out_s->tiles_dimension = tiles_dimension;
+		out_s->tiles_height = tiles_height;
+		out_s->order = order;
+		out_s->code_blocks = code_blocks;
+	}
+
+	if (out_tiles_heads != NULL)
+		*out_tiles_heads = tiles_heads;
+
+	if (out_subsampled_chroma != NULL)
+		*out_subsampled_chroma = subsampled_chroma;
+
+	// Bye!
+	return AKO_OK;
+}
+
+
+enum akoStatus akoSignalHeadWrite(size_t length, const struct akoSettings* s, void* out)
+{
+	struct akoSignalHead* h = out;
+
+	// Validate, blocks length as tiles dimension
+	const enum akoStatus validation = sValidate(1, 1, 1, s->tiles_dimension, 0, 0, s->wrap, s->wavelet,
+	                                            AKO_COLOR_NONE, s->compression, AKO_ORDER_RASTER, 0);
+	if (validation != AKO_OK)
+		return validation;
+
+	if (length == 0)
+		return AKO_INVALID_DIMENSIONS;
+
+	uint32_t binary_blocks_length;
+	if (sBinaryTilesDimension(s->tiles_dimension, &binary_blocks_length) != 0)
+		return AKO_INVALID_TILES_DIMENSIONS;
+
+	// Write
+	h->magic[0] = 'A';
+	h->magic[1] = 'k';
+	h->magic[2] = 'S';
+	h->version = AKO_SIGNAL_FORMAT_VERSION;
+
+	h->flags = (uint32_t)(s->wrap);
+	h->flags |= (uint32_t)(s->wavelet) << 2;
+	h->flags |= (uint32_t)(s->compression) << 4;
+	h->flags |= (uint32_t)(binary_blocks_length) << 6;
+
+	h->length = (uint64_t)length;
+
+	// Bye!
+	return AKO_OK;
+}
+
+
+enum akoStatus akoSignalHeadRead(const void* in, size_t* out_length, struct akoSettings* out_s)
+{
+	const struct akoSignalHead* h = in;
+
+	// Validate
+	if (h->magic[0] != 'A' || h->magic[1] != 'k' || h->magic[2] != 'S')
+		return AKO_INVALID_MAGIC;
+
+	if (h->version != AKO_SIGNAL_FORMAT_VERSION)
+		return AKO_UNSUPPORTED_VERSION;
+
+	if ((h->flags >> 11) != 0)
+		return AKO_INVALID_FLAGS;
+
+	const enum akoWrap wrap = (enum akoWrap)(h->flags & 0x0003);
+	const enum akoWavelet wavelet = (enum akoWavelet)((h->flags >> 2) & 0x0003);
+	const enum akoCompression compression = (enum akoCompression)((h->flags >> 4) & 0x0003);
+	const uint32_t binary_blocks_length = ((h->flags >> 6) & 0x001F);
+
+	if (binary_blocks_length >= (32 - 2))
+		return AKO_INVALID_TILES_DIMENSIONS;
+
+	const size_t blocks_length = sTilesDimension(binary_blocks_length);
+	const enum akoStatus validation = sValidate(1, 1, 1, blocks_length, 0, 0, wrap, wavelet, AKO_COLOR_NONE,
+	                                            compression, AKO_ORDER_RASTER, 0);
+	if (validation != AKO_OK)
+		return validation;
+
+	if (h->length == 0 || h->length > (uint64_t)(SIZE_MAX / sizeof(int16_t)))
+		return AKO_INVALID_DIMENSIONS;
+
+	// Write
+	if (out_length != NULL)
+		*out_length = (size_t)h->length;
+
+	if (out_s != NULL)
+	{
+		out_s->wrap = wrap;
+		out_s->wavelet = wavelet;
+		out_s->compression = compression;
+		out_s->tiles_dimension = blocks_length;
+	}
+
+	// Bye!
+	return AKO_OK;
+}
+
+
+enum akoStatus akoVolumeHeadWrite(size_t channels, size_t width, size_t height, size_t depth, size_t bricks_depth,
+                                  const struct akoSettings* s, void* out)
+{
+	struct akoVolumeHead* h = out;
+
+	// Validate, volumes are always lifted
+	const enum akoStatus validation = sValidate(channels, width, height, s->tiles_dimension, s->tiles_height, 0,
+	                                            s->wrap, s->wavelet, s->color, s->compression, AKO_ORDER_RASTER, 0);
+	if (validation != AKO_OK)
+		return validation;
+
+	if (s->wavelet == AKO_WAVELET_NONE)
+		return AKO_INVALID_WAVELET_TRANSFORMATION;
+
+	if (depth == 0 || depth > AKO_MAX_HEIGHT)
+		return AKO_INVALID_DIMENSIONS;
+
+	uint32_t binary_tiles_dimension;
+	uint32_t binary_tiles_height;
+
+	if (sBinaryTilesDimension(s->tiles_dimension, &binary_tiles_dimension) != 0 ||
+	    sBinaryTilesDimension(s->tiles_height, &binary_tiles_height) != 0)
+		return AKO_INVALID_TILES_DIMENSIONS;
+
+	uint32_t binary_bricks_depth = 0; // Here from two
+	if (bricks_depth != 0)
+	{
+		for (size_t b = bricks_depth; b > 1; b >>= 1)
+			binary_bricks_depth++;
+
+		if (bricks_depth < 2 || bricks_depth > 2147483648 || ((size_t)1 << binary_bricks_depth) != bricks_depth)
 			return AKO_INVALID_TILES_DIMENSIONS;
 	}
 
-	const enum akoStatus validation =
-	    sValidate(channels, (size_t)h->width, (size_t)h->height, tiles_dimension, wrap, wavelet, color, compression);
+	// Write
+	h->magic[0] = 'A';
+	h->magic[1] = 'k';
+	h->magic[2] = 'V';
+	h->version = AKO_VOLUME_FORMAT_VERSION;
+
+	h->width = (uint32_t)width;
+	h->height = (uint32_t)height;
+	h->depth = (uint32_t)depth;
+
+	h->flags = (uint32_t)(channels - 1);
+	h->flags |= (uint32_t)(s->wrap) << 4;
+	h->flags |= (uint32_t)(s->wavelet) << 6;
+	h->flags |= (uint32_t)(s->color) << 8;
+	h->flags |= (uint32_t)(s->compression) << 10;
+	h->flags |= (uint32_t)(binary_tiles_dimension) << 12;
+	h->flags |= (uint32_t)(binary_tiles_height) << 17;
+	h->flags |= (uint32_t)(binary_bricks_depth) << 22;
+
+	// Bye!
+	return AKO_OK;
+}
+
+
+enum akoStatus akoVolumeHeadRead(const void* in, size_t* out_channels, size_t* out_width, size_t* out_height,
+                                 size_t* out_depth, size_t* out_bricks_depth, struct akoSettings* out_s)
+{
+	const struct akoVolumeHead* h = in;
+
+	// Validate
+	if (h->magic[0] != 'A' || h->magic[1] != 'k' || h->magic[2] != 'V')
+		return AKO_INVALID_MAGIC;
 
+	if (h->version != AKO_VOLUME_FORMAT_VERSION)
+		return AKO_UNSUPPORTED_VERSION;
+
+	if ((h->flags >> 27) != 0)
+		return AKO_INVALID_FLAGS;
+
+	const size_t channels = (size_t)((h->flags & 0x000F)) + 1;
+	const enum akoWrap wrap = (enum akoWrap)((h->flags >> 4) & 0x0003);
+	const enum akoWavelet wavelet = (enum akoWavelet)((h->flags >> 6) & 0x0003);
+	const enum akoColor color = (enum akoColor)((h->flags >> 8) & 0x0003);
+	const enum akoCompression compression = (enum akoCompression)((h->flags >> 10) & 0x0003);
+
+	const uint32_t binary_tiles_dimension = ((h->flags >> 12) & 0x001F);
+	const uint32_t binary_tiles_height = ((h->flags >> 17) & 0x001F);
+	const uint32_t binary_bricks_depth = ((h->flags >> 22) & 0x001F);
+
+	if (binary_tiles_dimension >= (32 - 2) || binary_tiles_height >= (32 - 2))
+		return AKO_INVALID_TILES_DIMENSIONS;
+
+	const size_t tiles_dimension = sTilesDimension(binary_tiles_dimension);
+	const size_t tiles_height = sTilesDimension(binary_tiles_height);
+
+	const enum akoStatus validation =
+	    sValidate(channels, (size_t)h->width, (size_t)h->height, tiles_dimension, tiles_height, 0, wrap, wavelet,
+	              color, compression, AKO_ORDER_RASTER, 0);
 	if (validation != AKO_OK)
 		return validation;
 
+	if (wavelet == AKO_WAVELET_NONE)
+		return AKO_INVALID_WAVELET_TRANSFORMATION;
+
+	if (h->depth == 0)
+		return AKO_INVALID_DIMENSIONS;
+
 	// Write
 	if (out_channels != NULL)
 		*out_channels = channels;
-
 	if (out_width != NULL)
 		*out_width = (size_t)h->width;
-
 	if (out_height != NULL)
 		*out_height = (size_t)h->height;
+	if (out_depth != NULL)
+		*out_depth = (size_t)h->depth;
+	if (out_bricks_depth != NULL)
+		*out_bricks_depth = (binary_bricks_depth != 0) ? ((size_t)1 << binary_bricks_depth) : 0;
 
 	if (out_s != NULL)
 	{
@@ -162,6 +439,7 @@ enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_wid
 		out_s->color = color;
 		out_s->compression = compression;
 		out_s->tiles_dimension = tiles_dimension;
+		out_s->tiles_height = tiles_height;
 	}
 
 	// Bye!
@@ -146,6 +146,9 @@ uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, con
 	}
 
 	// Decode
+	if ((s->accumulator >> ELIAS_ACCUMULATOR_FILL_AT) == 0) // Longer than any valid code, also
+		return 0;                                           // sLeadingZeros() can't handle zero
+
 	const int unary_bits = sLeadingZeros((uint32_t)(s->accumulator >> ELIAS_ACCUMULATOR_FILL_AT));
 	const int total_bits = unary_bits * 2 + 1;
 
@@ -169,7 +172,7 @@ uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, con
 static inline uint16_t sZigZagEncode(int16_t in)
 {
 	// https://developers.google.com/protocol-buffers/docs/encoding#signed_integers
-	return (uint16_t)((in << 1) ^ (in >> 15));
+	return (uint16_t)(((uint16_t)in << 1) ^ (in >> 15));
 }
 
 static inline int16_t sZigZagDecode(uint16_t in)
@@ -181,18 +184,29 @@ static inline int16_t sZigZagDecode(uint16_t in)
 //
 
 
-static inline void sRawWriteValue(int16_t value, int16_t** cursor)
+struct sCursor
+{
+	int16_t* row;
+	size_t col;
+	size_t width;
+	size_t stride;
+};
+
+static inline void sRawWriteValue(int16_t value, struct sCursor* cursor)
 {
-	**cursor = value;
-	*cursor = *cursor + 1;
+	cursor->row[cursor->col] = value;
+
+	if (++cursor->col == cursor->width)
+	{
+		cursor->col = 0;
+		cursor->row += cursor->stride;
+	}
 }
 
-static inline void sRawWriteMultipleValues(int16_t value, uint16_t rle_len, int16_t** cursor)
+static inline void sRawWriteMultipleValues(int16_t value, uint16_t rle_len, struct sCursor* cursor)
 {
 	for (uint16_t u = 0; u < rle_len; u++)
-		(*cursor)[u] = value;
-
-	*cursor = *cursor + rle_len;
+		sRawWriteValue(value, cursor);
 }
 
 
@@ -225,65 +239,66 @@ static inline int sDecodeValue(struct akoEliasState* elias, const uint8_t** curs
 }
 
 
-size_t akoKagariEncode(size_t input_size, size_t output_size, const void* input, void* output)
+static size_t sEncode(size_t width, size_t height, size_t stride, size_t output_size, const int16_t* input,
+                      void* output)
 {
 	struct akoEliasState elias = {0};
 
-	const int16_t* input_end = (const int16_t*)((const uint8_t*)input + input_size);
-	const int16_t* in = (const int16_t*)input;
-
 	const uint8_t* out_end = (uint8_t*)output + output_size;
 	uint8_t* out = output;
 
 	uint16_t consecutive_no = 0;
 	int16_t previous_value = 0;
 
-	if (output_size == 0 || input_size == 0)
-		return 0;
-	if ((input_size % 2) != 0)
+	if (output_size == 0 || width == 0 || height == 0)
 		return 0;
 
 	// First value
-	if (sEncodeValue(&elias, &out, out_end, *in) == 0)
+	if (sEncodeValue(&elias, &out, out_end, *input) == 0)
 		return 0;
 
-	previous_value = *in;
-	in++;
+	previous_value = *input;
 
-	// All others
-	for (; in < input_end; in++)
+	// All others, Rle runs continue across rows
+	for (size_t row = 0; row < height; row++)
 	{
-		if (*in == previous_value)
-		{
-			consecutive_no++;
+		const int16_t* in = input + stride * row + ((row == 0) ? 1 : 0);
+		const int16_t* in_end = input + stride * row + width;
 
-			if (consecutive_no <= RLE_TRIGGER_LEN)
+		for (; in < in_end; in++)
+		{
+			if (*in == previous_value)
 			{
-				if (sEncodeValue(&elias, &out, out_end, *in) == 0)
-					return 0;
+				consecutive_no++;
+
+				if (consecutive_no <= RLE_TRIGGER_LEN)
+				{
+					if (sEncodeValue(&elias, &out, out_end, *in) == 0)
+						return 0;
+				}
+				else if (consecutive_no == AKO_ELIAS_MAX - 1) // Oh no, at this rate we are going to overflow!
+				{
+					if (sEncodeRle(&elias, &out, out_end, consecutive_no) == 0)
+						return 0;
+
+					consecutive_no = 0;
+				}
 			}
-			else if (consecutive_no == AKO_ELIAS_MAX - 1) // Oh no, at this rate we are going to overflow!
+			else
 			{
-				if (sEncodeRle(&elias, &out, out_end, consecutive_no) == 0)
+				if (consecutive_no >= RLE_TRIGGER_LEN)
+				{
+					if (sEncodeRle(&elias, &out, out_end, consecutive_no) == 0)
+						return 0;
+				}
+
+				if (sEncodeValue(&elias, &out, out_end, *in) == 0)
 					return 0;
 
+				previous_value = *in;
 				consecutive_no = 0;
 			}
 		}
-		else
-		{
-			if (consecutive_no >= RLE_TRIGGER_LEN)
-			{
-				if (sEncodeRle(&elias, &out, out_end, consecutive_no) == 0)
-					return 0;
-			}
-
-			if (sEncodeValue(&elias, &out, out_end, *in) == 0)
-				return 0;
-
-			previous_value = *in;
-			consecutive_no = 0;
-		}
 	}
 
 	// Maybe the loop finished with a pending Rle length to emit
@@ -298,23 +313,21 @@ size_t akoKagariEncode(size_t input_size, size_t output_size, const void* input,
 }
 
 
-size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const void* input, void* output)
+static size_t sDecode(size_t width, size_t height, size_t stride, size_t input_size, const void* input,
+                      int16_t* output)
 {
 	struct akoEliasState elias = {0};
-
-	const int16_t* out_end = (const int16_t*)((const uint8_t*)output + output_size);
-	int16_t* out = output;
+	struct sCursor out = {output, 0, width, stride};
 
 	const uint8_t* in_end = (const uint8_t*)input + input_size;
 	const uint8_t* in = input;
 
+	size_t no = width * height; // Bounds every write
 	uint16_t consecutive_no = 0;
 	int16_t previous_value = 0;
 	int16_t decoded_v = 0;
 
-	if (output_size == 0 || input_size == 0 || no == 0)
-		return 0;
-	if ((output_size % 2) != 0)
+	if (input_size == 0 || no == 0)
 		return 0;
 
 	// First value
@@ -328,9 +341,6 @@ size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const v
 	// All others
 	for (; no != 0; no--)
 	{
-		if (out == out_end)
-			return 0;
-
 		if (sDecodeValue(&elias, &in, in_end, &decoded_v) == 0)
 			return 0;
 
@@ -345,7 +355,7 @@ size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const v
 					return 0;
 
 				const uint16_t rle_len = consecutive_no;
-				if ((out + (size_t)rle_len) > out_end)
+				if ((size_t)rle_len >= no)
 					return 0;
 
 				sRawWriteMultipleValues(previous_value, rle_len, &out);
@@ -364,3 +374,35 @@ size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const v
 	// Bye!
 	return (size_t)(in - (const uint8_t*)input);
 }
+
+
+size_t akoKagariEncode(size_t input_size, size_t output_size, const void* input, void* output)
+{
+	if ((input_size % 2) != 0)
+		return 0;
+
+	return sEncode(input_size / sizeof(int16_t), 1, 0, output_size, input, output);
+}
+
+
+size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const void* input, void* output)
+{
+	if ((output_size % 2) != 0 || no > output_size / sizeof(int16_t))
+		return 0;
+
+	return sDecode(no, 1, 0, input_size, input, output);
+}
+
+
+size_t akoKagariEncode2d(size_t width, size_t height, size_t stride, size_t output_size, const int16_t* input,
+                         void* output)
+{
+	return sEncode(width, height, stride, output_size, input, output);
+}
+
+
+size_t akoKagariDecode2d(size_t width, size_t height, size_t stride, size_t input_size, const void* input,
+                         int16_t* output)
+{
+	return sDecode(width, height, stride, input_size, input, output);
+}
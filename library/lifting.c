@@ -40,49 +40,87 @@ static void sInverseQuantization(int16_t q, size_t w, size_t h, int16_t* inout)
 }
 
 
-static void sLift2d(enum akoWavelet wavelet, enum akoWrap wrap, size_t in_stride, size_t current_w, size_t current_h,
-                    size_t target_w, size_t target_h, int16_t* lp, int16_t* aux)
+static void sLift2d(enum akoWavelet wavelet, enum akoWrap wrap, size_t batch, size_t in_stride, size_t current_w,
+                    size_t current_h, size_t target_w, size_t target_h, int16_t* lp, int16_t* aux)
 {
+	// With 'batch' tiles rows interleave, first row of every tile, then second, etc. Horizontal
+	// lifts see 'batch' times more rows, vertical ones, rows 'batch' times wider. Kernels
+	// don't tell the difference, just the fake last row needs to be done per tile
 	const size_t fake_last_col = (target_w * 2) - current_w;
 	const size_t fake_last_row = (target_h * 2) - current_h;
 
 	if (wavelet == AKO_WAVELET_HAAR)
 	{
-		akoHaarLiftH(current_h, target_w, fake_last_col, in_stride, lp, aux);
-		if (fake_last_row != 0)
-			akoHaarLiftH(1, target_w, fake_last_col, 0, lp + in_stride * (current_h - 1),
-			             aux + current_h * target_w * 2);
+		akoHaarLiftH(current_h * batch, target_w, fake_last_col, in_stride, lp, aux);
+		for (size_t b = 0; b < batch && fake_last_row != 0; b++)
+			akoHaarLiftH(1, target_w, fake_last_col, 0, lp + in_stride * ((current_h - 1) * batch + b),
+			             aux + (current_h * batch + b) * target_w * 2);
 
-		akoHaarLiftV(target_w * 2, target_h, aux, lp);
+		akoHaarLiftV(target_w * 2 * batch, target_h, aux, lp);
 	}
 	else if (wavelet == AKO_WAVELET_CDF53 || target_w < 8 || target_h < 8)
 	{
-		akoCdf53LiftH(wrap, current_h, target_w, fake_last_col, in_stride, lp, aux);
-		if (fake_last_row != 0)
-			akoCdf53LiftH(wrap, 1, target_w, fake_last_col, 0, lp + in_stride * (current_h - 1),
-			              aux + current_h * target_w * 2);
+		akoCdf53LiftH(wrap, current_h * batch, target_w, fake_last_col, in_stride, lp, aux);
+		for (size_t b = 0; b < batch && fake_last_row != 0; b++)
+			akoCdf53LiftH(wrap, 1, target_w, fake_last_col, 0, lp + in_stride * ((current_h - 1) * batch + b),
+			              aux + (current_h * batch + b) * target_w * 2);
 
-		akoCdf53LiftV(wrap, target_w * 2, target_h, aux, lp);
+		akoCdf53LiftV(wrap, target_w * 2 * batch, target_h, aux, lp);
 	}
 	else
 	{
-		akoDd137LiftH(wrap, current_h, target_w, fake_last_col, in_stride, lp, aux);
-		if (fake_last_row != 0)
-			akoDd137LiftH(wrap, 1, target_w, fake_last_col, 0, lp + in_stride * (current_h - 1),
-			              aux + current_h * target_w * 2);
+		akoDd137LiftH(wrap, current_h * batch, target_w, fake_last_col, in_stride, lp, aux);
+		for (size_t b = 0; b < batch && fake_last_row != 0; b++)
+			akoDd137LiftH(wrap, 1, target_w, fake_last_col, 0, lp + in_stride * ((current_h - 1) * batch + b),
+			              aux + (current_h * batch + b) * target_w * 2);
 
-		akoDd137LiftV(wrap, target_w * 2, target_h, aux, lp);
+		akoDd137LiftV(wrap, target_w * 2 * batch, target_h, aux, lp);
 	}
 }
 
 
+static void sChromaLift(size_t target_w, size_t target_h, int16_t* lp)
+{
+	// Subsampled chroma already is the lowpass of a first lift, with no
+	// highpasses. Spread it to the layout sLift2d() outputs, in reverse
+	// as the source overlaps the destination
+	const size_t stride = target_w * 2;
+
+	for (size_t r = (target_h - 1); r < target_h; r--) // Underflows
+	{
+		for (size_t c = (target_w - 1); c < target_w; c--)
+			lp[r * stride + c] = lp[r * target_w + c];
+
+		for (size_t c = target_w; c < stride; c++)
+			lp[r * stride + c] = 0; // B
+	}
+
+	for (size_t i = target_h * stride; i < target_h * stride * 2; i++)
+		lp[i] = 0; // C and D
+}
+
+
 struct akoUnliftCallbackData
 {
 	coeff_t* out;
 	size_t out_planes_space;
 	size_t tile_no;
+	int subsampled_chroma;
+
+	size_t channels;
+	void (*level_callback)(size_t, size_t, size_t, coeff_t*, void*);
+	void* level_data;
 };
 
+static void sLevel(struct akoUnliftCallbackData* data, size_t ch, size_t tile_w, size_t tile_h, size_t w, size_t h)
+{
+	// Once all channels got a level, let caller see it (before the next one)
+	if (data->level_callback == NULL || ch != data->channels - 1 || (w == tile_w && h == tile_h))
+		return;
+
+	data->level_callback(w, h, tile_w * tile_h + data->out_planes_space - w * h, data->out, data->level_data);
+}
+
 static void s2dUnliftLp(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h, size_t lp_w, size_t lp_h,
                         coeff_t* lp, void* callback_raw_data)
 {
@@ -93,6 +131,8 @@ static void s2dUnliftLp(const struct akoSettings* s, size_t ch, size_t tile_w, s
 	for (size_t i = 0; i < (lp_w * lp_h); i++)
 		out_lp[i] = lp[i]; // Just copy it
 
+	sLevel(data, ch, tile_w, tile_h, lp_w, lp_h);
+
 	// if (data->tile_no == 0 && ch == 0)
 	// {
 	// 	printf("D\t%zux%zu\n", target_w, target_h);
@@ -108,6 +148,9 @@ static void s2dUnliftHp(const struct akoSettings* s, size_t ch, size_t tile_w, s
 	struct akoUnliftCallbackData* data = callback_raw_data;
 	coeff_t* lp = data->out + (tile_w * tile_h + data->out_planes_space) * ch;
 
+	if (data->subsampled_chroma != 0 && ch != 0 && target_w == tile_w && target_h == tile_h)
+		return; // Leave chroma at its native resolution, highpasses here are zero
+
 	const size_t ignore_last_col = (hp_w * 2) - target_w;
 	const size_t ignore_last_row = (hp_h * 2) - target_h;
 
@@ -142,6 +185,9 @@ static void s2dUnliftHp(const struct akoSettings* s, size_t ch, size_t tile_w, s
 		                lp + target_w);
 	}
 
+	sLevel(data, ch, tile_w, tile_h, target_w, target_h);
+	AKO_PROBE4(unlift_level, data->tile_no, ch, target_w, target_h);
+
 	// if (data->tile_no == 0 && ch == 0)
 	// 	printf("D\t%zux%zu <- %zux%zu (%li, %li)\n", target_w, target_h, hp_w, hp_h, ignore_last_col,
 	// 	       ignore_last_row);
@@ -168,15 +214,46 @@ static inline void s2dMemcpy(int16_t q, int16_t g, size_t w, size_t h, size_t in
 }
 
 
+static void sDecimate(size_t w, size_t h, size_t stride, int16_t* inout)
+{
+	// Box filter, for lowpasses that can't be lifted anymore
+	const size_t target_w = akoDividePlusOneRule(w);
+	const size_t target_h = akoDividePlusOneRule(h);
+
+	for (size_t r = 0; r < target_h; r++)
+	{
+		const int16_t* a = inout + stride * (r * 2);
+		const int16_t* b = inout + stride * ((r * 2 + 1 < h) ? (r * 2 + 1) : (r * 2));
+
+		for (size_t c = 0; c < target_w; c++)
+		{
+			const size_t c2 = (c * 2 + 1 < w) ? (c * 2 + 1) : (c * 2);
+			inout[stride * r + c] = (int16_t)(((int)a[c * 2] + (int)a[c2] + (int)b[c * 2] + (int)b[c2]) / 4);
+		}
+	}
+}
+
+
 void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_t tile_w, size_t tile_h,
-             size_t planes_space, int16_t* in, int16_t* output)
+             size_t planes_space, int subsampled_chroma, size_t batch, int16_t* in, int16_t* output)
 {
 	// Protip: everything here operates in reverse
 
+	// A 'batch' of same sized tiles lifts together, see sLift2d(). Planes in 'in' are then
+	// 'batch' times larger, with rows interleaved. Outputs follow one after the other
+
 	size_t target_w = tile_w;
 	size_t target_h = tile_h;
+	size_t lp_stride = tile_w;
+
+	// With 'downscale', finest levels are lifted but not written. What remains is
+	// an smaller tile, quantized as such, as this is what decoders are going to see
+	const size_t out_tile_w = akoDownscaledDimension(tile_w, s->downscale);
+	const size_t out_tile_h = akoDownscaledDimension(tile_h, s->downscale);
+	int level = 0;
 
-	uint8_t* out = (uint8_t*)output + akoTileDataSize(tile_w, tile_h) * channels; // Output end
+	const size_t out_size = akoTileDataSize(out_tile_w, out_tile_h) * channels;
+	uint8_t* out = (uint8_t*)output + out_size; // Output end, of first tile in batch
 
 	// Highpasses
 	while (target_w > 2 && target_h > 2)
@@ -185,6 +262,8 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 		const size_t current_h = target_h;
 		target_w = akoDividePlusOneRule(target_w);
 		target_h = akoDividePlusOneRule(target_h);
+		lp_stride = target_w * 2;
+		level++;
 
 		// Developers, developers, developers
 		if (tile_no == 0)
@@ -196,22 +275,10 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 		// Iterate in Vuy order
 		for (size_t ch = (channels - 1); ch < channels; ch--) // Yes, underflows
 		{
-			int16_t q = 0;
-			int16_t g = 0;
-
-			if (ch == 0)
-			{
-				q = akoQuantization(s->quantization, 1, tile_w, tile_h, current_w, current_h);
-				g = akoGate(s->gate, 1, tile_w, tile_h, current_w, current_h);
-			}
-			else
-			{
-				q = akoQuantization(s->quantization, s->chroma_loss + 1, tile_w, tile_h, current_w, current_h);
-				g = akoGate(s->gate, s->chroma_loss + 1, tile_w, tile_h, current_w, current_h);
-			}
+			AKO_PROBE4(lift_level, tile_no, ch, current_w, current_h);
 
 			// 1. Lift
-			int16_t* lp = in + (tile_w * tile_h + planes_space) * ch;
+			int16_t* lp = in + (tile_w * tile_h + planes_space) * batch * ch;
 
 			if (current_w != tile_w)
 			{
@@ -222,7 +289,7 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 				// 2. Vertical/horizontal lifts don't overlap either
 				// 3. Recycle memory :)
 
-				int16_t* aux = lp + ((target_w * 2) * (target_h * 2)) * 2; // Cache friendly
+				int16_t* aux = lp + ((target_w * 2) * (target_h * 2)) * 2 * batch; // Cache friendly
 
 				// Almost all encoding errors so far happened because of the above pointer
 
@@ -235,36 +302,71 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 				// lp + ((current_w + 1) * (current_h + 1)) * 2; // Cache friendly, but always
 				//                                                  accounts for an extra col/row
 
-				sLift2d(s->wavelet, s->wrap, current_w * 2, current_w, current_h, target_w, target_h, lp, aux);
+				sLift2d(s->wavelet, s->wrap, batch, current_w * 2, current_w, current_h, target_w, target_h, lp,
+				        aux);
 
 				// END OF PLACE OF INTEREST
 			}
+			else if (subsampled_chroma != 0 && ch != 0)
+			{
+				sChromaLift(target_w, target_h, lp); // Never batched
+			}
 			else
 			{
 				int16_t* aux = output; // First lift is to big to allow us to use the
 				                       // same workarea as auxiliary memory. Luckily
 				                       // since is the first one, 'output' is empty
-				sLift2d(s->wavelet, s->wrap, current_w * 1, current_w, current_h, target_w, target_h, lp, aux);
+
+				if (batch > 1) // But a batch one covers outputs of other tiles, here
+				               // caller provides the same amount of memory after them
+					aux = (int16_t*)((uint8_t*)output + out_size * batch);
+				sLift2d(s->wavelet, s->wrap, batch, current_w * 1, current_w, current_h, target_w, target_h, lp,
+				        aux);
 			}
 
 			// 2. Write coefficients
+			if (level <= s->downscale)
+				continue; // Dropped
+
+			int16_t q = 0;
+			int16_t g = 0;
+
+			if (ch == 0)
+			{
+				q = akoQuantization(s->quantization, 1, out_tile_w, out_tile_h, current_w, current_h);
+				g = akoGate(s->gate, 1, out_tile_w, out_tile_h, current_w, current_h);
+			}
+			else
+			{
+				q = akoQuantization(s->quantization, s->chroma_loss + 1, out_tile_w, out_tile_h, current_w,
+				                    current_h);
+				g = akoGate(s->gate, s->chroma_loss + 1, out_tile_w, out_tile_h, current_w, current_h);
+			}
+
 			out -= (target_w * target_h) * sizeof(int16_t) * 3; // Three highpasses...
 
-			s2dMemcpy(q, g, target_w, target_h, (target_w * 2),
-			          lp + target_w * target_h * 2,               //
-			          (int16_t*)out + (target_w * target_h) * 0); // C
+			for (size_t b = 0; b < batch; b++)
+			{
+				const int16_t* lp_b = lp + (target_w * 2) * b;
+				int16_t* out_b = (int16_t*)(out + out_size * b);
 
-			s2dMemcpy(q, g, target_w, target_h, (target_w * 2),
-			          lp + target_w,                              //
-			          (int16_t*)out + (target_w * target_h) * 1); // B
+				s2dMemcpy(q, g, target_w, target_h, (target_w * 2) * batch,
+				          lp_b + target_w * target_h * 2 * batch, //
+				          out_b + (target_w * target_h) * 0);     // C
 
-			s2dMemcpy(q, g, target_w, target_h, (target_w * 2),
-			          lp + target_w + target_h * (target_w * 2),  //
-			          (int16_t*)out + (target_w * target_h) * 2); // D
+				s2dMemcpy(q, g, target_w, target_h, (target_w * 2) * batch,
+				          lp_b + target_w,                    //
+				          out_b + (target_w * target_h) * 1); // B
+
+				s2dMemcpy(q, g, target_w, target_h, (target_w * 2) * batch,
+				          lp_b + target_w + target_h * (target_w * 2) * batch, //
+				          out_b + (target_w * target_h) * 2);                  // D
+			}
 
 			// 3. Write lift head
 			out -= sizeof(struct akoLiftHead); // One lift head...
-			((struct akoLiftHead*)out)->quantization = q;
+			for (size_t b = 0; b < batch; b++)
+				((struct akoLiftHead*)(out + out_size * b))->quantization = q;
 
 			// Developers, developers, developers
 			// if (tile_no == 0)
@@ -277,12 +379,25 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 	if (tile_no == 0)
 		AKO_DEV_PRINTF("D\t%zux%zu\n", target_w, target_h);
 
+	for (; level < s->downscale; level++) // Tile too thin to lift all dropped levels
+	{
+		for (size_t ch = 0; ch < channels; ch++)
+			for (size_t b = 0; b < batch; b++)
+				sDecimate(target_w, target_h, lp_stride * batch,
+				          in + (tile_w * tile_h + planes_space) * batch * ch + lp_stride * b);
+
+		target_w = akoDividePlusOneRule(target_w);
+		target_h = akoDividePlusOneRule(target_h);
+	}
+
 	for (size_t ch = (channels - 1); ch < channels; ch--)
 	{
 		out -= (target_w * target_h) * sizeof(int16_t); // ... And one lowpass
 
-		int16_t* lp = in + (tile_w * tile_h + planes_space) * ch;
-		s2dMemcpy(1, 0, target_w, target_h, (target_w * 2), lp, (int16_t*)out); // LP
+		int16_t* lp = in + (tile_w * tile_h + planes_space) * batch * ch;
+		for (size_t b = 0; b < batch; b++)
+			s2dMemcpy(1, 0, target_w, target_h, lp_stride * batch, lp + lp_stride * b,
+			          (int16_t*)(out + out_size * b)); // LP
 
 		// Developers, developers, developers
 		// if (tile_no == 0)
@@ -293,12 +408,18 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 
 
 void akoUnlift(const struct akoSettings* s, size_t channels, size_t tile_no, size_t tile_w, size_t tile_h,
-               size_t out_planes_space, coeff_t* input, coeff_t* out)
+               size_t out_planes_space, int subsampled_chroma, coeff_t* input, coeff_t* out,
+               void (*level_callback)(size_t w, size_t h, size_t planes_spacing, coeff_t* planes, void* user_data),
+               void* level_data)
 {
 	struct akoUnliftCallbackData data = {0};
 	data.out = out;
 	data.out_planes_space = out_planes_space;
 	data.tile_no = tile_no;
+	data.subsampled_chroma = subsampled_chroma;
+	data.channels = channels;
+	data.level_callback = level_callback;
+	data.level_data = level_data;
 
 	akoIterateLifts(s, channels, tile_w, tile_h, input, s2dUnliftLp, s2dUnliftHp, &data);
 }
@@ -36,12 +36,17 @@ AKO_EXPORT struct akoSettings akoDefaultSettings()
 	s.wrap = AKO_WRAP_CLAMP;
 	s.compression = AKO_COMPRESSION_KAGARI;
 	s.tiles_dimension = 0;
+	s.tiles_height = 0;
+	s.order = AKO_ORDER_RASTER;
+	s.code_blocks = 0;
 
 	s.quantization = 16;
 	s.gate = 0;
 
 	s.chroma_loss = 1;
 	s.discard_non_visible = 0;
+	s.downscale = 0;
+	s.target_psnr = 0.0F;
 
 	return s;
 }
@@ -58,6 +63,18 @@ AKO_EXPORT struct akoCallbacks akoDefaultCallbacks()
 	c.events = NULL;
 	c.events_data = NULL;
 
+	c.max_pixels = 0;
+	c.max_tiles = 0;
+	c.max_memory = 0;
+	c.max_output_size = 0;
+	c.time_budget = 0.0F;
+
+	c.workarea = NULL;
+	c.workarea_size = 0;
+
+	c.stats = NULL;
+	c.summary = NULL;
+
 	return c;
 }
 
@@ -68,6 +85,29 @@ AKO_EXPORT void akoDefaultFree(void* ptr)
 #endif
 
 
+struct akoCallbacks akoCallbacksOrDefault(const struct akoCallbacks* c)
+{
+	if (c != NULL)
+		return *c;
+
+#if (AKO_FREESTANDING == 0)
+	return akoDefaultCallbacks();
+#else
+	const struct akoCallbacks none = {0}; // Nothing to allocate with, a workarea is required
+	return none;
+#endif
+}
+
+
+int akoCallbacksCanAllocate(const struct akoCallbacks* c)
+{
+	if (c->workarea != NULL)
+		return 1;
+
+	return (c->malloc != NULL && c->realloc != NULL && c->free != NULL) ? 1 : 0;
+}
+
+
 AKO_EXPORT const char* akoStatusString(enum akoStatus status)
 {
 	switch (status)
@@ -88,6 +128,10 @@ AKO_EXPORT const char* akoStatusString(enum akoStatus status)
 	case AKO_NO_ENOUGH_MEMORY: return "No enough memory";
 	case AKO_INVALID_FLAGS: return "Invalid flags";
 	case AKO_BROKEN_INPUT: return "Broken input/premature end";
+	case AKO_LIMITS_EXCEEDED: return "Decoding limits exceeded";
+	case AKO_OUTPUT_LIMIT_EXCEEDED: return "Output size limit exceeded";
+	case AKO_INCOMPATIBLE_INPUTS: return "Incompatible inputs (different dimensions or tiles)";
+	case AKO_INVALID_TILES_ORDER: return "Invalid tiles order";
 	default: break;
 	}
 
@@ -101,16 +145,25 @@ inline size_t akoDividePlusOneRule(size_t v)
 }
 
 
+size_t akoDownscaledDimension(size_t d, int levels)
+{
+	for (int l = 0; l < levels; l++)
+		d = akoDividePlusOneRule(d);
+
+	return d;
+}
+
+
 inline size_t akoPlanesSpacing(size_t tile_w, size_t tile_h)
 {
 	return tile_w * 2 + tile_h * 2;
 }
 
 
-inline size_t akoImageMaxPlanesSpacingSize(size_t image_w, size_t image_h, size_t tiles_dimension)
+inline size_t akoImageMaxPlanesSpacingSize(size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h)
 {
-	return sizeof(int16_t) * akoPlanesSpacing(akoTileDimension(0, image_w, tiles_dimension),
-	                                          akoTileDimension(0, image_h, tiles_dimension));
+	return sizeof(int16_t) *
+	       akoPlanesSpacing(akoTileDimension(0, image_w, tiles_w), akoTileDimension(0, image_h, tiles_h));
 }
 
 
@@ -171,38 +224,111 @@ static inline size_t sMin(size_t a, size_t b)
 	return (a < b) ? a : b;
 }
 
-size_t akoImageMaxTileDataSize(size_t image_w, size_t image_h, size_t tiles_dimension)
+size_t akoImageMaxTileDataSize(size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h)
 {
-	if (tiles_dimension == 0 || (tiles_dimension >= image_w && tiles_dimension >= image_h))
-		return akoTileDataSize(image_w, image_h);
-
-	if ((image_w % tiles_dimension) == 0 && (image_h % tiles_dimension) == 0)
-		return akoTileDataSize(tiles_dimension, tiles_dimension);
+	const size_t w = akoTileDimension(0, image_w, tiles_w);
+	const size_t h = akoTileDimension(0, image_h, tiles_h);
 
 	// Tiles of varying size on image borders
 	// (in this horrible way because TileDataSize() is recursive, and my brain hurts)
-	const size_t a = akoTileDataSize(tiles_dimension, tiles_dimension);
-	const size_t b = akoTileDataSize(sMin(tiles_dimension, (image_w % tiles_dimension)), tiles_dimension);
-	const size_t c = akoTileDataSize(tiles_dimension, sMin(tiles_dimension, (image_h % tiles_dimension)));
+	const size_t border_w = (w != image_w && (image_w % w) != 0) ? (image_w % w) : w;
+	const size_t border_h = (h != image_h && (image_h % h) != 0) ? (image_h % h) : h;
 
-	return sMax(sMax(a, b), c);
+	return sMax(sMax(akoTileDataSize(w, h), akoTileDataSize(border_w, h)),
+	            sMax(akoTileDataSize(w, border_h), akoTileDataSize(border_w, border_h)));
 }
 
 
-size_t akoImageTilesNo(size_t image_w, size_t image_h, size_t tiles_dimension)
+size_t akoImageTilesNo(size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h)
 {
-	if (tiles_dimension == 0)
-		return 1;
+	size_t tiles_x = 1;
+	size_t tiles_y = 1;
+
+	if (tiles_w != 0)
+	{
+		tiles_x = (image_w / tiles_w);
+		tiles_x = (image_w % tiles_w != 0) ? (tiles_x + 1) : tiles_x;
+	}
 
-	size_t tiles_x = (image_w / tiles_dimension);
-	size_t tiles_y = (image_h / tiles_dimension);
-	tiles_x = (image_w % tiles_dimension != 0) ? (tiles_x + 1) : tiles_x;
-	tiles_y = (image_h % tiles_dimension != 0) ? (tiles_y + 1) : tiles_y;
+	if (tiles_h != 0)
+	{
+		tiles_y = (image_h / tiles_h);
+		tiles_y = (image_h % tiles_h != 0) ? (tiles_y + 1) : tiles_y;
+	}
 
 	return (tiles_x * tiles_y);
 }
 
 
+size_t akoTilesHeight(const struct akoSettings* s)
+{
+	return (s->tiles_height != 0) ? s->tiles_height : s->tiles_dimension;
+}
+
+
+void akoTilesIteratorInit(enum akoOrder order, size_t image_w, size_t image_h, size_t tiles_w, size_t tiles_h,
+                          struct akoTilesIterator* out)
+{
+	out->order = order;
+	out->tiles_w = tiles_w;
+	out->tiles_h = tiles_h;
+	out->cols = akoImageTilesNo(image_w, 1, tiles_w, 0);
+	out->rows = akoImageTilesNo(1, image_h, 0, tiles_h);
+	out->col = 0;
+	out->row = 0;
+	out->code = 0;
+
+	// Morton codes interleave bits only on a square that covers the smaller side,
+	// bits above that just advance along the larger side. Otherwise thin images
+	// (strips) will spend ages skipping codes outside the image
+	out->square_bits = 0;
+	while (((size_t)1 << out->square_bits) < sMin(out->cols, out->rows))
+		out->square_bits++;
+}
+
+
+void akoTilesIteratorNext(struct akoTilesIterator* it, size_t* out_tile_x, size_t* out_tile_y)
+{
+	if (it->order == AKO_ORDER_MORTON)
+	{
+		do
+		{
+			size_t x = 0;
+			size_t y = 0;
+
+			for (unsigned b = 0; b < it->square_bits; b++)
+			{
+				x |= ((it->code >> (b * 2 + 0)) & 1) << b;
+				y |= ((it->code >> (b * 2 + 1)) & 1) << b;
+			}
+
+			if (it->cols >= it->rows)
+				x |= (it->code >> (it->square_bits * 2)) << it->square_bits;
+			else
+				y |= (it->code >> (it->square_bits * 2)) << it->square_bits;
+
+			it->col = x;
+			it->row = y;
+			it->code++;
+		} while (it->col >= it->cols || it->row >= it->rows);
+
+		*out_tile_x = it->col * it->tiles_w;
+		*out_tile_y = it->row * it->tiles_h;
+		return;
+	}
+
+	// Raster
+	*out_tile_x = it->col * it->tiles_w;
+	*out_tile_y = it->row * it->tiles_h;
+
+	if (++it->col == it->cols)
+	{
+		it->col = 0;
+		it->row++;
+	}
+}
+
+
 static void sLiftTargetDimensions(size_t current_w, size_t current_h, size_t tile_w, size_t tile_h, size_t* out_w,
                                   size_t* out_h)
 {
@@ -96,3 +96,233 @@ int16_t akoQuantization(int factor, int factor_mul, size_t tile_w, size_t tile_h
 
 	return (int16_t)q;
 }
+
+
+// Error estimation
+// =====
+
+// Squared error that one unit of error in a coefficient causes once synthesized
+// (sum over the pixels it spreads), that is, the energy of the synthesis function
+// behind it. Measured feeding impulses to akoUnlift() and summing the squared
+// output, from finest levels to coarser. Lowpasses here keep the input range, so
+// synthesis doubles amplitudes per level and axis, that in energy is a factor of
+// four per level; measures follow that closely after the sixth level, hence only
+// six of them. Diagonal ones (D) went through two highpasses and spread less.
+// Haar ones are exact: its functions are flat squares of 2^level pixels per side
+static const float s_dd137_gains[2][6] = {{1.07F, 2.89F, 10.67F, 41.0F, 159.2F, 618.8F},  // C and B
+                                          {0.45F, 0.88F, 2.99F, 11.05F, 41.7F, 159.7F}}; // D
+static const float s_cdf53_gains[2][6] = {{1.07F, 2.47F, 8.12F, 30.23F, 116.5F, 454.5F},
+                                          {0.52F, 0.83F, 2.36F, 8.28F, 31.0F, 118.7F}};
+static const float s_haar_gains[2][6] = {{2.0F, 8.0F, 32.0F, 128.0F, 512.0F, 2048.0F},
+                                         {1.0F, 4.0F, 16.0F, 64.0F, 256.0F, 1024.0F}};
+
+
+static float sSynthesisGain(enum akoWavelet wavelet, size_t level, int diagonal)
+{
+	const float(*gains)[6] = s_dd137_gains;
+	if (wavelet == AKO_WAVELET_CDF53)
+		gains = s_cdf53_gains;
+	else if (wavelet == AKO_WAVELET_HAAR)
+		gains = s_haar_gains;
+
+	float gain = gains[diagonal][(level < 6) ? level : 5];
+	for (size_t l = 6; l <= level; l++)
+		gain *= 4.0F;
+
+	return gain;
+}
+
+
+static float sColorGain(enum akoColor color, size_t channels, size_t ch)
+{
+	// Same than above, but from a Yuv channel to all Rgb ones. Inverse YCoCg is
+	// R = Y - Cg/2 + Co/2, G = Y + Cg/2, B = Y - Cg/2 - Co/2, so an unit of error
+	// in Y reaches three channels (3), one in Co two channels at half (0.5), and
+	// one in Cg three channels at half (0.75). Subtract green adds G to the others
+	if (channels < 3 || ch >= 3)
+		return 1.0F;
+
+	if (color == AKO_COLOR_YCOCG || color == AKO_COLOR_YCOCG_Q)
+	{
+		const float gains[3] = {3.0F, 0.5F, 0.75F};
+		return (color == AKO_COLOR_YCOCG_Q && ch == 0) ? (gains[0] / 4.0F) : gains[ch]; // Q variant stores Y doubled
+	}
+	else if (color == AKO_COLOR_SUBTRACT_G)
+		return (ch == 0) ? 3.0F : 1.0F;
+
+	return 1.0F;
+}
+
+
+struct sQuantizeData
+{
+	int factor;
+	int apply;
+	size_t channels;
+	double error;
+};
+
+static void sQuantizeLp(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h, size_t target_w,
+                        size_t target_h, coeff_t* lp, void* user_data)
+{
+	// Lowpasses are never quantized
+}
+
+static void sQuantizeHp(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h,
+                        const struct akoLiftHead* head, size_t current_w, size_t current_h, size_t target_w,
+                        size_t target_h, coeff_t* aux, coeff_t* hp_c, coeff_t* hp_b, coeff_t* hp_d, void* user_data)
+{
+	struct sQuantizeData* data = user_data;
+	const int factor_mul = (ch == 0) ? 1 : (s->chroma_loss + 1);
+
+	// Same values than akoLift() uses, there 'current' dimensions are our 'target' ones
+	const int16_t q = akoQuantization(data->factor, factor_mul, tile_w, tile_h, target_w, target_h);
+	const int16_t g = akoGate(s->gate, factor_mul, tile_w, tile_h, target_w, target_h);
+
+	size_t level = 0; // From finest
+	for (size_t w = tile_w; w > target_w; w = akoDividePlusOneRule(w))
+		level++;
+
+	const float color_gain = sColorGain(s->color, data->channels, ch);
+	coeff_t* planes[3] = {hp_c, hp_b, hp_d};
+
+	// Estimations sample big planes, with an odd step to not fall into the same columns
+	const size_t length = current_w * current_h;
+	const size_t step = (data->apply == 0 && length >= 256) ? 5 : 1;
+
+	for (int p = 0; p < 3; p++)
+	{
+		coeff_t* hp = planes[p];
+		int64_t error = 0;
+
+		for (size_t i = 0; i < length; i += step)
+		{
+			const int16_t quantized = (hp[i] < -g || hp[i] > +g) ? (int16_t)(hp[i] / q) : 0;
+			const int32_t e = (int32_t)hp[i] - (int32_t)quantized * (int32_t)q;
+			error += (int64_t)e * (int64_t)e;
+
+			if (data->apply != 0)
+				hp[i] = quantized;
+		}
+
+		const double scale = (double)length / (double)((length + step - 1) / step);
+		data->error += (double)error * scale * (double)(sSynthesisGain(s->wavelet, level, (p == 2)) * color_gain);
+	}
+
+	if (data->apply != 0)
+		((struct akoLiftHead*)head)->quantization = q;
+}
+
+
+double akoQuantizeTile(const struct akoSettings* s, int factor, int apply, size_t channels, size_t tile_w,
+                       size_t tile_h, coeff_t* inout)
+{
+	// Quantizes (or just estimates the error of doing so) coefficients that
+	// akoLift() left lossless. Returns the estimated squared error in Rgb
+	struct sQuantizeData data = {0};
+	data.factor = factor;
+	data.apply = apply;
+	data.channels = channels;
+
+	akoIterateLifts(s, channels, tile_w, tile_h, inout, sQuantizeLp, sQuantizeHp, &data);
+	return data.error;
+}
+
+
+static int sEstimatedQuantization(const struct akoSettings* s, size_t channels, size_t tile_w, size_t tile_h,
+                                  double max_error, coeff_t* lossless)
+{
+	// Largest quantization whose estimated error stays below 'max_error'. Error
+	// grows with quantization (not strictly, but close), so bisect, up to a
+	// precision of 1/16 as in bigger factors the difference is negligible
+	int good = 0; // Known to be under the target
+	int bad = 1;
+
+	while (bad < 8192 && akoQuantizeTile(s, bad, 0, channels, tile_w, tile_h, lossless) <= max_error)
+	{
+		good = bad;
+		bad *= 2;
+	}
+
+	while (bad - good > 1 && bad - good > good / 16)
+	{
+		const int middle = (good + bad) / 2;
+
+		if (akoQuantizeTile(s, middle, 0, channels, tile_w, tile_h, lossless) <= max_error)
+			good = middle;
+		else
+			bad = middle;
+	}
+
+	return good;
+}
+
+
+static double sMeasuredError(const struct akoSettings* s, int factor, size_t tile_no, size_t channels, size_t tile_w,
+                             size_t tile_h, size_t planes_spacing, size_t reference_stride, const uint8_t* reference,
+                             const coeff_t* lossless, coeff_t* scratch_a, coeff_t* scratch_b)
+{
+	// Quantize a copy, then undo everything as a decoder does
+	const size_t size = akoTileDataSize(tile_w, tile_h) * channels;
+	for (size_t i = 0; i < size; i++)
+		((uint8_t*)scratch_a)[i] = ((const uint8_t*)lossless)[i];
+
+	akoQuantizeTile(s, factor, 1, channels, tile_w, tile_h, scratch_a);
+	akoUnlift(s, channels, tile_no, tile_w, tile_h, planes_spacing, 0, scratch_a, scratch_b, NULL, NULL);
+	akoFormatToInterleavedU8Rgb(s->color, channels, tile_w, tile_h, planes_spacing, tile_w, scratch_b,
+	                            (uint8_t*)scratch_a);
+
+	const uint8_t* decoded = (const uint8_t*)scratch_a;
+	double error = 0.0;
+
+	for (size_t row = 0; row < tile_h; row++)
+	{
+		int64_t row_error = 0;
+		for (size_t i = 0; i < tile_w * channels; i++)
+		{
+			const int32_t e = (int32_t)decoded[row * tile_w * channels + i] - (int32_t)reference[i];
+			row_error += (int64_t)e * (int64_t)e;
+		}
+
+		error += (double)row_error;
+		reference += reference_stride;
+	}
+
+	return error;
+}
+
+
+int akoTargetQuantization(const struct akoSettings* s, size_t tile_no, size_t channels, size_t tile_w, size_t tile_h,
+                          size_t planes_spacing, size_t reference_stride, const uint8_t* reference, coeff_t* lossless,
+                          coeff_t* scratch_a, coeff_t* scratch_b)
+{
+	// Squared error, over the whole tile, that the target Psnr allows
+	const double max_error = (255.0 * 255.0) / __builtin_pow(10.0, (double)s->target_psnr / 10.0) *
+	                         (double)(tile_w * tile_h * channels);
+
+	int factor = sEstimatedQuantization(s, channels, tile_w, tile_h, max_error, lossless);
+	if (reference == NULL)
+		return factor;
+
+	// Estimations ignore rounding in color transformations and clamping, mostly
+	// noticeable near lossless targets. So measure, and while the tile misses,
+	// estimate again over a budget shrunk by the same proportion it missed
+	double budget = max_error;
+
+	while (factor > 0)
+	{
+		const double error = sMeasuredError(s, factor, tile_no, channels, tile_w, tile_h, planes_spacing,
+		                                     reference_stride, reference, lossless, scratch_a, scratch_b);
+		if (error <= max_error)
+			break;
+
+		budget = budget * (max_error / error);
+
+		const int smaller = sEstimatedQuantization(s, channels, tile_w, tile_h, budget, lossless);
+		const int step = (factor / 16 > 1) ? (factor / 16) : 1; // Always going down
+
+		factor = (smaller < factor - step) ? smaller : (factor - step);
+	}
+
+	return factor;
+}
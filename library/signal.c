@@ -0,0 +1,497 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ako-private.h"
+
+
+// Signals are lifted with the same kernels images use, horizontally on a single row. Lifting
+// is exact modulo 2^16, so the whole int16 range goes in. Not all of it comes out: Kagari
+// can't code -32768, blocks whose coefficients reach it are stored as they are.
+
+#define LEVELS_MAX 64 // Halving a size_t takes fewer steps
+
+
+static inline size_t sMin(size_t a, size_t b)
+{
+	return (a < b) ? a : b;
+}
+
+
+static size_t sCoefficientsNo(size_t length)
+{
+	// Coarsest lowpass, plus all highpasses. A lift step on an odd length
+	// makes one more, as akoDividePlusOneRule() does
+	size_t no = 0;
+
+	for (; length > 2; length = akoDividePlusOneRule(length))
+		no += akoDividePlusOneRule(length);
+
+	return no + length;
+}
+
+
+static void sLift(enum akoWavelet wavelet, enum akoWrap wrap, size_t length, int16_t* in, int16_t* aux,
+                  int16_t* out)
+{
+	// Coarsest lowpass at the beginning of 'out', highpasses after it, finest
+	// last. Destroys 'in', 'aux' should fit 'length' plus one coefficients
+	size_t end = sCoefficientsNo(length);
+
+	while (length > 2)
+	{
+		const size_t target = akoDividePlusOneRule(length);
+		const size_t fake_last = (target * 2) - length;
+
+		if (wavelet == AKO_WAVELET_HAAR)
+			akoHaarLiftH(1, target, fake_last, 0, in, aux);
+		else if (wavelet == AKO_WAVELET_CDF53 || target < 8)
+			akoCdf53LiftH(wrap, 1, target, fake_last, 0, in, aux);
+		else
+			akoDd137LiftH(wrap, 1, target, fake_last, 0, in, aux);
+
+		end -= target;
+
+		for (size_t i = 0; i < target; i++)
+		{
+			out[end + i] = aux[target + i];
+			in[i] = aux[i];
+		}
+
+		length = target;
+	}
+
+	for (size_t i = 0; i < length; i++)
+		out[i] = in[i];
+}
+
+
+static void sUnlift(enum akoWavelet wavelet, enum akoWrap wrap, size_t length, const int16_t* in, int16_t* aux,
+                    int16_t* out)
+{
+	// Inverse of above, buffers alternate so the finest step lands on 'out'
+	size_t lengths[LEVELS_MAX];
+	size_t levels = 0;
+
+	for (size_t l = length; l > 2; l = akoDividePlusOneRule(l))
+		lengths[levels++] = l;
+
+	const int16_t* lp = in;
+	size_t cursor = (levels != 0) ? akoDividePlusOneRule(lengths[levels - 1]) : length;
+
+	for (size_t l = levels; l > 0; l--)
+	{
+		const size_t target = lengths[l - 1];
+		const size_t current = akoDividePlusOneRule(target);
+		const size_t ignore_last = (current * 2) - target;
+
+		int16_t* to = ((l - 1) % 2 == 0) ? out : aux;
+
+		if (wavelet == AKO_WAVELET_HAAR)
+			akoHaarUnliftH(current, 1, 0, ignore_last, lp, in + cursor, to);
+		else if (wavelet == AKO_WAVELET_CDF53 || current < 8)
+			akoCdf53UnliftH(wrap, current, 1, 0, ignore_last, lp, in + cursor, to);
+		else
+			akoDd137UnliftH(wrap, current, 1, 0, ignore_last, lp, in + cursor, to);
+
+		cursor += current;
+		lp = to;
+	}
+
+	if (levels == 0)
+	{
+		for (size_t i = 0; i < length; i++)
+			out[i] = in[i];
+	}
+}
+
+
+AKO_EXPORT size_t akoEncodeSignalExt(const struct akoCallbacks* c, const struct akoSettings* s, size_t length,
+                                     const int16_t* input, void** output, enum akoStatus* out_status)
+{
+	enum akoStatus status;
+
+	uint8_t* blob = NULL;
+	size_t blob_size = sizeof(struct akoSignalHead);
+
+	int16_t* samples = NULL;
+	int16_t* aux = NULL;
+	int16_t* coefficients = NULL;
+	uint8_t* compressed = NULL;
+
+	// Check callbacks and input
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
+	const struct akoSettings checked_s = (s != NULL) ? *s : akoDefaultSettings();
+
+	if (akoCallbacksCanAllocate(&checked_c) == 0 || checked_c.workarea != NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	if (input == NULL || output == NULL)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	if (length > SIZE_MAX / (sizeof(int16_t) * 4))
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Allocate, head goes first
+	if ((blob = checked_c.malloc(sizeof(struct akoSignalHead))) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	if ((status = akoSignalHeadWrite(length, &checked_s, blob)) != AKO_OK)
+		goto return_failure;
+
+	const size_t blocks_length = (checked_s.tiles_dimension != 0) ? sMin(checked_s.tiles_dimension, length) : length;
+	const size_t blocks_no = length / blocks_length + ((length % blocks_length != 0) ? 1 : 0);
+
+	// Block heads hold sizes in 32 bits, a single block can't go beyond
+	if (blocks_length > UINT32_MAX / sizeof(int16_t))
+	{
+		status = AKO_INVALID_TILES_DIMENSIONS;
+		goto return_failure;
+	}
+
+	if ((samples = checked_c.malloc(sizeof(int16_t) * blocks_length)) == NULL ||
+	    (aux = checked_c.malloc(sizeof(int16_t) * (blocks_length + 1))) == NULL ||
+	    (coefficients = checked_c.malloc(sizeof(int16_t) * sCoefficientsNo(blocks_length))) == NULL ||
+	    (compressed = checked_c.malloc(sizeof(int16_t) * blocks_length)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Iterate blocks
+	for (size_t b = 0; b < blocks_no; b++)
+	{
+		const int16_t* in = input + blocks_length * b;
+		const size_t block_length = sMin(blocks_length, length - blocks_length * b);
+
+		struct akoSignalBlockHead head = {0};
+		head.size = (uint32_t)(block_length * sizeof(int16_t));
+		head.compression = AKO_COMPRESSION_NONE;
+
+		const uint8_t* from = (const uint8_t*)in;
+
+		// Lift and compress, or leave samples as they are if that doesn't pay off
+		if (checked_s.compression != AKO_COMPRESSION_NONE)
+		{
+			size_t coefficients_no = block_length;
+			const int16_t* to_compress = in;
+
+			if (checked_s.wavelet != AKO_WAVELET_NONE)
+			{
+				for (size_t i = 0; i < block_length; i++)
+					samples[i] = in[i];
+
+				sLift(checked_s.wavelet, checked_s.wrap, block_length, samples, aux, coefficients);
+				coefficients_no = sCoefficientsNo(block_length);
+				to_compress = coefficients;
+			}
+
+			int codeable = 1;
+			for (size_t i = 0; i < coefficients_no && codeable != 0; i++)
+				codeable = (to_compress[i] != INT16_MIN);
+
+			const size_t compressed_size =
+			    (codeable != 0) ? akoKagariEncode(coefficients_no * sizeof(int16_t), block_length * sizeof(int16_t),
+			                                      to_compress, compressed)
+			                    : 0;
+
+			if (compressed_size != 0 && compressed_size < block_length * sizeof(int16_t))
+			{
+				head.size = (uint32_t)compressed_size;
+				head.compression = checked_s.compression;
+				from = compressed;
+			}
+		}
+
+		// Make space
+		uint8_t* updated_blob = checked_c.realloc(blob, blob_size + sizeof(struct akoSignalBlockHead) + head.size);
+		if (updated_blob == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+
+		blob = updated_blob;
+
+		// Block head and data, bytewise as the blob offers no alignment
+		for (size_t i = 0; i < sizeof(struct akoSignalBlockHead); i++)
+			blob[blob_size + i] = ((const uint8_t*)&head)[i];
+
+		blob_size += sizeof(struct akoSignalBlockHead);
+
+		for (size_t i = 0; i < head.size; i++)
+			blob[blob_size + i] = from[i];
+
+		blob_size += head.size; // Update blob
+	}
+
+	// Bye!
+	checked_c.free(samples);
+	checked_c.free(aux);
+	checked_c.free(coefficients);
+	checked_c.free(compressed);
+
+	*output = blob;
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return blob_size;
+
+return_failure:
+	if (samples != NULL)
+		checked_c.free(samples);
+	if (aux != NULL)
+		checked_c.free(aux);
+	if (coefficients != NULL)
+		checked_c.free(coefficients);
+	if (compressed != NULL)
+		checked_c.free(compressed);
+	if (blob != NULL)
+		checked_c.free(blob);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return 0;
+}
+
+
+static enum akoStatus sDecodeBlock(const struct akoSettings* s, size_t block_length,
+                                   const struct akoSignalBlockHead* head, const uint8_t* in, int16_t* coefficients,
+                                   int16_t* aux, int16_t* out)
+{
+	if (head->compression == AKO_COMPRESSION_NONE)
+	{
+		if (head->size != block_length * sizeof(int16_t))
+			return AKO_BROKEN_INPUT;
+
+		for (size_t i = 0; i < head->size; i++)
+			((uint8_t*)out)[i] = in[i];
+
+		return AKO_OK;
+	}
+
+	if (head->compression != s->compression)
+		return AKO_BROKEN_INPUT;
+
+	const size_t coefficients_no = (s->wavelet != AKO_WAVELET_NONE) ? sCoefficientsNo(block_length) : block_length;
+	int16_t* to = (s->wavelet != AKO_WAVELET_NONE) ? coefficients : out;
+
+	if (akoKagariDecode(coefficients_no, head->size, coefficients_no * sizeof(int16_t), in, to) != head->size)
+		return AKO_BROKEN_INPUT;
+
+	if (s->wavelet != AKO_WAVELET_NONE)
+		sUnlift(s->wavelet, s->wrap, block_length, coefficients, aux, out);
+
+	return AKO_OK;
+}
+
+
+AKO_EXPORT int16_t* akoDecodeSignalExt(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                       size_t from, size_t length, struct akoSettings* out_s, size_t* out_length,
+                                       size_t* out_total_length, enum akoStatus* out_status)
+{
+	struct akoSettings s = {0};
+	enum akoStatus status;
+
+	size_t total_length;
+
+	int16_t* signal = NULL;
+	int16_t* coefficients = NULL;
+	int16_t* aux = NULL;
+	int16_t* scratch = NULL;
+
+	const uint8_t* blob = input;
+	const uint8_t* end = (const uint8_t*)input + input_size;
+
+	// Check callbacks and input
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
+
+	if (akoCallbacksCanAllocate(&checked_c) == 0 || checked_c.workarea != NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	if (input == NULL)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	// Read head
+	if (input_size < sizeof(struct akoSignalHead))
+	{
+		status = AKO_BROKEN_INPUT;
+		goto return_failure;
+	}
+
+	if ((status = akoSignalHeadRead(blob, &total_length, &s)) != AKO_OK)
+		goto return_failure;
+
+	blob += sizeof(struct akoSignalHead); // Update blob
+
+	if (from >= total_length)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	length = (length == 0 || length > total_length - from) ? (total_length - from) : length;
+
+	// Check limits, before allocating. Every block has a head, and
+	// Rle can't pack too many samples in a byte (see sCheckLimits())
+	const size_t blocks_length = (s.tiles_dimension != 0) ? sMin(s.tiles_dimension, total_length) : total_length;
+	const size_t blocks_no = total_length / blocks_length + ((total_length % blocks_length != 0) ? 1 : 0);
+
+	if (checked_c.max_pixels != 0 && length > checked_c.max_pixels)
+	{
+		status = AKO_LIMITS_EXCEEDED;
+		goto return_failure;
+	}
+
+	if (blocks_no * sizeof(struct akoSignalBlockHead) + total_length / (AKO_ELIAS_MAX * 2) > (size_t)(end - blob))
+	{
+		status = AKO_BROKEN_INPUT;
+		goto return_failure;
+	}
+
+	const size_t memory = sizeof(int16_t) * (length + sCoefficientsNo(blocks_length) + blocks_length * 2 + 1);
+	if (checked_c.max_memory != 0 && memory > checked_c.max_memory)
+	{
+		status = AKO_LIMITS_EXCEEDED;
+		goto return_failure;
+	}
+
+	// Allocate
+	if ((signal = checked_c.malloc(sizeof(int16_t) * length)) == NULL ||
+	    (coefficients = checked_c.malloc(sizeof(int16_t) * sCoefficientsNo(blocks_length))) == NULL ||
+	    (aux = checked_c.malloc(sizeof(int16_t) * (blocks_length + 1))) == NULL ||
+	    (scratch = checked_c.malloc(sizeof(int16_t) * blocks_length)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Iterate blocks, skipping those before 'from'
+	for (size_t b = 0; b < blocks_no; b++)
+	{
+		const size_t block_start = blocks_length * b;
+		const size_t block_length = sMin(blocks_length, total_length - block_start);
+
+		if (block_start >= from + length)
+			break;
+
+		struct akoSignalBlockHead head;
+
+		if (sizeof(struct akoSignalBlockHead) > (size_t)(end - blob))
+		{
+			status = AKO_BROKEN_INPUT;
+			goto return_failure;
+		}
+
+		for (size_t i = 0; i < sizeof(struct akoSignalBlockHead); i++)
+			((uint8_t*)&head)[i] = blob[i];
+
+		blob += sizeof(struct akoSignalBlockHead); // Update blob
+
+		if (head.size > (size_t)(end - blob))
+		{
+			status = AKO_BROKEN_INPUT;
+			goto return_failure;
+		}
+
+		if (block_start + block_length > from)
+		{
+			// Whole blocks decode in place, partial ones need a copy
+			const size_t a = (from > block_start) ? from : block_start;
+			const size_t z = sMin(from + length, block_start + block_length);
+			const int whole = (a == block_start && z == block_start + block_length);
+
+			if ((status = sDecodeBlock(&s, block_length, &head, blob, coefficients, aux,
+			                           (whole != 0) ? (signal + (block_start - from)) : scratch)) != AKO_OK)
+				goto return_failure;
+
+			if (whole == 0)
+			{
+				for (size_t i = a; i < z; i++)
+					signal[i - from] = scratch[i - block_start];
+			}
+		}
+
+		blob += head.size; // Update blob
+	}
+
+	// Bye!
+	checked_c.free(coefficients);
+	checked_c.free(aux);
+	checked_c.free(scratch);
+
+	if (out_s != NULL)
+	{
+		*out_s = akoDefaultSettings();
+		out_s->wrap = s.wrap;
+		out_s->wavelet = s.wavelet;
+		out_s->compression = s.compression;
+		out_s->tiles_dimension = s.tiles_dimension;
+		out_s->quantization = 0;
+	}
+
+	if (out_length != NULL)
+		*out_length = length;
+	if (out_total_length != NULL)
+		*out_total_length = total_length;
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return signal;
+
+return_failure:
+	if (signal != NULL)
+		checked_c.free(signal);
+	if (coefficients != NULL)
+		checked_c.free(coefficients);
+	if (aux != NULL)
+		checked_c.free(aux);
+	if (scratch != NULL)
+		checked_c.free(scratch);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return NULL;
+}
@@ -0,0 +1,146 @@
+/*
+
+MIT License
+
+Copyright (c) 2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#include "ako-private.h"
+
+#if (AKO_FREESTANDING == 0)
+#include <time.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+static inline void sAdd(uint64_t* shared, uint64_t value)
+{
+	if (value == 0)
+		return; // Spare a bus lock
+
+#if defined(_MSC_VER)
+	_InterlockedExchangeAdd64((volatile __int64*)shared, (__int64)value);
+#else
+	__atomic_fetch_add(shared, value, __ATOMIC_RELAXED);
+#endif
+}
+
+
+static inline uint64_t sLoad(const uint64_t* shared)
+{
+#if defined(_MSC_VER)
+	return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)shared, 0, 0);
+#else
+	return __atomic_load_n(shared, __ATOMIC_RELAXED);
+#endif
+}
+
+
+static inline void sStore(uint64_t* shared, uint64_t value)
+{
+#if defined(_MSC_VER)
+	_InterlockedExchange64((volatile __int64*)shared, (__int64)value);
+#else
+	__atomic_store_n(shared, value, __ATOMIC_RELAXED);
+#endif
+}
+
+
+uint64_t akoStatsClock(const struct akoStats* enabled)
+{
+	// Nanoseconds, only meaningful as a difference
+#if (AKO_FREESTANDING == 0)
+	if (enabled == NULL)
+		return 0;
+
+	struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+	timespec_get(&ts, TIME_UTC);
+#endif
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#else
+	(void)enabled;
+	return 0;
+#endif
+}
+
+
+void akoStatsAdd(struct akoStats* shared, const struct akoStats* local)
+{
+	// Calls accumulate on their own stack, here is the only place where
+	// threads meet. Fields are independent, readers may see a call half added
+	if (shared == NULL)
+		return;
+
+	sAdd(&shared->encodes, local->encodes);
+	sAdd(&shared->decodes, local->decodes);
+	sAdd(&shared->failures, local->failures);
+
+	sAdd(&shared->tiles, local->tiles);
+	sAdd(&shared->pixels, local->pixels);
+	sAdd(&shared->image_bytes, local->image_bytes);
+	sAdd(&shared->blob_bytes, local->blob_bytes);
+
+	sAdd(&shared->format_ns, local->format_ns);
+	sAdd(&shared->wavelet_ns, local->wavelet_ns);
+	sAdd(&shared->compression_ns, local->compression_ns);
+}
+
+
+AKO_EXPORT void akoStatsRead(const struct akoStats* stats, struct akoStats* out)
+{
+	out->encodes = sLoad(&stats->encodes);
+	out->decodes = sLoad(&stats->decodes);
+	out->failures = sLoad(&stats->failures);
+
+	out->tiles = sLoad(&stats->tiles);
+	out->pixels = sLoad(&stats->pixels);
+	out->image_bytes = sLoad(&stats->image_bytes);
+	out->blob_bytes = sLoad(&stats->blob_bytes);
+
+	out->format_ns = sLoad(&stats->format_ns);
+	out->wavelet_ns = sLoad(&stats->wavelet_ns);
+	out->compression_ns = sLoad(&stats->compression_ns);
+}
+
+
+AKO_EXPORT void akoStatsReset(struct akoStats* stats)
+{
+	sStore(&stats->encodes, 0);
+	sStore(&stats->decodes, 0);
+	sStore(&stats->failures, 0);
+
+	sStore(&stats->tiles, 0);
+	sStore(&stats->pixels, 0);
+	sStore(&stats->image_bytes, 0);
+	sStore(&stats->blob_bytes, 0);
+
+	sStore(&stats->format_ns, 0);
+	sStore(&stats->wavelet_ns, 0);
+	sStore(&stats->compression_ns, 0);
+}
@@ -0,0 +1,121 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ako-private.h"
+
+
+void akoSummaryStart(struct akoSummaryGrid* grid, struct akoSummary* out)
+{
+	for (size_t i = 0; i < AKO_SUMMARY_GRID * AKO_SUMMARY_GRID; i++)
+		grid->sum[i] = 0;
+
+	for (size_t ch = 0; ch < AKO_MAX_CHANNELS; ch++)
+	{
+		for (size_t i = 0; i < 256; i++)
+			out->histogram[ch][i] = 0;
+
+		out->average[ch] = 0;
+	}
+
+	out->fingerprint = 0;
+}
+
+
+void akoSummaryTile(size_t channels, size_t tile_x, size_t tile_y, size_t tile_w, size_t tile_h, size_t image_w,
+                    size_t image_h, const uint8_t* in, struct akoSummaryGrid* grid, struct akoSummary* out)
+{
+	// Called right after formatting a tile, so its pixels are still in cache.
+	// Luma, for the fingerprint, is a cheap (R + 2G + B) / 4 times four
+	for (size_t y = tile_y; y < tile_y + tile_h; y++)
+	{
+		const uint8_t* row = in + (y * image_w + tile_x) * channels;
+		uint64_t* cells = grid->sum + ((y * AKO_SUMMARY_GRID) / image_h) * AKO_SUMMARY_GRID;
+
+		// In runs of pixels falling in the same cell
+		for (size_t x = tile_x; x < tile_x + tile_w;)
+		{
+			const size_t cell = (x * AKO_SUMMARY_GRID) / image_w;
+			size_t end = ((cell + 1) * image_w + AKO_SUMMARY_GRID - 1) / AKO_SUMMARY_GRID;
+			end = (end < tile_x + tile_w) ? end : (tile_x + tile_w);
+
+			uint64_t luma = 0;
+
+			for (; x < end; x++)
+			{
+				const uint8_t* pixel = row + (x - tile_x) * channels;
+
+				for (size_t ch = 0; ch < channels; ch++)
+					out->histogram[ch][pixel[ch]] += 1;
+
+				luma += (channels >= 3) ? ((uint32_t)pixel[0] + (uint32_t)pixel[1] * 2 + pixel[2])
+				                        : ((uint32_t)pixel[0] * 4);
+			}
+
+			cells[cell] += luma;
+		}
+	}
+}
+
+
+void akoSummaryFinish(size_t channels, size_t image_w, size_t image_h, const struct akoSummaryGrid* grid,
+                      struct akoSummary* out)
+{
+	const uint64_t pixels = (uint64_t)image_w * (uint64_t)image_h;
+
+	// Averages, from histograms
+	for (size_t ch = 0; ch < channels; ch++)
+	{
+		uint64_t sum = 0;
+		for (size_t i = 0; i < 256; i++)
+			sum += out->histogram[ch][i] * i;
+
+		out->average[ch] = (uint8_t)((sum + pixels / 2) / pixels);
+	}
+
+	// Fingerprint, one bit per cell brighter than the image. Images smaller
+	// than the grid leave cells empty, these count as not brighter
+	uint64_t columns[AKO_SUMMARY_GRID] = {0};
+	uint64_t rows[AKO_SUMMARY_GRID] = {0};
+	uint64_t total = 0;
+
+	for (size_t x = 0; x < image_w; x++)
+		columns[(x * AKO_SUMMARY_GRID) / image_w] += 1;
+	for (size_t y = 0; y < image_h; y++)
+		rows[(y * AKO_SUMMARY_GRID) / image_h] += 1;
+
+	for (size_t i = 0; i < AKO_SUMMARY_GRID * AKO_SUMMARY_GRID; i++)
+		total += grid->sum[i];
+
+	const double mean = (double)total / (double)pixels;
+
+	for (size_t i = 0; i < AKO_SUMMARY_GRID * AKO_SUMMARY_GRID; i++)
+	{
+		const uint64_t cell_pixels = rows[i / AKO_SUMMARY_GRID] * columns[i % AKO_SUMMARY_GRID];
+
+		if (cell_pixels != 0 && (double)grid->sum[i] / (double)cell_pixels > mean)
+			out->fingerprint |= (uint64_t)1 << i;
+	}
+}
@@ -0,0 +1,643 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ako-private.h"
+
+
+// A brick is a tile repeated along 'bricks_depth' slices. Taking every slice as a row of
+// a plane, vertical kernels lift them along that axis; what comes out are planes again
+// (lowpasses and highpasses between slices) that go through akoLift() and akoCompress()
+// as any tile does. Bricks start with an akoBlockHead, so decoders can skip them.
+
+#define LEVELS_MAX 64 // Halving a size_t takes fewer steps
+
+
+static inline size_t sMin(size_t a, size_t b)
+{
+	return (a < b) ? a : b;
+}
+
+
+static inline int sMulOverflows(size_t a, size_t b)
+{
+	return (a != 0 && b > SIZE_MAX / a);
+}
+
+
+static inline void sCopy(size_t no, const int16_t* in, int16_t* out)
+{
+	for (size_t i = 0; i < no; i++)
+		out[i] = in[i];
+}
+
+
+static size_t sPlanesNo(size_t depth)
+{
+	// Coarsest lowpass, plus all highpasses, as akoDividePlusOneRule() says
+	size_t no = 0;
+
+	for (; depth > 2; depth = akoDividePlusOneRule(depth))
+		no += akoDividePlusOneRule(depth);
+
+	return no + depth;
+}
+
+
+static void sLiftZ(enum akoWavelet wavelet, enum akoWrap wrap, size_t plane, size_t depth, int16_t* in,
+                   int16_t* aux, int16_t* out)
+{
+	// Coarsest lowpass first, finest highpass last. On odd depths last slice
+	// repeats, as last rows and columns in images do. Destroys 'in'
+	size_t end = sPlanesNo(depth);
+
+	while (depth > 2)
+	{
+		const size_t target = akoDividePlusOneRule(depth);
+
+		if (target * 2 != depth)
+			sCopy(plane, in + plane * (depth - 1), in + plane * depth);
+
+		if (wavelet == AKO_WAVELET_HAAR)
+			akoHaarLiftV(plane, target, in, aux);
+		else if (wavelet == AKO_WAVELET_CDF53 || target < 8)
+			akoCdf53LiftV(wrap, plane, target, in, aux);
+		else
+			akoDd137LiftV(wrap, plane, target, in, aux);
+
+		end -= target;
+		sCopy(plane * target, aux + plane * target, out + plane * end);
+		sCopy(plane * target, aux, in);
+
+		depth = target;
+	}
+
+	sCopy(plane * depth, in, out);
+}
+
+
+static void sUnliftZ(enum akoWavelet wavelet, enum akoWrap wrap, size_t plane, size_t depth, const int16_t* in,
+                     int16_t* aux, int16_t* out)
+{
+	// Inverse of above, evens and odds land in 'aux', then interleave into 'out'
+	size_t lengths[LEVELS_MAX];
+	size_t levels = 0;
+
+	for (size_t d = depth; d > 2; d = akoDividePlusOneRule(d))
+		lengths[levels++] = d;
+
+	const int16_t* lp = in;
+	size_t cursor = (levels != 0) ? akoDividePlusOneRule(lengths[levels - 1]) : depth;
+
+	for (size_t l = levels; l > 0; l--)
+	{
+		const size_t target = lengths[l - 1];
+		const size_t current = akoDividePlusOneRule(target);
+
+		int16_t* even = aux;
+		int16_t* odd = aux + plane * current;
+
+		if (wavelet == AKO_WAVELET_HAAR)
+			akoHaarInPlaceishUnliftV(plane, current, lp, in + plane * cursor, even, odd);
+		else if (wavelet == AKO_WAVELET_CDF53 || current < 8)
+			akoCdf53InPlaceishUnliftV(wrap, plane, current, lp, in + plane * cursor, even, odd);
+		else
+			akoDd137InPlaceishUnliftV(wrap, plane, current, lp, in + plane * cursor, even, odd);
+
+		for (size_t k = 0; k < current; k++)
+		{
+			sCopy(plane, even + plane * k, out + plane * (k * 2 + 0));
+			if (k * 2 + 1 < target) // Last one may be a repeated slice
+				sCopy(plane, odd + plane * k, out + plane * (k * 2 + 1));
+		}
+
+		cursor += current;
+		lp = out;
+	}
+
+	if (levels == 0)
+		sCopy(plane * depth, in, out);
+}
+
+
+AKO_EXPORT size_t akoEncodeVolumeExt(const struct akoCallbacks* c, const struct akoSettings* s, size_t bricks_depth,
+                                     size_t channels, size_t image_w, size_t image_h, size_t depth, const void* input,
+                                     void** output, enum akoStatus* out_status)
+{
+	enum akoStatus status;
+
+	uint8_t* blob = NULL;
+	size_t blob_size = sizeof(struct akoVolumeHead);
+
+	void* workarea_a = NULL;
+	void* workarea_b = NULL;
+	int16_t* slices = NULL;
+	int16_t* aux = NULL;
+	int16_t* planes = NULL;
+
+	// Check callbacks and input
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
+	struct akoSettings checked_s = (s != NULL) ? *s : akoDefaultSettings();
+
+	checked_s.order = AKO_ORDER_RASTER;
+	checked_s.code_blocks = 0;
+	checked_s.downscale = 0;
+	checked_s.target_psnr = 0.0F;
+
+	if (akoCallbacksCanAllocate(&checked_c) == 0 || checked_c.workarea != NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	if (input == NULL || output == NULL)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	// Allocate, head goes first
+	if ((blob = checked_c.malloc(sizeof(struct akoVolumeHead))) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	if ((status = akoVolumeHeadWrite(channels, image_w, image_h, depth, bricks_depth, &checked_s, blob)) != AKO_OK)
+		goto return_failure;
+
+	if (sMulOverflows(image_w, image_h) != 0 || sMulOverflows(image_w * image_h, depth) != 0 ||
+	    image_w * image_h * depth > SIZE_MAX / (channels * 16))
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	const size_t tiles_w = checked_s.tiles_dimension;
+	const size_t tiles_h = akoTilesHeight(&checked_s);
+	const size_t brick_d = (bricks_depth != 0) ? sMin(bricks_depth, depth) : depth;
+
+	const size_t tiles_no = akoImageTilesNo(image_w, image_h, tiles_w, tiles_h);
+	const size_t plane = akoTileDimension(0, image_w, tiles_w) * akoTileDimension(0, image_h, tiles_h) * channels;
+	const size_t tile_total_size = (akoImageMaxTileDataSize(image_w, image_h, tiles_w, tiles_h) +
+	                                akoImageMaxPlanesSpacingSize(image_w, image_h, tiles_w, tiles_h)) *
+	                               channels;
+
+	// Plus a block head, for tiles stored as they are
+	if ((workarea_a = checked_c.malloc(tile_total_size + sizeof(struct akoBlockHead))) == NULL ||
+	    (workarea_b = checked_c.malloc(tile_total_size + sizeof(struct akoBlockHead))) == NULL ||
+	    (slices = checked_c.malloc(sizeof(int16_t) * plane * (brick_d + 1))) == NULL ||
+	    (aux = checked_c.malloc(sizeof(int16_t) * plane * (brick_d + 1))) == NULL ||
+	    (planes = checked_c.malloc(sizeof(int16_t) * plane * sPlanesNo(brick_d))) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Iterate bricks, slices blocks then tiles
+	for (size_t z = 0; z < depth; z += brick_d)
+	{
+		const size_t d = sMin(brick_d, depth - z);
+
+		struct akoTilesIterator tiles;
+		akoTilesIteratorInit(AKO_ORDER_RASTER, image_w, image_h, tiles_w, tiles_h, &tiles);
+
+		for (size_t t = 0; t < tiles_no; t++)
+		{
+			size_t tile_x;
+			size_t tile_y;
+			akoTilesIteratorNext(&tiles, &tile_x, &tile_y);
+
+			const size_t tile_w = akoTileDimension(tile_x, image_w, tiles_w);
+			const size_t tile_h = akoTileDimension(tile_y, image_h, tiles_h);
+			const size_t tile_plane = tile_w * tile_h * channels;
+			const size_t planes_spacing = akoPlanesSpacing(tile_w, tile_h);
+
+			// 1. Format slices
+			for (size_t k = 0; k < d; k++)
+			{
+				const uint8_t* slice = (const uint8_t*)input + (z + k) * image_h * image_w * channels;
+				akoFormatToPlanarI16Yuv(checked_s.discard_non_visible, checked_s.color, channels, tile_w, tile_h,
+				                        image_w, 0, slice + (tile_y * image_w + tile_x) * channels,
+				                        slices + tile_plane * k);
+			}
+
+			// 2. Lift between slices
+			sLiftZ(checked_s.wavelet, checked_s.wrap, tile_plane, d, slices, aux, planes);
+
+			// 3. Lift and compress resulting planes, as tiles
+			const size_t brick_start = blob_size;
+			blob_size += sizeof(struct akoBlockHead);
+
+			for (size_t p = 0; p < sPlanesNo(d); p++)
+			{
+				for (size_t ch = 0; ch < channels; ch++)
+					sCopy(tile_w * tile_h, planes + tile_plane * p + tile_w * tile_h * ch,
+					      (int16_t*)workarea_a + (tile_w * tile_h + planes_spacing) * ch);
+
+				akoLift(p, &checked_s, channels, tile_w, tile_h, planes_spacing, 0, 1, workarea_a, workarea_b);
+
+				const uint8_t* from = workarea_b;
+				size_t size = akoTileDataSize(tile_w, tile_h) * channels;
+
+				if (checked_s.compression != AKO_COMPRESSION_NONE)
+				{
+					if ((size = akoCompress(checked_s.compression, 0, channels, tile_w, tile_h, workarea_b,
+					                        workarea_a)) == 0)
+					{
+						status = AKO_ERROR;
+						goto return_failure;
+					}
+
+					from = workarea_a;
+				}
+
+				// Make space (for brick head too, first time)
+				uint8_t* updated_blob = checked_c.realloc(blob, blob_size + size);
+				if (updated_blob == NULL)
+				{
+					status = AKO_NO_ENOUGH_MEMORY;
+					goto return_failure;
+				}
+
+				blob = updated_blob;
+
+				for (size_t i = 0; i < size; i++)
+					blob[blob_size + i] = from[i];
+
+				blob_size += size; // Update blob
+			}
+
+			// Brick head, bytewise as the blob offers no alignment
+			struct akoBlockHead head;
+			if (blob_size - brick_start - sizeof(struct akoBlockHead) > UINT32_MAX)
+			{
+				status = AKO_ERROR;
+				goto return_failure;
+			}
+
+			head.block_size = (uint32_t)(blob_size - brick_start - sizeof(struct akoBlockHead));
+
+			for (size_t i = 0; i < sizeof(struct akoBlockHead); i++)
+				blob[brick_start + i] = ((const uint8_t*)&head)[i];
+		}
+	}
+
+	// Bye!
+	checked_c.free(workarea_a);
+	checked_c.free(workarea_b);
+	checked_c.free(slices);
+	checked_c.free(aux);
+	checked_c.free(planes);
+
+	*output = blob;
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return blob_size;
+
+return_failure:
+	if (workarea_a != NULL)
+		checked_c.free(workarea_a);
+	if (workarea_b != NULL)
+		checked_c.free(workarea_b);
+	if (slices != NULL)
+		checked_c.free(slices);
+	if (aux != NULL)
+		checked_c.free(aux);
+	if (planes != NULL)
+		checked_c.free(planes);
+	if (blob != NULL)
+		checked_c.free(blob);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return 0;
+}
+
+
+static enum akoStatus sDecodeBrick(const struct akoSettings* s, size_t channels, size_t tile_w, size_t tile_h,
+                                   size_t depth, size_t input_size, const uint8_t* input, void* workarea_a,
+                                   void* workarea_b, int16_t* planes, int16_t* aux, int16_t* out)
+{
+	const size_t tile_plane = tile_w * tile_h * channels;
+	const size_t planes_spacing = akoPlanesSpacing(tile_w, tile_h);
+	const size_t tile_data_size = akoTileDataSize(tile_w, tile_h) * channels;
+
+	const uint8_t* end = input + input_size;
+
+	// Decompress and unlift planes
+	for (size_t p = 0; p < sPlanesNo(depth); p++)
+	{
+		if (s->compression != AKO_COMPRESSION_NONE)
+		{
+			const size_t compressed_size =
+			    akoDecompress(s->compression, 0, channels, tile_w, tile_h, tile_data_size,
+			                  tile_data_size + planes_spacing, (size_t)(end - input), input, workarea_a);
+
+			if (compressed_size == 0)
+				return AKO_BROKEN_INPUT;
+
+			input += compressed_size;
+		}
+		else
+		{
+			if (tile_data_size > (size_t)(end - input))
+				return AKO_BROKEN_INPUT;
+
+			for (size_t i = 0; i < tile_data_size; i++)
+				((uint8_t*)workarea_a)[i] = input[i];
+
+			input += tile_data_size;
+		}
+
+		akoUnlift(s, channels, p, tile_w, tile_h, planes_spacing, 0, workarea_a, workarea_b, NULL, NULL);
+
+		for (size_t ch = 0; ch < channels; ch++)
+			sCopy(tile_w * tile_h, (const int16_t*)workarea_b + (tile_w * tile_h + planes_spacing) * ch,
+			      planes + tile_plane * p + tile_w * tile_h * ch);
+	}
+
+	if (input != end)
+		return AKO_BROKEN_INPUT;
+
+	// Unlift between slices
+	sUnliftZ(s->wavelet, s->wrap, tile_plane, depth, planes, aux, out);
+	return AKO_OK;
+}
+
+
+AKO_EXPORT uint8_t* akoDecodeVolumeExt(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                       const struct akoBox* box, struct akoSettings* out_s, size_t* out_channels,
+                                       struct akoBox* out_box, enum akoStatus* out_status)
+{
+	struct akoSettings s = akoDefaultSettings();
+	enum akoStatus status;
+
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+	size_t depth;
+	size_t bricks_depth;
+
+	uint8_t* volume = NULL;
+	void* workarea_a = NULL;
+	void* workarea_b = NULL;
+	int16_t* slices = NULL;
+	int16_t* aux = NULL;
+	int16_t* planes = NULL;
+	uint8_t* scratch = NULL;
+
+	const uint8_t* blob = input;
+	const uint8_t* end = (const uint8_t*)input + input_size;
+
+	// Check callbacks and input
+	const struct akoCallbacks checked_c = akoCallbacksOrDefault(c);
+
+	if (akoCallbacksCanAllocate(&checked_c) == 0 || checked_c.workarea != NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	if (input == NULL)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	// Read head
+	if (input_size < sizeof(struct akoVolumeHead))
+	{
+		status = AKO_BROKEN_INPUT;
+		goto return_failure;
+	}
+
+	if ((status = akoVolumeHeadRead(blob, &channels, &image_w, &image_h, &depth, &bricks_depth, &s)) != AKO_OK)
+		goto return_failure;
+
+	blob += sizeof(struct akoVolumeHead); // Update blob
+
+	// What to decode
+	struct akoBox b = {0};
+	if (box != NULL)
+		b = *box;
+
+	if (b.x >= image_w || b.y >= image_h || b.z >= depth)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	b.width = (b.width == 0 || b.width > image_w - b.x) ? (image_w - b.x) : b.width;
+	b.height = (b.height == 0 || b.height > image_h - b.y) ? (image_h - b.y) : b.height;
+	b.depth = (b.depth == 0 || b.depth > depth - b.z) ? (depth - b.z) : b.depth;
+
+	// Check limits, before allocating
+	if (sMulOverflows(b.width, b.height) != 0 || sMulOverflows(b.width * b.height, b.depth) != 0 ||
+	    b.width * b.height * b.depth > SIZE_MAX / (channels * 16))
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	const size_t voxels = b.width * b.height * b.depth;
+
+	if (checked_c.max_pixels != 0 && voxels > checked_c.max_pixels)
+	{
+		status = AKO_LIMITS_EXCEEDED;
+		goto return_failure;
+	}
+
+	const size_t tiles_w = s.tiles_dimension;
+	const size_t tiles_h = akoTilesHeight(&s);
+	const size_t brick_d = (bricks_depth != 0) ? sMin(bricks_depth, depth) : depth;
+
+	const size_t tiles_no = akoImageTilesNo(image_w, image_h, tiles_w, tiles_h);
+	const size_t bricks_no = tiles_no * (depth / brick_d + ((depth % brick_d != 0) ? 1 : 0));
+
+	if (checked_c.max_tiles != 0 && bricks_no > checked_c.max_tiles)
+	{
+		status = AKO_LIMITS_EXCEEDED;
+		goto return_failure;
+	}
+
+	if (bricks_no > (size_t)(end - blob) / sizeof(struct akoBlockHead)) // Every brick has a head
+	{
+		status = AKO_BROKEN_INPUT;
+		goto return_failure;
+	}
+
+	const size_t plane = akoTileDimension(0, image_w, tiles_w) * akoTileDimension(0, image_h, tiles_h) * channels;
+	const size_t tile_total_size = (akoImageMaxTileDataSize(image_w, image_h, tiles_w, tiles_h) +
+	                                akoImageMaxPlanesSpacingSize(image_w, image_h, tiles_w, tiles_h)) *
+	                               channels;
+
+	const size_t slices_no = (brick_d + 1) * 2 + sPlanesNo(brick_d);
+	size_t memory = 0;
+
+	if (sMulOverflows(plane * sizeof(int16_t), slices_no) != 0 ||
+	    (memory = plane * sizeof(int16_t) * slices_no + voxels * channels + tile_total_size * 2 + plane) <
+	        voxels * channels)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	if (checked_c.max_memory != 0 && memory > checked_c.max_memory)
+	{
+		status = AKO_LIMITS_EXCEEDED;
+		goto return_failure;
+	}
+
+	// Allocate
+	if ((volume = checked_c.malloc(voxels * channels)) == NULL ||
+	    (workarea_a = checked_c.malloc(tile_total_size)) == NULL ||
+	    (workarea_b = checked_c.malloc(tile_total_size)) == NULL ||
+	    (slices = checked_c.malloc(sizeof(int16_t) * plane * (brick_d + 1))) == NULL ||
+	    (aux = checked_c.malloc(sizeof(int16_t) * plane * (brick_d + 1))) == NULL ||
+	    (planes = checked_c.malloc(sizeof(int16_t) * plane * sPlanesNo(brick_d))) == NULL ||
+	    (scratch = checked_c.malloc(plane)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Iterate bricks, skipping those not in the box
+	for (size_t z = 0; z < depth && z < b.z + b.depth; z += brick_d)
+	{
+		const size_t d = sMin(brick_d, depth - z);
+
+		struct akoTilesIterator tiles;
+		akoTilesIteratorInit(AKO_ORDER_RASTER, image_w, image_h, tiles_w, tiles_h, &tiles);
+
+		for (size_t t = 0; t < tiles_no; t++)
+		{
+			size_t tile_x;
+			size_t tile_y;
+			akoTilesIteratorNext(&tiles, &tile_x, &tile_y);
+
+			const size_t tile_w = akoTileDimension(tile_x, image_w, tiles_w);
+			const size_t tile_h = akoTileDimension(tile_y, image_h, tiles_h);
+
+			// Brick head
+			struct akoBlockHead head;
+
+			if (sizeof(struct akoBlockHead) > (size_t)(end - blob))
+			{
+				status = AKO_BROKEN_INPUT;
+				goto return_failure;
+			}
+
+			for (size_t i = 0; i < sizeof(struct akoBlockHead); i++)
+				((uint8_t*)&head)[i] = blob[i];
+
+			blob += sizeof(struct akoBlockHead); // Update blob
+
+			if (head.block_size > (size_t)(end - blob))
+			{
+				status = AKO_BROKEN_INPUT;
+				goto return_failure;
+			}
+
+			// Decode, if in the box
+			if (z + d > b.z && tile_x + tile_w > b.x && tile_x < b.x + b.width && tile_y + tile_h > b.y &&
+			    tile_y < b.y + b.height)
+			{
+				if ((status = sDecodeBrick(&s, channels, tile_w, tile_h, d, head.block_size, blob, workarea_a,
+				                           workarea_b, planes, aux, slices)) != AKO_OK)
+					goto return_failure;
+
+				// Format slices, copying what the box wants
+				const size_t x0 = (b.x > tile_x) ? b.x : tile_x;
+				const size_t y0 = (b.y > tile_y) ? b.y : tile_y;
+				const size_t x1 = sMin(b.x + b.width, tile_x + tile_w);
+				const size_t y1 = sMin(b.y + b.height, tile_y + tile_h);
+
+				for (size_t k = 0; k < d; k++)
+				{
+					if (z + k < b.z || z + k >= b.z + b.depth)
+						continue;
+
+					akoFormatToInterleavedU8Rgb(s.color, channels, tile_w, tile_h, 0, tile_w,
+					                            slices + tile_w * tile_h * channels * k, scratch);
+
+					for (size_t y = y0; y < y1; y++)
+					{
+						const uint8_t* from = scratch + ((y - tile_y) * tile_w + (x0 - tile_x)) * channels;
+						uint8_t* to =
+						    volume + (((z + k - b.z) * b.height + (y - b.y)) * b.width + (x0 - b.x)) * channels;
+
+						for (size_t i = 0; i < (x1 - x0) * channels; i++)
+							to[i] = from[i];
+					}
+				}
+			}
+
+			blob += head.block_size; // Update blob
+		}
+	}
+
+	// Bye!
+	checked_c.free(workarea_a);
+	checked_c.free(workarea_b);
+	checked_c.free(slices);
+	checked_c.free(aux);
+	checked_c.free(planes);
+	checked_c.free(scratch);
+
+	if (out_s != NULL)
+		*out_s = s;
+	if (out_channels != NULL)
+		*out_channels = channels;
+	if (out_box != NULL)
+		*out_box = b;
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return volume;
+
+return_failure:
+	if (volume != NULL)
+		checked_c.free(volume);
+	if (workarea_a != NULL)
+		checked_c.free(workarea_a);
+	if (workarea_b != NULL)
+		checked_c.free(workarea_b);
+	if (slices != NULL)
+		checked_c.free(slices);
+	if (aux != NULL)
+		checked_c.free(aux);
+	if (planes != NULL)
+		checked_c.free(planes);
+	if (scratch != NULL)
+		checked_c.free(scratch);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return NULL;
+}
@@ -0,0 +1,346 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+// Hostile inputs, all of them should be rejected before allocating memory, or
+// decode at a cost proportional to the pixels they claim (bounded by limits)
+
+#define ALLOCATOR_HEAD_SIZE 16
+
+static size_t s_allocations = 0;
+static size_t s_memory = 0;
+static size_t s_peak_memory = 0;
+
+static void* sMalloc(size_t size)
+{
+	uint8_t* ptr = malloc(size + ALLOCATOR_HEAD_SIZE);
+	if (ptr == NULL)
+		return NULL;
+
+	*(size_t*)ptr = size;
+	s_allocations++;
+	s_memory += size;
+	s_peak_memory = (s_memory > s_peak_memory) ? s_memory : s_peak_memory;
+
+	return ptr + ALLOCATOR_HEAD_SIZE;
+}
+
+static void sFree(void* ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	uint8_t* block = (uint8_t*)ptr - ALLOCATOR_HEAD_SIZE;
+	s_memory -= *(size_t*)block;
+	free(block);
+}
+
+static void* sRealloc(void* ptr, size_t size)
+{
+	void* new_ptr = sMalloc(size);
+	if (new_ptr != NULL && ptr != NULL)
+	{
+		const size_t old_size = *(size_t*)((uint8_t*)ptr - ALLOCATOR_HEAD_SIZE);
+		memcpy(new_ptr, ptr, (old_size < size) ? old_size : size);
+		sFree(ptr);
+	}
+
+	return new_ptr;
+}
+
+
+static struct akoCallbacks sCallbacks(size_t max_pixels, size_t max_tiles, size_t max_memory)
+{
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.malloc = sMalloc;
+	c.realloc = sRealloc;
+	c.free = sFree;
+
+	c.max_pixels = max_pixels;
+	c.max_tiles = max_tiles;
+	c.max_memory = max_memory;
+
+	return c;
+}
+
+
+static enum akoStatus sDecode(const struct akoCallbacks* c, size_t input_size, const void* input)
+{
+	enum akoStatus status = AKO_ERROR;
+
+	s_allocations = 0;
+	s_peak_memory = 0;
+
+	uint8_t* image = akoDecodeExt(c, input_size, input, NULL, NULL, NULL, NULL, &status);
+	sFree(image);
+
+	assert(s_memory == 0); // No leaks
+	assert((image != NULL) == (status == AKO_OK));
+	return status;
+}
+
+
+static size_t sCraft(size_t channels, size_t width, size_t height, size_t tiles_dimension, size_t payload_size,
+                     const void* payload, uint8_t* out)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.wavelet = AKO_WAVELET_CDF53;
+
+	assert(akoHeadWrite(channels, width, height, &s, 0, 0, out) == AKO_OK);
+
+	if (payload != NULL)
+		memcpy(out + sizeof(struct akoHead), payload, payload_size);
+	else
+		memset(out + sizeof(struct akoHead), 0, payload_size);
+
+	return sizeof(struct akoHead) + payload_size;
+}
+
+
+static size_t sCraftKagari(size_t width, size_t height, const int16_t* coefficients, uint8_t* out)
+{
+	// One gray untiled image, with 'coefficients' compressed as they are
+	const size_t data_size = akoTileDataSize(width, height);
+
+	struct akoBlockHead* block_head = (struct akoBlockHead*)(out + sizeof(struct akoHead));
+	uint8_t* stream = out + sizeof(struct akoHead) + sizeof(struct akoBlockHead);
+
+	const size_t stream_size = akoKagariEncode(data_size, data_size * 4, coefficients, stream);
+	assert(stream_size != 0);
+
+	block_head->block_size = (uint32_t)stream_size;
+	sCraft(1, width, height, 0, sizeof(struct akoBlockHead) + stream_size, out + sizeof(struct akoHead), out);
+
+	return sizeof(struct akoHead) + sizeof(struct akoBlockHead) + stream_size;
+}
+
+
+static double sNanosecondsPerPixel(const struct akoCallbacks* c, size_t width, size_t height, size_t input_size,
+                                   const void* input)
+{
+	size_t runs = 0;
+	const clock_t start = clock();
+	clock_t end;
+
+	do
+	{
+		assert(sDecode(c, input_size, input) == AKO_OK);
+		runs++;
+	} while ((end = clock()) - start < CLOCKS_PER_SEC / 20);
+
+	return ((double)(end - start) / (double)CLOCKS_PER_SEC) * 1000000000.0 / (double)(runs * width * height);
+}
+
+
+static void sHeadersTest(uint8_t* buffer)
+{
+	const struct akoCallbacks c = sCallbacks(0, 0, 0);
+	const struct akoCallbacks capped = sCallbacks(4096 * 4096, 1024, 256 * 1024 * 1024);
+	size_t size;
+
+	// Maximum dimensions, no data
+	size = sCraft(4, 0xFFFFFFFF, 0xFFFFFFFF, 0, 64, NULL, buffer);
+	printf("Max dimensions, 4 channels: %s\n", akoStatusString(sDecode(&c, size, buffer)));
+	assert(s_allocations == 0);
+
+	size = sCraft(1, 0xFFFFFFFF, 0xFFFFFFFF, 0, 64, NULL, buffer);
+	printf("Max dimensions, 1 channel: %s\n", akoStatusString(sDecode(&c, size, buffer)));
+	assert(s_allocations == 0);
+
+	size = sCraft(1, 65535, 65535, 0, 64, NULL, buffer);
+	assert(sDecode(&c, size, buffer) == AKO_BROKEN_INPUT);
+	assert(s_allocations == 0);
+
+	// Many tiny tiles, no data
+	size = sCraft(3, 65536, 65536, 8, 4096, NULL, buffer);
+	assert(sDecode(&c, size, buffer) == AKO_BROKEN_INPUT);
+	assert(s_allocations == 0);
+
+	// Limits
+	size = sCraft(1, 4097, 4096, 0, 4096, NULL, buffer);
+	assert(sDecode(&capped, size, buffer) == AKO_LIMITS_EXCEEDED);
+	assert(s_allocations == 0);
+
+	size = sCraft(1, 1024, 1024, 16, 4096, NULL, buffer);
+	assert(sDecode(&capped, size, buffer) == AKO_LIMITS_EXCEEDED); // 4096 tiles
+	assert(s_allocations == 0);
+
+	size = sCraft(16, 4096, 4096, 0, 4096, NULL, buffer);
+	assert(sDecode(&capped, size, buffer) == AKO_LIMITS_EXCEEDED); // Some GB
+	assert(s_allocations == 0);
+
+	// Truncated heads
+	for (size_t i = 0; i < sizeof(struct akoHead); i++)
+	{
+		assert(sDecode(&c, i, buffer) != AKO_OK);
+		assert(s_allocations == 0);
+	}
+
+	printf("Headers test: Ok\n");
+}
+
+
+static void sStreamsTest(uint8_t* buffer, int16_t* coefficients)
+{
+	const struct akoCallbacks c = sCallbacks(0, 0, 0);
+	const size_t width = 512;
+	const size_t height = 512;
+	const size_t values_no = akoTileDataSize(width, height) / sizeof(int16_t);
+	size_t size;
+
+	// Maximum Elias codes, never repeating so Rle doesn't kick in
+	for (size_t i = 0; i < values_no; i++)
+		coefficients[i] = (i % 2 == 0) ? 32767 : -32767;
+
+	size = sCraftKagari(width, height, coefficients, buffer);
+	printf("Max Elias codes, %zu bytes: %s\n", size, akoStatusString(sDecode(&c, size, buffer)));
+	assert(s_peak_memory < width * height * 8);
+
+	// Maximum Rle lengths
+	for (size_t i = 0; i < values_no; i++)
+		coefficients[i] = 0;
+
+	size = sCraftKagari(width, height, coefficients, buffer);
+	printf("Max Rle lengths, %zu bytes: %s\n", size, akoStatusString(sDecode(&c, size, buffer)));
+	assert(s_peak_memory < width * height * 8);
+
+	// Rle longer than the tile
+	{
+		struct akoEliasState e = {0};
+		uint8_t* stream = buffer + sizeof(struct akoHead) + sizeof(struct akoBlockHead);
+		uint8_t* cursor = stream;
+
+		for (int i = 0; i < 3; i++)
+			assert(akoEliasEncodeStep(&e, 1, &cursor, stream + 1024) != 0); // Three zeros...
+		assert(akoEliasEncodeStep(&e, AKO_ELIAS_MAX, &cursor, stream + 1024) != 0); // ...and a long Rle
+
+		const size_t stream_size = akoEliasEncodeEnd(&e, &cursor, stream + 1024, stream);
+		((struct akoBlockHead*)(buffer + sizeof(struct akoHead)))->block_size = (uint32_t)stream_size;
+
+		size = sCraft(1, 16, 16, 0, sizeof(struct akoBlockHead) + stream_size, buffer + sizeof(struct akoHead),
+		              buffer);
+		assert(sDecode(&c, size, buffer) == AKO_BROKEN_INPUT);
+	}
+
+	// Only zeros, longer than any valid Elias code
+	size = sCraft(1, width, height, 0, 4096, NULL, buffer);
+	((struct akoBlockHead*)(buffer + sizeof(struct akoHead)))->block_size = 4096 - sizeof(struct akoBlockHead);
+	assert(sDecode(&c, size, buffer) == AKO_BROKEN_INPUT);
+
+	// Block size beyond input
+	size = sCraft(1, width, height, 0, 4096, NULL, buffer);
+	((struct akoBlockHead*)(buffer + sizeof(struct akoHead)))->block_size = 0xFFFFFFFF;
+	assert(sDecode(&c, size, buffer) == AKO_BROKEN_INPUT);
+
+	printf("Streams test: Ok\n");
+}
+
+
+static void sFuzzTest(uint8_t* buffer, uint8_t* image, size_t code_blocks, float time_budget)
+{
+	const struct akoCallbacks c = sCallbacks(1024 * 1024, 4096, 64 * 1024 * 1024);
+	const size_t width = 67;
+	const size_t height = 45;
+	uint32_t x = 666;
+
+	for (size_t i = 0; i < width * height * 3; i++)
+		image[i] = (uint8_t)((i * 7) ^ (i >> 5));
+
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = 32;
+	s.code_blocks = code_blocks;
+	s.quantization = 0;
+
+	struct akoCallbacks encode_c = akoDefaultCallbacks();
+	encode_c.time_budget = time_budget; // A tiny one mixes wavelets between tiles
+
+	void* blob = NULL;
+	const size_t blob_size = akoEncodeExt(&encode_c, &s, 3, width, height, image, &blob, NULL);
+	assert(blob_size != 0);
+
+	// Unknown wavelet in a tile head
+	if (time_budget > 0.0F)
+	{
+		memcpy(buffer, blob, blob_size);
+		((struct akoTileHead*)(buffer + sizeof(struct akoHead)))->wavelet = AKO_WAVELET_NONE;
+		assert(sDecode(&c, blob_size, buffer) == AKO_BROKEN_INPUT);
+	}
+
+	// Truncated, on every possible size
+	for (size_t i = 0; i < blob_size; i++)
+		sDecode(&c, i, blob);
+
+	assert(sDecode(&c, blob_size, blob) == AKO_OK);
+
+	// Random bit flips
+	for (size_t i = 0; i < 4096; i++)
+	{
+		memcpy(buffer, blob, blob_size);
+
+		for (int f = 0; f < 4; f++)
+		{
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			buffer[x % blob_size] ^= (uint8_t)(1 << (x >> 29));
+		}
+
+		sDecode(&c, blob_size, buffer);
+	}
+
+	akoDefaultFree(blob);
+	printf("Fuzz test, code-blocks: %zu, time budget: %.3f ms: Ok\n", code_blocks, (double)time_budget);
+}
+
+
+static void sLinearityTest(uint8_t* buffer, int16_t* coefficients)
+{
+	// Decoding the worst stream should take the same time per pixel, whatever the size
+	const struct akoCallbacks c = sCallbacks(0, 0, 0);
+	double first = 0.0;
+
+	for (size_t d = 128; d <= 1024; d <<= 1)
+	{
+		for (size_t i = 0; i < akoTileDataSize(d, d) / sizeof(int16_t); i++)
+			coefficients[i] = (i % 2 == 0) ? 32767 : -32767;
+
+		const size_t size = sCraftKagari(d, d, coefficients, buffer);
+		const double ns = sNanosecondsPerPixel(&c, d, d, size, buffer);
+
+		printf("Linearity, %zux%zu px: %.2f ns per pixel\n", d, d, ns);
+
+		if (d == 128)
+			first = ns;
+		else
+			assert(ns < first * 4.0); // Generous, as we don't control the machine
+	}
+
+	printf("Linearity test: Ok\n");
+}
+
+
+int main()
+{
+	const size_t buffer_size = akoTileDataSize(1024, 1024) * 4 + 4096;
+
+	uint8_t* buffer = malloc(buffer_size);
+	int16_t* coefficients = malloc(akoTileDataSize(1024, 1024));
+	assert(buffer != NULL && coefficients != NULL);
+
+	sHeadersTest(buffer);
+	sStreamsTest(buffer, coefficients);
+	sFuzzTest(buffer, (uint8_t*)coefficients, 0, 0.0F);
+	sFuzzTest(buffer, (uint8_t*)coefficients, 8, 0.0F);
+	sFuzzTest(buffer, (uint8_t*)coefficients, 0, 0.001F);
+	sLinearityTest(buffer, coefficients);
+
+	free(buffer);
+	free(coefficients);
+	return 0;
+}
@@ -0,0 +1,78 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void sTest(size_t channels, size_t width, size_t height, size_t tiles_dimension, enum akoWavelet wavelet,
+                  enum akoWrap wrap, int quantization)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.quantization = quantization;
+	s.gate = 0;
+	s.wavelet = wavelet;
+	s.wrap = wrap;
+
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	for (size_t i = 0; i < width * height * channels; i++)
+		image[i] = (uint8_t)((i % 251) ^ (i / (width * channels)));
+
+	// Encode with callbacks, here tiles lift in batches
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeExt(NULL, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	printf("%zux%zu px, %zu channels, tiles: %zu, wavelet: %i, wrap: %i, q: %i, blob: %zu bytes\n", width, height,
+	       channels, tiles_dimension, (int)wavelet, (int)wrap, quantization, blob_size);
+
+	// Using a workarea they lift one by one, output should be identical
+	{
+		struct akoCallbacks c = akoDefaultCallbacks();
+		c.workarea_size = akoEncodeWorkareaSize(&s, channels, width, height);
+		c.workarea = malloc(c.workarea_size);
+		assert(c.workarea_size != 0 && c.workarea != NULL);
+
+		void* reference_blob = NULL;
+		const size_t reference_size =
+		    akoEncodeExt(&c, &s, channels, width, height, image, &reference_blob, &status);
+
+		assert(status == AKO_OK && reference_size == blob_size);
+		assert(memcmp(reference_blob, blob, blob_size) == 0);
+		free(c.workarea);
+	}
+
+	// Decode
+	if (quantization == 0)
+	{
+		uint8_t* decoded = akoDecodeExt(NULL, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+		assert(status == AKO_OK && decoded != NULL);
+		assert(memcmp(decoded, image, width * height * channels) == 0); // Lossless
+		akoDefaultFree(decoded);
+	}
+
+	// Bye!
+	akoDefaultFree(blob);
+	free(image);
+}
+
+
+int main()
+{
+	sTest(1, 64, 64, 8, AKO_WAVELET_DD137, AKO_WRAP_CLAMP, 0);
+	sTest(3, 128, 128, 16, AKO_WAVELET_DD137, AKO_WRAP_MIRROR, 0);
+	sTest(4, 256, 128, 32, AKO_WAVELET_DD137, AKO_WRAP_REPEAT, 0);
+	sTest(2, 100, 70, 8, AKO_WAVELET_CDF53, AKO_WRAP_ZERO, 0); // Border tiles go one by one
+	sTest(3, 300, 200, 16, AKO_WAVELET_CDF53, AKO_WRAP_CLAMP, 0);
+	sTest(3, 300, 200, 32, AKO_WAVELET_HAAR, AKO_WRAP_CLAMP, 0);
+	sTest(3, 320, 240, 16, AKO_WAVELET_DD137, AKO_WRAP_CLAMP, 16);
+	sTest(4, 333, 111, 32, AKO_WAVELET_CDF53, AKO_WRAP_MIRROR, 32);
+
+	return 0;
+}
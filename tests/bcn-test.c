@@ -0,0 +1,218 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void sUnpackColor(const uint8_t* block, int three_colors_allowed, uint8_t* out_rgb)
+{
+	const uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+	const uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+	const uint32_t indices = (uint32_t)(block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24));
+
+	int palette[4][3];
+	const uint16_t c[2] = {c0, c1};
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		const int r = (c[i] >> 11) & 31, g = (c[i] >> 5) & 63, b = c[i] & 31;
+		palette[i][0] = (r << 3) | (r >> 2);
+		palette[i][1] = (g << 2) | (g >> 4);
+		palette[i][2] = (b << 3) | (b >> 2);
+	}
+
+	for (size_t ch = 0; ch < 3; ch++)
+	{
+		if (c0 > c1 || three_colors_allowed == 0)
+		{
+			palette[2][ch] = (palette[0][ch] * 2 + palette[1][ch]) / 3;
+			palette[3][ch] = (palette[0][ch] + palette[1][ch] * 2) / 3;
+		}
+		else
+		{
+			palette[2][ch] = (palette[0][ch] + palette[1][ch]) / 2;
+			palette[3][ch] = 0;
+		}
+	}
+
+	for (size_t i = 0; i < 16; i++)
+		for (size_t ch = 0; ch < 3; ch++)
+			out_rgb[i * 3 + ch] = (uint8_t)palette[(indices >> (i * 2)) & 3][ch];
+}
+
+
+static void sUnpackSingle(const uint8_t* block, uint8_t* out)
+{
+	int values[8] = {block[0], block[1]};
+
+	for (int i = 2; i < 8; i++)
+		values[i] = (block[0] > block[1]) ? ((8 - i) * block[0] + (i - 1) * block[1]) / 7
+		                                  : ((i < 6) ? ((6 - i) * block[0] + (i - 1) * block[1]) / 5
+		                                             : (i == 6) ? 0 : 255);
+
+	uint64_t indices = 0;
+	for (size_t i = 0; i < 6; i++)
+		indices |= (uint64_t)block[2 + i] << (i * 8);
+
+	for (size_t i = 0; i < 16; i++)
+		out[i] = (uint8_t)values[(indices >> (i * 3)) & 7];
+}
+
+
+static double sTest(enum akoBcn format, size_t channels, size_t width, size_t height, size_t tiles_dimension)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.quantization = 0;
+
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	for (size_t y = 0; y < height; y++)
+		for (size_t x = 0; x < width; x++)
+			for (size_t ch = 0; ch < channels; ch++)
+				image[(y * width + x) * channels + ch] =
+				    (uint8_t)(127.0 + 120.0 * sin((double)(x * (ch + 1)) / 23.0 + (double)y / 17.0));
+
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeExt(NULL, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK);
+
+	// Decode to blocks
+	size_t out_w, out_h, out_channels;
+	uint8_t* blocks =
+	    akoDecodeBcnExt(NULL, blob_size, blob, format, NULL, &out_channels, &out_w, &out_h, &status);
+	assert(status == AKO_OK && blocks != NULL);
+	assert(out_w == width && out_h == height && out_channels == channels);
+
+	// Unpack them, and compare with the image (lossless, so it is the same as decoded)
+	const size_t blocks_w = (width + 3) / 4;
+	const size_t block_size = akoBcnSize(format, 1, 1);
+	double error = 0.0;
+	size_t samples = 0;
+
+	for (size_t by = 0; by < (height + 3) / 4; by++)
+		for (size_t bx = 0; bx < blocks_w; bx++)
+		{
+			const uint8_t* block = blocks + (by * blocks_w + bx) * block_size;
+			uint8_t rgb[16 * 3];
+			uint8_t single[16];
+
+			if (format == AKO_BC1)
+				sUnpackColor(block, 1, rgb);
+			else if (format == AKO_BC3)
+			{
+				sUnpackSingle(block, single);
+				sUnpackColor(block + 8, 0, rgb);
+			}
+			else
+				sUnpackSingle(block, single);
+
+			for (size_t i = 0; i < 16; i++)
+			{
+				const size_t x = bx * 4 + i % 4;
+				const size_t y = by * 4 + i / 4;
+				if (x >= width || y >= height)
+					continue;
+
+				const uint8_t* pixel = image + (y * width + x) * channels;
+
+				if (format != AKO_BC4)
+				{
+					for (size_t ch = 0; ch < 3; ch++)
+					{
+						const double d = (double)rgb[i * 3 + ch] - (double)pixel[(channels >= 3) ? ch : 0];
+						error += d * d;
+						samples += 1;
+					}
+				}
+
+				if (format == AKO_BC4 || (format == AKO_BC3 && (channels == 2 || channels == 4)))
+				{
+					const double d = (double)single[i] - (double)pixel[(format == AKO_BC4) ? 0 : (channels - 1)];
+					error += d * d;
+					samples += 1;
+				}
+				else if (format == AKO_BC3)
+					assert(single[i] == 255);
+			}
+		}
+
+	const double psnr = 10.0 * log10(255.0 * 255.0 / (error / (double)samples + 1e-9));
+	printf("BC%i, %zux%zu px, %zu channels, tiles: %zu, %zu -> %zu bytes, Psnr: %.2f dB\n",
+	       (format == AKO_BC1) ? 1 : (format == AKO_BC3) ? 3 : 4, width, height, channels, tiles_dimension,
+	       blob_size, akoBcnSize(format, width, height), psnr);
+
+	akoDefaultFree(blocks);
+	akoDefaultFree(blob);
+	free(image);
+	return psnr;
+}
+
+
+int main()
+{
+	assert(sTest(AKO_BC1, 3, 256, 256, 64) > 30.0);
+	assert(sTest(AKO_BC1, 3, 100, 61, 32) > 30.0);
+	assert(sTest(AKO_BC1, 1, 77, 33, 0) > 30.0);
+	assert(sTest(AKO_BC3, 4, 128, 96, 16) > 30.0);
+	assert(sTest(AKO_BC3, 2, 45, 45, 8) > 30.0);
+	assert(sTest(AKO_BC3, 3, 64, 64, 0) > 30.0);
+	assert(sTest(AKO_BC4, 1, 300, 7, 64) > 40.0);
+	assert(sTest(AKO_BC4, 4, 3, 2, 0) > 40.0);
+
+	// Flat colors, representable in 5:6:5, come out exact
+	{
+		uint8_t image[40 * 24 * 3];
+		for (size_t i = 0; i < sizeof(image); i += 3)
+		{
+			image[i + 0] = 132;
+			image[i + 1] = 16;
+			image[i + 2] = 255;
+		}
+
+		void* blob = NULL;
+		enum akoStatus status;
+
+		struct akoSettings s = akoDefaultSettings();
+		s.tiles_dimension = 8;
+		s.quantization = 0;
+
+		const size_t blob_size = akoEncodeExt(NULL, &s, 3, 40, 24, image, &blob, &status);
+		assert(status == AKO_OK);
+
+		uint8_t* blocks = akoDecodeBcnExt(NULL, blob_size, blob, AKO_BC1, NULL, NULL, NULL, NULL, &status);
+		assert(status == AKO_OK && blocks != NULL);
+
+		for (size_t b = 0; b < akoBcnSize(AKO_BC1, 40, 24) / 8; b++)
+		{
+			uint8_t rgb[16 * 3];
+			sUnpackColor(blocks + b * 8, 1, rgb);
+
+			for (size_t i = 0; i < 16; i++)
+				assert(rgb[i * 3 + 0] == 132 && rgb[i * 3 + 1] == 16 && rgb[i * 3 + 2] == 255);
+		}
+
+		akoDefaultFree(blocks);
+
+		// Not a format, nor with a workarea
+		assert(akoDecodeBcnExt(NULL, blob_size, blob, (enum akoBcn)99, NULL, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_INPUT);
+
+		uint8_t workarea[64];
+		struct akoCallbacks c = akoDefaultCallbacks();
+		c.workarea = workarea;
+		c.workarea_size = sizeof(workarea);
+		assert(akoDecodeBcnExt(&c, blob_size, blob, AKO_BC1, NULL, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_CALLBACKS);
+
+		akoDefaultFree(blob);
+	}
+
+	return 0;
+}
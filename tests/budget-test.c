@@ -0,0 +1,112 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void sTest(size_t channels, size_t width, size_t height, size_t tiles_dimension, size_t code_blocks,
+                  int quantization)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.code_blocks = code_blocks;
+	s.quantization = quantization;
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.time_budget = 0.001F; // Way too small, tiles go through every wavelet
+
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	for (size_t y = 0; y < height; y++)
+		for (size_t x = 0; x < width; x++)
+			for (size_t ch = 0; ch < channels; ch++)
+				image[(y * width + x) * channels + ch] =
+				    (uint8_t)(127.0 + 80.0 * sin((double)x / 11.0 + (double)ch) * cos((double)y / 7.0) +
+				              (double)((x * 7 + y * 13) % 9));
+
+	// Encode
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeExt(&c, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	// Walk tiles heads, as the decoder does
+	size_t wavelets[AKO_WAVELET_NONE + 1] = {0};
+	{
+		const uint8_t* cursor = (const uint8_t*)blob + sizeof(struct akoHead);
+		const uint8_t* end = (const uint8_t*)blob + blob_size;
+
+		struct akoTilesIterator tiles;
+		akoTilesIteratorInit(s.order, width, height, tiles_dimension, akoTilesHeight(&s), &tiles);
+
+		const size_t tiles_no = akoImageTilesNo(width, height, tiles_dimension, akoTilesHeight(&s));
+		for (size_t t = 0; t < tiles_no; t++)
+		{
+			size_t tile_x;
+			size_t tile_y;
+			akoTilesIteratorNext(&tiles, &tile_x, &tile_y);
+
+			struct akoTileHead head;
+			memcpy(&head, cursor, sizeof(struct akoTileHead));
+			cursor += sizeof(struct akoTileHead);
+
+			assert(head.wavelet < AKO_WAVELET_NONE);
+			wavelets[head.wavelet]++;
+
+			const size_t size = akoCompressedSize(s.compression, s.code_blocks, channels,
+			                                      akoTileDimension(tile_x, width, tiles_dimension),
+			                                      akoTileDimension(tile_y, height, akoTilesHeight(&s)),
+			                                      (size_t)(end - cursor), cursor);
+			assert(size != 0);
+			cursor += size;
+		}
+
+		assert(cursor == end);
+	}
+
+	// Decode, mixed wavelets shouldn't change pixels
+	uint8_t* decoded = akoDecodeExt(NULL, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+	assert(status == AKO_OK && decoded != NULL);
+
+	double error = 0.0;
+	for (size_t i = 0; i < width * height * channels; i++)
+		error += ((double)image[i] - (double)decoded[i]) * ((double)image[i] - (double)decoded[i]);
+
+	const double psnr = 10.0 * log10(255.0 * 255.0 / (error / (double)(width * height * channels) + 1e-9));
+	printf("%zux%zu px, %zu channels, tiles: %zu, code-blocks: %zu, q: %i, DD137/CDF53/Haar tiles: %zu/%zu/%zu, "
+	       "Psnr: %.2f dB\n",
+	       width, height, channels, tiles_dimension, code_blocks, quantization, wavelets[AKO_WAVELET_DD137],
+	       wavelets[AKO_WAVELET_CDF53], wavelets[AKO_WAVELET_HAAR], psnr);
+
+	// Untried wavelets get a chance first, so all three appear
+	assert(wavelets[AKO_WAVELET_DD137] != 0 && wavelets[AKO_WAVELET_CDF53] != 0 && wavelets[AKO_WAVELET_HAAR] != 0);
+
+	if (quantization == 0)
+		assert(memcmp(decoded, image, width * height * channels) == 0);
+	else
+		assert(psnr > 35.0 && psnr < 100.0);
+
+	// Bye!
+	akoDefaultFree(decoded);
+	akoDefaultFree(blob);
+	free(image);
+}
+
+
+int main()
+{
+	sTest(3, 200, 150, 32, 0, 0);
+	sTest(4, 131, 67, 16, 0, 0);
+	sTest(1, 256, 256, 64, 16, 0);
+	sTest(3, 200, 150, 32, 0, 128); // Small tiles need large factors to be lossy
+	sTest(3, 301, 203, 64, 0, 32);
+	sTest(2, 128, 128, 32, 8, 128);
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void sTest(size_t channels, size_t width, size_t height, size_t tiles_dimension, size_t code_blocks,
+                  int quantization, size_t rect_x, size_t rect_y, size_t rect_w, size_t rect_h)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.code_blocks = code_blocks;
+	s.quantization = quantization;
+
+	uint8_t* image = malloc(width * height * channels);
+	uint8_t* edited = malloc(width * height * channels);
+	assert(image != NULL && edited != NULL);
+
+	for (size_t i = 0; i < width * height * channels; i++)
+		image[i] = edited[i] = (uint8_t)((i % 251) ^ (i / (width * channels)));
+
+	for (size_t r = rect_y; r < rect_y + rect_h; r++)
+		for (size_t c = rect_x; c < rect_x + rect_w; c++)
+			edited[(r * width + c) * channels] += 99;
+
+	void* blob = NULL;
+	void* edited_blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeExt(NULL, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK);
+	const size_t edited_size = akoEncodeExt(NULL, &s, channels, width, height, edited, &edited_blob, &status);
+	assert(status == AKO_OK);
+
+	// Same file, nothing changed
+	size_t changed_no, tiles_no;
+	struct akoTileRect* changed =
+	    akoDiffExt(NULL, blob_size, blob, blob_size, blob, &changed_no, &tiles_no, &status);
+	assert(status == AKO_OK && changed != NULL && changed_no == 0);
+	assert(tiles_no == akoImageTilesNo(width, height, tiles_dimension, tiles_dimension));
+	akoDefaultFree(changed);
+
+	// Changed tiles should be those touching the edited rectangle, no more
+	changed = akoDiffExt(NULL, blob_size, blob, edited_size, edited_blob, &changed_no, &tiles_no, &status);
+	assert(status == AKO_OK && changed != NULL);
+
+	size_t expected = 0;
+	const size_t tile_w = (tiles_dimension != 0) ? tiles_dimension : width;
+	const size_t tile_h = (tiles_dimension != 0) ? tiles_dimension : height;
+
+	for (size_t y = 0; y < height; y += tile_h)
+		for (size_t x = 0; x < width; x += tile_w)
+			if (x < rect_x + rect_w && rect_x < x + tile_w && y < rect_y + rect_h && rect_y < y + tile_h)
+				expected += 1;
+
+	for (size_t i = 0; i < changed_no; i++)
+	{
+		assert(changed[i].x < rect_x + rect_w && rect_x < changed[i].x + changed[i].width);
+		assert(changed[i].y < rect_y + rect_h && rect_y < changed[i].y + changed[i].height);
+		assert(changed[i].x + changed[i].width <= width && changed[i].y + changed[i].height <= height);
+	}
+
+	printf("%zux%zu px, %zu channels, tiles: %zu, code-blocks: %zu, q: %i, changed: %zu of %zu tiles\n", width,
+	       height, channels, tiles_dimension, code_blocks, quantization, changed_no, tiles_no);
+
+	if (quantization == 0)
+		assert(changed_no == expected); // Lossless, every touched tile changes
+	else
+		assert(changed_no <= expected);
+
+	akoDefaultFree(changed);
+
+	// Bye!
+	akoDefaultFree(blob);
+	akoDefaultFree(edited_blob);
+	free(image);
+	free(edited);
+}
+
+
+int main()
+{
+	sTest(3, 256, 256, 64, 0, 0, 70, 10, 20, 20);
+	sTest(3, 300, 200, 32, 0, 0, 0, 0, 300, 1);
+	sTest(4, 333, 111, 64, 16, 0, 320, 100, 13, 11);
+	sTest(1, 128, 128, 0, 0, 0, 5, 5, 1, 1);
+	sTest(3, 320, 240, 16, 32, 16, 100, 100, 40, 40);
+
+	// Different tiles, can't compare
+	{
+		uint8_t image[64 * 64] = {0};
+		void* a = NULL;
+		void* b = NULL;
+		enum akoStatus status;
+
+		struct akoSettings s = akoDefaultSettings();
+		s.tiles_dimension = 16;
+		const size_t a_size = akoEncodeExt(NULL, &s, 1, 64, 64, image, &a, &status);
+		assert(status == AKO_OK);
+
+		s.tiles_dimension = 32;
+		const size_t b_size = akoEncodeExt(NULL, &s, 1, 64, 64, image, &b, &status);
+		assert(status == AKO_OK);
+
+		assert(akoDiffExt(NULL, a_size, a, b_size, b, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INCOMPATIBLE_INPUTS);
+
+		// Truncated
+		assert(akoDiffExt(NULL, a_size, a, a_size - 1, a, NULL, NULL, &status) == NULL);
+		assert(status == AKO_BROKEN_INPUT);
+
+		akoDefaultFree(a);
+		akoDefaultFree(b);
+	}
+
+	return 0;
+}
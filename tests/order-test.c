@@ -0,0 +1,115 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void sIteratorTest(size_t cols, size_t rows)
+{
+	const size_t tiles_dimension = 16;
+	const size_t width = cols * tiles_dimension - 3; // Last ones smaller
+	const size_t height = rows * tiles_dimension - 5;
+
+	uint8_t* visits = calloc(cols * rows, 1);
+	assert(visits != NULL);
+
+	struct akoTilesIterator tiles;
+	akoTilesIteratorInit(AKO_ORDER_MORTON, width, height, tiles_dimension, tiles_dimension, &tiles);
+
+	for (size_t t = 0; t < cols * rows; t++)
+	{
+		size_t x;
+		size_t y;
+		akoTilesIteratorNext(&tiles, &x, &y);
+
+		assert(x % tiles_dimension == 0 && y % tiles_dimension == 0);
+		assert(x < width && y < height);
+
+		visits[(y / tiles_dimension) * cols + (x / tiles_dimension)]++;
+
+		// First group of four is the top left 2x2 one, in Z
+		if (cols >= 2 && rows >= 2 && t < 4)
+			assert(x == (t % 2) * tiles_dimension && y == (t / 2) * tiles_dimension);
+	}
+
+	// Every tile, once
+	for (size_t i = 0; i < cols * rows; i++)
+		assert(visits[i] == 1);
+
+	printf("Morton iterator, %zux%zu tiles: Ok\n", cols, rows);
+	free(visits);
+}
+
+
+static void sRoundTripTest(size_t channels, size_t width, size_t height, size_t tiles_dimension, size_t code_blocks,
+                           int quantization)
+{
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	for (size_t i = 0; i < width * height * channels; i++)
+		image[i] = (uint8_t)((i % 253) ^ (i / (width * channels)));
+
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.code_blocks = code_blocks;
+	s.quantization = quantization;
+
+	// Same tiles, different order, so same sizes and pixels
+	void* blobs[2] = {NULL, NULL};
+	size_t blob_sizes[2];
+	uint8_t* decoded[2];
+	enum akoStatus status;
+
+	for (int o = 0; o < 2; o++)
+	{
+		s.order = (o == 0) ? AKO_ORDER_RASTER : AKO_ORDER_MORTON;
+		blob_sizes[o] = akoEncodeExt(NULL, &s, channels, width, height, image, &blobs[o], &status);
+		assert(status == AKO_OK && blob_sizes[o] != 0);
+
+		struct akoSettings out_s;
+		decoded[o] = akoDecodeExt(NULL, blob_sizes[o], blobs[o], &out_s, NULL, NULL, NULL, &status);
+		assert(status == AKO_OK && decoded[o] != NULL);
+		assert(out_s.order == s.order);
+	}
+
+	printf("%zux%zu px (%zux%zu tiles), %zu channels, code-blocks: %zu, q: %i, %zu bytes: Ok\n", width, height,
+	       akoImageTilesNo(width, 1, tiles_dimension, 1), akoImageTilesNo(1, height, 1, tiles_dimension), channels,
+	       code_blocks, quantization, blob_sizes[1]);
+
+	assert(blob_sizes[0] == blob_sizes[1]);
+	assert(memcmp(decoded[0], decoded[1], width * height * channels) == 0);
+
+	if (quantization == 0)
+		assert(memcmp(decoded[1], image, width * height * channels) == 0);
+
+	for (int o = 0; o < 2; o++)
+	{
+		akoDefaultFree(decoded[o]);
+		akoDefaultFree(blobs[o]);
+	}
+
+	free(image);
+}
+
+
+int main()
+{
+	sIteratorTest(5, 3);
+	sIteratorTest(3, 5);
+	sIteratorTest(7, 1);
+	sIteratorTest(1, 6);
+	sIteratorTest(4, 4);
+	sIteratorTest(9, 7);
+
+	sRoundTripTest(3, 5 * 32, 3 * 32, 32, 0, 0);         // Exactly 5x3 tiles
+	sRoundTripTest(4, 5 * 32 - 7, 3 * 32 - 1, 32, 0, 0); // Smaller ones at the borders
+	sRoundTripTest(1, 5 * 64, 3 * 64, 64, 16, 0);
+	sRoundTripTest(3, 3 * 32, 5 * 32 - 9, 32, 0, 128);
+	sRoundTripTest(2, 7 * 16, 2 * 16, 16, 8, 0);
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static uint8_t* sImage(size_t channels, size_t width, size_t height, int kind)
+{
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	for (size_t y = 0; y < height; y++)
+		for (size_t x = 0; x < width; x++)
+			for (size_t ch = 0; ch < channels; ch++)
+			{
+				double value = 127.0 + 90.0 * sin((double)x / 19.0 + (double)ch) * cos((double)y / 13.0);
+
+				if (kind == 1) // Plus some grain
+					value += (double)(rand() % 17) - 8.0;
+				else if (kind == 2) // Hard edges
+					value = (((x / 24) + (y / 16) + ch) % 3 == 0) ? 230.0 : 25.0;
+
+				image[(y * width + x) * channels + ch] = (uint8_t)(value);
+			}
+
+	return image;
+}
+
+
+static double sTest(enum akoWavelet wavelet, enum akoColor color, size_t channels, size_t width, size_t height,
+                    size_t tiles_dimension, int kind, float target, int use_workarea)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.wavelet = wavelet;
+	s.color = color;
+	s.tiles_dimension = tiles_dimension;
+	s.target_psnr = target;
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	if (use_workarea != 0)
+	{
+		c.workarea_size = akoEncodeWorkareaSize(&s, channels, width, height);
+		c.workarea = malloc(c.workarea_size);
+		assert(c.workarea != NULL);
+	}
+
+	uint8_t* image = sImage(channels, width, height, kind);
+
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeExt(&c, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	uint8_t* decoded = akoDecodeExt(NULL, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+	assert(status == AKO_OK && decoded != NULL);
+
+	// Measured as everybody does, over all samples
+	double error = 0.0;
+	for (size_t i = 0; i < width * height * channels; i++)
+		error += ((double)image[i] - (double)decoded[i]) * ((double)image[i] - (double)decoded[i]);
+
+	const double psnr = 10.0 * log10(255.0 * 255.0 / (error / (double)(width * height * channels) + 1e-9));
+	printf("%zux%zu px, %zu channels, tiles: %zu, kind: %i, target: %.1f dB -> %.2f dB, %zu bytes\n", width, height,
+	       channels, tiles_dimension, kind, (double)target, psnr, blob_size);
+
+	free(image);
+	akoDefaultFree(decoded);
+	if (use_workarea != 0)
+		free(c.workarea);
+	else
+		akoDefaultFree(blob);
+
+	return psnr;
+}
+
+
+int main()
+{
+	const float targets[4] = {35.0F, 40.0F, 45.0F, 50.0F};
+
+	for (int i = 0; i < 4; i++)
+	{
+		const float t = targets[i];
+
+		assert(sTest(AKO_WAVELET_DD137, AKO_COLOR_YCOCG, 3, 256, 256, 0, 0, t, 0) >= (double)t);
+		assert(sTest(AKO_WAVELET_DD137, AKO_COLOR_YCOCG, 3, 301, 203, 64, 1, t, 0) >= (double)t);
+		assert(sTest(AKO_WAVELET_CDF53, AKO_COLOR_YCOCG, 4, 200, 150, 64, 2, t, 0) >= (double)t);
+		assert(sTest(AKO_WAVELET_HAAR, AKO_COLOR_SUBTRACT_G, 3, 129, 97, 32, 1, t, 0) >= (double)t);
+		assert(sTest(AKO_WAVELET_CDF53, AKO_COLOR_NONE, 1, 160, 120, 0, 1, t, 0) >= (double)t);
+	}
+
+	// Measuring needs a third workarea, accounted in the caller's one
+	assert(sTest(AKO_WAVELET_DD137, AKO_COLOR_YCOCG, 3, 301, 203, 64, 1, 45.0F, 1) >= 45.0);
+
+	return 0;
+}
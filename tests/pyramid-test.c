@@ -0,0 +1,142 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void sTest(size_t channels, size_t width, size_t height, size_t tiles_dimension, enum akoWavelet wavelet,
+                  size_t levels)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.quantization = 0;
+	s.wavelet = wavelet;
+
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	for (size_t r = 0; r < height; r++)
+		for (size_t c = 0; c < width; c++)
+			for (size_t ch = 0; ch < channels; ch++)
+				image[(r * width + c) * channels + ch] =
+				    (uint8_t)(128.0 + 60.0 * sin((double)c / (90.0 + (double)ch)) * cos((double)r / 70.0));
+
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeExt(NULL, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	// Decode
+	size_t w, h, ch;
+	uint8_t* pyramid = akoDecodePyramidExt(NULL, blob_size, blob, levels, NULL, &ch, &w, &h, &status);
+	assert(status == AKO_OK && pyramid != NULL && w == width && h == height && ch == channels);
+	assert(memcmp(pyramid, image, width * height * channels) == 0); // First level, lossless
+
+	// Levels should resemble previous ones, pixels there within the values of those
+	// they cover (lowpasses are sited on even ones, so a neighbourhood around them)
+	printf("%zux%zu px, %zu channels, tiles: %zu, wavelet: %i:", width, height, channels, tiles_dimension,
+	       (int)wavelet);
+
+	for (size_t l = 1; l <= levels; l++)
+	{
+		size_t prev_w, prev_h, level_w, level_h;
+		const uint8_t* prev = pyramid + akoPyramidLevel(channels, width, height, l - 1, &prev_w, &prev_h);
+		const uint8_t* level = pyramid + akoPyramidLevel(channels, width, height, l, &level_w, &level_h);
+
+		assert(level_w == akoDividePlusOneRule(prev_w) && level_h == akoDividePlusOneRule(prev_h));
+
+		int max_error = 0;
+		for (size_t r = 0; r < level_h; r++)
+		{
+			for (size_t c = 0; c < level_w; c++)
+			{
+				for (size_t i = 0; i < channels; i++)
+				{
+					int min = 255;
+					int max = 0;
+
+					for (size_t pr = (r * 2 > 0) ? (r * 2 - 1) : 0; pr <= r * 2 + 1 && pr < prev_h; pr++)
+						for (size_t pc = (c * 2 > 0) ? (c * 2 - 1) : 0; pc <= c * 2 + 1 && pc < prev_w; pc++)
+						{
+							const int v = prev[(pr * prev_w + pc) * channels + i];
+							min = (v < min) ? v : min;
+							max = (v > max) ? v : max;
+						}
+
+					const int v = level[(r * level_w + c) * channels + i];
+					const int error = (v < min) ? (min - v) : (v > max) ? (v - max) : 0;
+					max_error = (error > max_error) ? error : max_error;
+				}
+			}
+		}
+
+		printf(" %zux%zu (%i)", level_w, level_h, max_error);
+		assert(max_error <= 8); // Longer lowpass filters overshoot a bit at coarsest levels
+	}
+
+	printf("\n");
+
+	// Nothing past the last level
+	assert(akoPyramidLevel(channels, width, height, levels + 1, NULL, NULL) ==
+	       akoPyramidLevel(channels, width, height, levels, &w, &h) + w * h * channels);
+
+	// Bye!
+	akoDefaultFree(pyramid);
+	akoDefaultFree(blob);
+	free(image);
+}
+
+
+int main()
+{
+	sTest(3, 256, 256, 0, AKO_WAVELET_DD137, 8);
+	sTest(3, 300, 200, 64, AKO_WAVELET_DD137, 9);
+	sTest(4, 333, 111, 32, AKO_WAVELET_CDF53, 9);
+	sTest(1, 1000, 77, 256, AKO_WAVELET_HAAR, 10);
+	sTest(2, 100, 70, 16, AKO_WAVELET_CDF53, 7);
+
+	// Nothing past one pixel
+	{
+		uint8_t image[16 * 8] = {0};
+		void* blob = NULL;
+		enum akoStatus status;
+
+		const size_t blob_size = akoEncodeExt(NULL, NULL, 1, 16, 8, image, &blob, &status);
+		assert(status == AKO_OK);
+
+		uint8_t* pyramid = akoDecodePyramidExt(NULL, blob_size, blob, 1000, NULL, NULL, NULL, NULL, &status);
+		assert(status == AKO_OK && pyramid != NULL);
+
+		size_t w, h;
+		assert(pyramid[akoPyramidLevel(1, 16, 8, 4, &w, &h)] == 0 && w == 1 && h == 1);
+
+		akoDefaultFree(pyramid);
+		akoDefaultFree(blob);
+	}
+
+	// Workareas not supported
+	{
+		uint8_t image[16 * 16] = {0};
+		void* blob = NULL;
+		enum akoStatus status;
+
+		const size_t blob_size = akoEncodeExt(NULL, NULL, 1, 16, 16, image, &blob, &status);
+		assert(status == AKO_OK);
+
+		struct akoCallbacks c = akoDefaultCallbacks();
+		c.workarea_size = akoDecodeWorkareaSize(&c, blob_size, blob, &status);
+		c.workarea = malloc(c.workarea_size);
+
+		assert(akoDecodePyramidExt(&c, blob_size, blob, 2, NULL, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_CALLBACKS);
+
+		free(c.workarea);
+		akoDefaultFree(blob);
+	}
+
+	return 0;
+}
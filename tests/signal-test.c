@@ -0,0 +1,152 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static uint32_t sRandom(uint32_t* state)
+{
+	*state = *state * 1103515245 + 12345;
+	return *state >> 8;
+}
+
+
+static void sTest(size_t length, size_t blocks_length, enum akoWavelet wavelet, enum akoWrap wrap, int noise)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = blocks_length;
+	s.wavelet = wavelet;
+	s.wrap = wrap;
+
+	int16_t* signal = malloc(length * sizeof(int16_t));
+	assert(signal != NULL);
+
+	// Telemetry alike, a slow wave plus a random walk. Or the whole int16 range
+	uint32_t state = (uint32_t)length;
+	int walk = 0;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		walk += (int)(sRandom(&state) % 7) - 3;
+		signal[i] = (noise == 0) ? (int16_t)(2000.0 * sin((double)i / 50.0) + walk)
+		                         : (int16_t)(sRandom(&state) & 0xFFFF);
+	}
+
+	if (noise != 0)
+		signal[length / 2] = INT16_MIN;
+
+	// Encode
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeSignalExt(NULL, &s, length, signal, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	printf("%zu samples, blocks: %zu, wavelet: %i, wrap: %i, noise: %i, %zu -> %zu bytes\n", length, blocks_length,
+	       (int)wavelet, (int)wrap, noise, length * sizeof(int16_t), blob_size);
+
+	if (noise == 0 && length >= 256 && wavelet != AKO_WAVELET_NONE)
+		assert(blob_size < length * sizeof(int16_t));
+
+	// Decode, lossless
+	size_t out_length, total_length;
+	int16_t* decoded = akoDecodeSignalExt(NULL, blob_size, blob, 0, 0, NULL, &out_length, &total_length, &status);
+	assert(status == AKO_OK && decoded != NULL && out_length == length && total_length == length);
+	assert(memcmp(decoded, signal, length * sizeof(int16_t)) == 0);
+	akoDefaultFree(decoded);
+
+	// Ranges, crossing blocks or not
+	const size_t ranges[][2] = {{0, 1}, {length / 3, length / 3}, {length - 1, 1}, {length / 2, 0}};
+
+	for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++)
+	{
+		const size_t from = ranges[r][0];
+		const size_t expected = (ranges[r][1] != 0) ? ranges[r][1] : (length - from);
+
+		decoded = akoDecodeSignalExt(NULL, blob_size, blob, from, ranges[r][1], NULL, &out_length, NULL, &status);
+		assert(status == AKO_OK && decoded != NULL && out_length == expected);
+		assert(memcmp(decoded, signal + from, expected * sizeof(int16_t)) == 0);
+		akoDefaultFree(decoded);
+	}
+
+	// Blocks are independent, a broken first one doesn't matter to the last
+	if (blocks_length != 0 && length > blocks_length)
+	{
+		uint8_t* broken = malloc(blob_size);
+		memcpy(broken, blob, blob_size);
+
+		struct akoSignalBlockHead head;
+		memcpy(&head, broken + sizeof(struct akoSignalHead), sizeof(struct akoSignalBlockHead));
+
+		for (size_t i = 0; i < head.size; i++)
+			broken[sizeof(struct akoSignalHead) + sizeof(struct akoSignalBlockHead) + i] ^= 0x5A;
+
+		decoded = akoDecodeSignalExt(NULL, blob_size, broken, length - 1, 1, NULL, NULL, NULL, &status);
+		assert(status == AKO_OK && decoded != NULL && decoded[0] == signal[length - 1]);
+		akoDefaultFree(decoded);
+		free(broken);
+	}
+
+	// Truncated
+	assert(akoDecodeSignalExt(NULL, blob_size - 1, blob, 0, 0, NULL, NULL, NULL, &status) == NULL);
+	assert(status == AKO_BROKEN_INPUT);
+
+	// Bye!
+	akoDefaultFree(blob);
+	free(signal);
+}
+
+
+int main()
+{
+	sTest(100000, 4096, AKO_WAVELET_DD137, AKO_WRAP_CLAMP, 0);
+	sTest(100000, 4096, AKO_WAVELET_CDF53, AKO_WRAP_MIRROR, 0);
+	sTest(65537, 1024, AKO_WAVELET_HAAR, AKO_WRAP_CLAMP, 0);
+	sTest(12345, 0, AKO_WAVELET_DD137, AKO_WRAP_REPEAT, 0);
+	sTest(5000, 512, AKO_WAVELET_NONE, AKO_WRAP_ZERO, 0);
+	sTest(3001, 64, AKO_WAVELET_DD137, AKO_WRAP_ZERO, 0);
+	sTest(20000, 2048, AKO_WAVELET_DD137, AKO_WRAP_CLAMP, 1);
+	sTest(20000, 2048, AKO_WAVELET_HAAR, AKO_WRAP_CLAMP, 1);
+
+	for (size_t length = 1; length < 40; length++)
+		sTest(length, 8, AKO_WAVELET_DD137, AKO_WRAP_CLAMP, 0);
+
+	// Nothing there
+	{
+		int16_t signal[64] = {0};
+		void* blob = NULL;
+		enum akoStatus status;
+
+		const size_t blob_size = akoEncodeSignalExt(NULL, NULL, 64, signal, &blob, &status);
+		assert(status == AKO_OK && blob_size < 64);
+
+		assert(akoDecodeSignalExt(NULL, blob_size, blob, 64, 0, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_INPUT);
+
+		assert(akoDecodeSignalExt(NULL, blob_size, signal, 0, 0, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_MAGIC);
+
+		akoDefaultFree(blob);
+	}
+
+	// A single block too long for its head, rejected before touching samples
+	if (SIZE_MAX / (sizeof(int16_t) * 4) > ((size_t)1 << 31))
+	{
+		int16_t signal[64] = {0};
+		void* blob = NULL;
+		enum akoStatus status;
+
+		assert(akoEncodeSignalExt(NULL, NULL, (size_t)1 << 31, signal, &blob, &status) == 0);
+		assert(status == AKO_INVALID_TILES_DIMENSIONS && blob == NULL);
+
+		struct akoSettings s = akoDefaultSettings();
+		s.tiles_dimension = 0;
+		assert(akoEncodeSignalExt(NULL, &s, ((size_t)1 << 31) + 5, signal, &blob, &status) == 0);
+		assert(status == AKO_INVALID_TILES_DIMENSIONS);
+	}
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static void sPrint(const char* name, const struct akoStats* s)
+{
+	printf("%s: %llu encodes, %llu decodes, %llu failures, %llu tiles, %llu px, %llu/%llu bytes, format %llu ns, "
+	       "wavelet %llu ns, compression %llu ns\n",
+	       name, (unsigned long long)s->encodes, (unsigned long long)s->decodes, (unsigned long long)s->failures,
+	       (unsigned long long)s->tiles, (unsigned long long)s->pixels, (unsigned long long)s->image_bytes,
+	       (unsigned long long)s->blob_bytes, (unsigned long long)s->format_ns, (unsigned long long)s->wavelet_ns,
+	       (unsigned long long)s->compression_ns);
+}
+
+
+static void sTest(enum akoWavelet wavelet, enum akoCompression compression, const uint8_t* image)
+{
+	const size_t width = 300;
+	const size_t height = 200;
+	const size_t channels = 3;
+
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = 64;
+	s.wavelet = wavelet;
+	s.compression = compression;
+	s.quantization = 0;
+
+	struct akoStats shared;
+	struct akoStats read;
+	akoStatsReset(&shared);
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.stats = &shared;
+
+	// Stages that ran took some time, skipped ones none. Compression one always
+	// runs, without compression it still copies tiles from or to the blob
+	const int wavelet_runs = (wavelet != AKO_WAVELET_NONE);
+	const int compression_runs = 1;
+
+	// Encode
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeExt(&c, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	akoStatsRead(&shared, &read);
+	sPrint("Encode", &read);
+
+	assert(read.encodes == 1 && read.decodes == 0 && read.failures == 0);
+	assert(read.tiles == akoImageTilesNo(width, height, 64, 64) && read.pixels == width * height);
+	assert(read.image_bytes == width * height * channels && read.blob_bytes == blob_size);
+	assert(read.format_ns != 0);
+	assert((read.wavelet_ns != 0) == wavelet_runs);
+	assert((read.compression_ns != 0) == compression_runs);
+
+	// Decode, adds to the same instance
+	akoStatsReset(&shared);
+	uint8_t* decoded = akoDecodeExt(&c, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+	assert(status == AKO_OK && decoded != NULL);
+	akoDefaultFree(decoded);
+
+	decoded = akoDecodeExt(&c, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+	assert(status == AKO_OK && decoded != NULL);
+	akoDefaultFree(decoded);
+
+	akoStatsRead(&shared, &read);
+	sPrint("Decode (x2)", &read);
+
+	assert(read.encodes == 0 && read.decodes == 2 && read.failures == 0);
+	assert(read.tiles == akoImageTilesNo(width, height, 64, 64) * 2 && read.pixels == width * height * 2);
+	assert(read.image_bytes == width * height * channels * 2 && read.blob_bytes == blob_size * 2);
+	assert(read.format_ns != 0);
+	assert((read.wavelet_ns != 0) == wavelet_runs);
+	assert((read.compression_ns != 0) == compression_runs);
+
+	// Failed encode, tiles done until the limit still count
+	akoStatsReset(&shared);
+	c.max_output_size = blob_size / 2;
+
+	assert(akoEncodeExt(&c, &s, channels, width, height, image, NULL, &status) == 0);
+	assert(status == AKO_OUTPUT_LIMIT_EXCEEDED);
+	c.max_output_size = 0;
+
+	akoStatsRead(&shared, &read);
+	sPrint("Failed encode", &read);
+
+	assert(read.encodes == 0 && read.failures == 1);
+	assert(read.format_ns != 0);
+	assert((read.wavelet_ns != 0) == wavelet_runs);
+	assert((read.compression_ns != 0) == compression_runs);
+
+	// Failed decode. Compressed inputs fail at the tile where they end, with tiles
+	// before counting. Uncompressed ones have a known size, checked before any tile
+	akoStatsReset(&shared);
+
+	assert(akoDecodeExt(&c, blob_size / 2, blob, NULL, NULL, NULL, NULL, &status) == NULL);
+	assert(status == AKO_BROKEN_INPUT);
+
+	akoStatsRead(&shared, &read);
+	sPrint("Failed decode", &read);
+
+	const int tiles_ran = (compression != AKO_COMPRESSION_NONE);
+
+	assert(read.decodes == 0 && read.failures == 1);
+	assert((read.format_ns != 0) == tiles_ran);
+	assert((read.wavelet_ns != 0) == (tiles_ran && wavelet_runs));
+	assert((read.compression_ns != 0) == tiles_ran);
+
+	// Reset
+	akoStatsReset(&shared);
+	akoStatsRead(&shared, &read);
+	assert(read.failures == 0 && read.format_ns == 0 && read.wavelet_ns == 0 && read.compression_ns == 0);
+
+	akoDefaultFree(blob);
+}
+
+
+int main()
+{
+	uint8_t* image = malloc(300 * 200 * 3);
+	assert(image != NULL);
+
+	for (size_t i = 0; i < 300 * 200 * 3; i++)
+		image[i] = (uint8_t)((i % 251) ^ (i / (300 * 3)));
+
+	sTest(AKO_WAVELET_DD137, AKO_COMPRESSION_KAGARI, image);
+	sTest(AKO_WAVELET_CDF53, AKO_COMPRESSION_KAGARI, image);
+	sTest(AKO_WAVELET_HAAR, AKO_COMPRESSION_NONE, image);
+	sTest(AKO_WAVELET_NONE, AKO_COMPRESSION_NONE, image);
+
+	// Without an instance nothing is measured, nor breaks
+	{
+		void* blob = NULL;
+		enum akoStatus status;
+
+		const size_t blob_size = akoEncodeExt(NULL, NULL, 3, 300, 200, image, &blob, &status);
+		assert(status == AKO_OK && blob_size != 0);
+		akoDefaultFree(blob);
+	}
+
+	free(image);
+	return 0;
+}
@@ -0,0 +1,115 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static uint8_t* sImage(size_t channels, size_t width, size_t height, int variant)
+{
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	uint32_t state = 1234;
+
+	for (size_t y = 0; y < height; y++)
+		for (size_t x = 0; x < width; x++)
+			for (size_t ch = 0; ch < channels; ch++)
+			{
+				state = state * 1103515245 + 12345;
+				const double u = (double)x / (double)width;
+				const double v = (double)y / (double)height;
+
+				double value = (variant != 2) ? (127.0 + 100.0 * sin(u * 5.0 + (double)ch) * cos(v * 3.0))
+				                              : (127.0 + 100.0 * cos(u * 9.0 - v * 7.0 + (double)ch));
+
+				if (variant == 1) // Some noise over the first one
+					value += (double)((state >> 16) % 9) - 4.0;
+
+				value = (value < 0.0) ? 0.0 : (value > 255.0) ? 255.0 : value;
+				image[(y * width + x) * channels + ch] = (uint8_t)value;
+			}
+
+	return image;
+}
+
+
+static int sBits(uint64_t x)
+{
+	int bits = 0;
+	for (; x != 0; x >>= 1)
+		bits += (int)(x & 1);
+	return bits;
+}
+
+
+static uint64_t sTest(size_t channels, size_t width, size_t height, size_t tiles_dimension, int quantization,
+                      int variant)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.quantization = quantization;
+
+	uint8_t* image = sImage(channels, width, height, variant);
+
+	struct akoSummary summary;
+	memset(&summary, 0xAA, sizeof(summary)); // Should be overwritten
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.summary = &summary;
+
+	void* blob = NULL;
+	enum akoStatus status;
+
+	akoEncodeExt(&c, &s, channels, width, height, image, &blob, &status);
+	assert(status == AKO_OK);
+	akoDefaultFree(blob);
+
+	// Same as counting them here
+	for (size_t ch = 0; ch < channels; ch++)
+	{
+		uint64_t histogram[256] = {0};
+		uint64_t sum = 0;
+
+		for (size_t i = 0; i < width * height; i++)
+		{
+			histogram[image[i * channels + ch]] += 1;
+			sum += image[i * channels + ch];
+		}
+
+		assert(memcmp(histogram, summary.histogram[ch], sizeof(histogram)) == 0);
+		assert(summary.average[ch] == (uint8_t)((sum + width * height / 2) / (width * height)));
+	}
+
+	printf("%zux%zu px, %zu channels, tiles: %zu, q: %i, variant: %i, fingerprint: %016llx\n", width, height,
+	       channels, tiles_dimension, quantization, variant, (unsigned long long)summary.fingerprint);
+
+	free(image);
+	return summary.fingerprint;
+}
+
+
+int main()
+{
+	// Tiles settings, or losses, don't change it (8x8 tiles go in batches)
+	const uint64_t a = sTest(3, 256, 192, 64, 0, 0);
+	assert(sTest(3, 256, 192, 0, 0, 0) == a);
+	assert(sTest(3, 256, 192, 8, 0, 0) == a);
+	assert(sTest(3, 256, 192, 32, 16, 0) == a);
+
+	// Noise changes few bits, another image many
+	const uint64_t noisy = sTest(3, 256, 192, 64, 0, 1);
+	const uint64_t other = sTest(3, 256, 192, 64, 0, 2);
+	assert(sBits(a ^ noisy) < 6);
+	assert(sBits(a ^ other) > 16);
+
+	// Odd sizes, smaller than the grid, more channels
+	sTest(1, 101, 37, 16, 0, 0);
+	sTest(4, 5, 3, 0, 0, 2);
+	sTest(2, 7, 5, 0, 0, 0);
+	sTest(16, 24, 24, 8, 0, 0);
+
+	return 0;
+}
@@ -0,0 +1,216 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static uint8_t* sVolume(size_t channels, size_t width, size_t height, size_t depth)
+{
+	uint8_t* volume = malloc(width * height * depth * channels);
+	assert(volume != NULL);
+
+	// CT alike, an ellipsoid slowly changing between slices
+	for (size_t z = 0; z < depth; z++)
+		for (size_t y = 0; y < height; y++)
+			for (size_t x = 0; x < width; x++)
+			{
+				const double dx = ((double)x - (double)width / 2.0) / ((double)width / 2.0);
+				const double dy = ((double)y - (double)height / 2.0) / ((double)height / 2.0);
+				const double r = sqrt(dx * dx + dy * dy) + sin((double)z / 16.0) * 0.02;
+
+				for (size_t ch = 0; ch < channels; ch++)
+					volume[((z * height + y) * width + x) * channels + ch] =
+					    (uint8_t)((r < 0.8) ? (160.0 + 40.0 * cos(r * 10.0 + (double)ch)) : 20.0);
+			}
+
+	return volume;
+}
+
+
+static void sTest(size_t channels, size_t width, size_t height, size_t depth, size_t bricks_depth,
+                  size_t tiles_dimension, enum akoWavelet wavelet, enum akoColor color)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.wavelet = wavelet;
+	s.color = color;
+	s.quantization = 0;
+
+	uint8_t* volume = sVolume(channels, width, height, depth);
+
+	// Encode
+	void* blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size =
+	    akoEncodeVolumeExt(NULL, &s, bricks_depth, channels, width, height, depth, volume, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	printf("%zux%zux%zu voxels, %zu channels, bricks: %zu, tiles: %zu, wavelet: %i, %zu -> %zu bytes\n", width,
+	       height, depth, channels, bricks_depth, tiles_dimension, (int)wavelet, width * height * depth * channels,
+	       blob_size);
+
+	// Decode, lossless
+	size_t out_channels;
+	struct akoBox out_box;
+	uint8_t* decoded = akoDecodeVolumeExt(NULL, blob_size, blob, NULL, NULL, &out_channels, &out_box, &status);
+	assert(status == AKO_OK && decoded != NULL && out_channels == channels);
+	assert(out_box.x == 0 && out_box.width == width && out_box.height == height && out_box.depth == depth);
+	assert(memcmp(decoded, volume, width * height * depth * channels) == 0);
+	akoDefaultFree(decoded);
+
+	// Sub-volumes
+	const struct akoBox boxes[] = {{0, 0, 0, 1, 1, 1},
+	                               {width / 3, height / 4, depth / 2, width / 2, height / 3, 0},
+	                               {width - 1, height - 1, depth - 1, 0, 0, 0},
+	                               {0, height / 2, 0, 0, 1, depth}};
+
+	for (size_t b = 0; b < sizeof(boxes) / sizeof(boxes[0]); b++)
+	{
+		decoded = akoDecodeVolumeExt(NULL, blob_size, blob, &boxes[b], NULL, NULL, &out_box, &status);
+		assert(status == AKO_OK && decoded != NULL);
+		assert(out_box.x + out_box.width <= width && out_box.y + out_box.height <= height &&
+		       out_box.z + out_box.depth <= depth);
+
+		for (size_t z = 0; z < out_box.depth; z++)
+			for (size_t y = 0; y < out_box.height; y++)
+				assert(memcmp(decoded + ((z * out_box.height + y) * out_box.width) * channels,
+				              volume + (((out_box.z + z) * height + out_box.y + y) * width + out_box.x) * channels,
+				              out_box.width * channels) == 0);
+
+		akoDefaultFree(decoded);
+	}
+
+	// Truncated
+	assert(akoDecodeVolumeExt(NULL, blob_size - 1, blob, NULL, NULL, NULL, NULL, &status) == NULL);
+	assert(status == AKO_BROKEN_INPUT);
+
+	// Bye!
+	akoDefaultFree(blob);
+	free(volume);
+}
+
+
+int main()
+{
+	sTest(1, 64, 64, 64, 0, 0, AKO_WAVELET_DD137, AKO_COLOR_YCOCG);
+	sTest(1, 100, 80, 37, 8, 32, AKO_WAVELET_DD137, AKO_COLOR_YCOCG);
+	sTest(3, 50, 50, 21, 16, 16, AKO_WAVELET_CDF53, AKO_COLOR_YCOCG);
+	sTest(2, 33, 17, 5, 4, 0, AKO_WAVELET_HAAR, AKO_COLOR_SUBTRACT_G);
+	sTest(1, 16, 16, 1, 0, 0, AKO_WAVELET_DD137, AKO_COLOR_YCOCG);
+	sTest(1, 16, 16, 2, 2, 0, AKO_WAVELET_CDF53, AKO_COLOR_YCOCG);
+
+	for (size_t depth = 3; depth < 20; depth++)
+		sTest(1, 24, 24, depth, 0, 0, AKO_WAVELET_DD137, AKO_COLOR_YCOCG);
+
+	// Correlated slices should do better than encoding them one by one
+	{
+		const size_t w = 128, h = 128, d = 32;
+		uint8_t* volume = sVolume(1, w, h, d);
+
+		struct akoSettings s = akoDefaultSettings();
+		s.quantization = 0;
+
+		void* blob = NULL;
+		enum akoStatus status;
+
+		const size_t volume_size = akoEncodeVolumeExt(NULL, &s, 0, 1, w, h, d, volume, &blob, &status);
+		assert(status == AKO_OK);
+		akoDefaultFree(blob);
+
+		size_t slices_size = 0;
+		for (size_t z = 0; z < d; z++)
+		{
+			slices_size += akoEncodeExt(NULL, &s, 1, w, h, volume + w * h * z, &blob, &status);
+			assert(status == AKO_OK);
+			akoDefaultFree(blob);
+		}
+
+		printf("Volume: %zu bytes, slices one by one: %zu bytes\n", volume_size, slices_size);
+		assert(volume_size < slices_size);
+		free(volume);
+	}
+
+	// Lossy, smaller and still close
+	{
+		const size_t w = 96, h = 80, d = 24;
+		const size_t channels[2] = {1, 3};
+		const int quantization[2] = {32, 128};
+
+		for (int i = 0; i < 4; i++)
+		{
+			const size_t ch = channels[i % 2];
+			uint8_t* volume = sVolume(ch, w, h, d);
+
+			struct akoSettings s = akoDefaultSettings();
+			s.quantization = 0;
+
+			void* blob = NULL;
+			enum akoStatus status;
+
+			const size_t lossless_size = akoEncodeVolumeExt(NULL, &s, 8, ch, w, h, d, volume, &blob, &status);
+			assert(status == AKO_OK && lossless_size != 0);
+			akoDefaultFree(blob);
+
+			s.quantization = quantization[i / 2];
+			const size_t blob_size = akoEncodeVolumeExt(NULL, &s, 8, ch, w, h, d, volume, &blob, &status);
+			assert(status == AKO_OK && blob_size != 0);
+
+			uint8_t* decoded = akoDecodeVolumeExt(NULL, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+			assert(status == AKO_OK && decoded != NULL);
+
+			double error = 0.0;
+			for (size_t v = 0; v < w * h * d * ch; v++)
+				error += ((double)volume[v] - (double)decoded[v]) * ((double)volume[v] - (double)decoded[v]);
+
+			const double psnr = 10.0 * log10(255.0 * 255.0 / (error / (double)(w * h * d * ch) + 1e-9));
+			printf("Lossy, %zu channels, q: %i, %zu -> %zu bytes (lossless: %zu bytes), Psnr: %.2f dB\n", ch,
+			       s.quantization, w * h * d * ch, blob_size, lossless_size, psnr);
+
+			assert(blob_size < lossless_size);
+			assert(psnr > 40.0 && psnr < 100.0); // Not lossless either
+
+			akoDefaultFree(decoded);
+			akoDefaultFree(blob);
+			free(volume);
+		}
+	}
+
+	// Broken or invalid inputs
+	{
+		uint8_t volume[8 * 8 * 4] = {0};
+		void* blob = NULL;
+		enum akoStatus status;
+
+		struct akoSettings s = akoDefaultSettings();
+		assert(akoEncodeVolumeExt(NULL, &s, 3, 1, 8, 8, 4, volume, &blob, &status) == 0);
+		assert(status == AKO_INVALID_TILES_DIMENSIONS);
+
+		s.wavelet = AKO_WAVELET_NONE;
+		assert(akoEncodeVolumeExt(NULL, &s, 0, 1, 8, 8, 4, volume, &blob, &status) == 0);
+		assert(status == AKO_INVALID_WAVELET_TRANSFORMATION);
+
+		s = akoDefaultSettings();
+		const size_t blob_size = akoEncodeVolumeExt(NULL, &s, 2, 1, 8, 8, 4, volume, &blob, &status);
+		assert(status == AKO_OK);
+
+		const struct akoBox outside = {0, 0, 4, 0, 0, 0};
+		assert(akoDecodeVolumeExt(NULL, blob_size, blob, &outside, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_INPUT);
+
+		struct akoCallbacks c = akoDefaultCallbacks();
+		c.max_pixels = 8 * 8 * 4 - 1;
+		assert(akoDecodeVolumeExt(&c, blob_size, blob, NULL, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_LIMITS_EXCEEDED);
+
+		assert(akoDecodeVolumeExt(NULL, sizeof(volume), volume, NULL, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_MAGIC);
+
+		akoDefaultFree(blob);
+	}
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void sTest(size_t channels, size_t width, size_t height, size_t tiles_dimension, size_t tiles_height)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.tiles_height = tiles_height;
+	s.quantization = 0;
+	s.wavelet = AKO_WAVELET_CDF53;
+	s.color = AKO_COLOR_SUBTRACT_G;
+
+	// No allocation callbacks at all
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.malloc = NULL;
+	c.realloc = NULL;
+	c.free = NULL;
+
+	uint8_t* image = malloc(width * height * channels);
+	assert(image != NULL);
+
+	for (size_t i = 0; i < width * height * channels; i++)
+		image[i] = (uint8_t)((i % 251) ^ (i / (width * channels)));
+
+	// Encode
+	void* blob = NULL;
+	enum akoStatus status;
+
+	c.workarea_size = akoEncodeWorkareaSize(&s, channels, width, height);
+	c.workarea = malloc(c.workarea_size);
+	assert(c.workarea_size != 0 && c.workarea != NULL);
+
+	const size_t blob_size = akoEncodeExt(&c, &s, channels, width, height, image, &blob, &status);
+	printf("%zux%zu px, %zu channels, tiles: %zux%zu, encode workarea: %zu bytes, blob: %zu bytes\n", width, height,
+	       channels, tiles_dimension, tiles_height, c.workarea_size, blob_size);
+
+	assert(status == AKO_OK && blob_size != 0);
+	assert((uint8_t*)blob >= (uint8_t*)c.workarea &&
+	       (uint8_t*)blob + blob_size <= (uint8_t*)c.workarea + c.workarea_size);
+
+	// Same output than using callbacks
+	{
+		void* reference_blob = NULL;
+		const size_t reference_size = akoEncodeExt(NULL, &s, channels, width, height, image, &reference_blob, NULL);
+
+		assert(reference_size == blob_size);
+		assert(memcmp(reference_blob, blob, blob_size) == 0);
+		akoDefaultFree(reference_blob);
+	}
+
+	// Too small workarea
+	c.workarea_size -= 1;
+	assert(akoEncodeExt(&c, &s, channels, width, height, image, NULL, &status) == 0);
+	assert(status == AKO_NO_ENOUGH_MEMORY);
+
+	// Decode
+	uint8_t* encoded = malloc(blob_size);
+	assert(encoded != NULL);
+	memcpy(encoded, blob, blob_size);
+
+	// Output limit, a byte short of it gives nothing back (workarea or not)
+	for (int i = 0; i < 2; i++)
+	{
+		struct akoCallbacks limited = (i == 0) ? c : akoDefaultCallbacks();
+		limited.workarea_size += 1; // Undo above
+		limited.max_output_size = blob_size - 1;
+
+		void* limited_blob = NULL;
+		assert(akoEncodeExt(&limited, &s, channels, width, height, image, &limited_blob, &status) == 0);
+		assert(status == AKO_OUTPUT_LIMIT_EXCEEDED && limited_blob == NULL);
+
+		limited.max_output_size = blob_size;
+		assert(akoEncodeExt(&limited, &s, channels, width, height, image, NULL, &status) == blob_size);
+		assert(status == AKO_OK);
+	}
+
+	free(c.workarea);
+
+	c.workarea_size = akoDecodeWorkareaSize(&c, blob_size, encoded, &status);
+	c.workarea = malloc(c.workarea_size);
+	assert(status == AKO_OK && c.workarea_size != 0 && c.workarea != NULL);
+
+	uint8_t* decoded = akoDecodeExt(&c, blob_size, encoded, NULL, NULL, NULL, NULL, &status);
+	printf(" - Decode workarea: %zu bytes\n", c.workarea_size);
+
+	assert(status == AKO_OK && decoded != NULL);
+	assert(decoded >= (uint8_t*)c.workarea && decoded < (uint8_t*)c.workarea + c.workarea_size);
+	assert(memcmp(decoded, image, width * height * channels) == 0); // Lossless
+
+	c.workarea_size -= 1;
+	assert(akoDecodeExt(&c, blob_size, encoded, NULL, NULL, NULL, NULL, &status) == NULL);
+	assert(status == AKO_NO_ENOUGH_MEMORY);
+
+	// Bye!
+	free(c.workarea);
+	free(encoded);
+	free(image);
+}
+
+
+int main()
+{
+	sTest(1, 64, 64, 0, 0);
+	sTest(3, 67, 45, 0, 0);
+	sTest(4, 128, 96, 32, 0);
+	sTest(3, 300, 200, 64, 0);
+	sTest(3, 300, 200, 64, 16);
+	sTest(1, 640, 72, 0, 16); // Strips
+
+	// Nothing to allocate with
+	{
+		struct akoCallbacks c = akoDefaultCallbacks();
+		c.free = NULL;
+
+		uint8_t image[8 * 8] = {0};
+		enum akoStatus status;
+
+		assert(akoEncodeExt(&c, NULL, 1, 8, 8, image, NULL, &status) == 0);
+		assert(status == AKO_INVALID_CALLBACKS);
+		assert(akoDecodeExt(&c, sizeof(image), image, NULL, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_CALLBACKS);
+	}
+
+	return 0;
+}
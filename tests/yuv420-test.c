@@ -0,0 +1,105 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void sTest(size_t width, size_t height, size_t tiles_dimension, enum akoWavelet wavelet)
+{
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.quantization = 0;
+	s.wavelet = wavelet;
+
+	const size_t chroma_w = akoDividePlusOneRule(width);
+	const size_t chroma_h = akoDividePlusOneRule(height);
+	const size_t frame_size = width * height + chroma_w * chroma_h * 2;
+
+	uint8_t* i420 = malloc(frame_size);
+	uint8_t* nv12 = malloc(frame_size);
+	assert(i420 != NULL && nv12 != NULL);
+
+	for (size_t i = 0; i < width * height; i++)
+		i420[i] = nv12[i] = (uint8_t)((i % 251) ^ (i / width));
+
+	for (size_t i = 0; i < chroma_w * chroma_h; i++)
+	{
+		const uint8_t u = (uint8_t)(128 + (i % 37));
+		const uint8_t v = (uint8_t)(96 + (i / chroma_w) % 64);
+
+		i420[width * height + i] = u;
+		i420[width * height + chroma_w * chroma_h + i] = v;
+		nv12[width * height + i * 2 + 0] = u;
+		nv12[width * height + i * 2 + 1] = v;
+	}
+
+	// Encode, both layouts describe the same frame
+	void* blob = NULL;
+	void* nv12_blob = NULL;
+	enum akoStatus status;
+
+	const size_t blob_size = akoEncodeYuv420Ext(NULL, &s, AKO_YUV_I420, width, height, i420, &blob, &status);
+	assert(status == AKO_OK && blob_size != 0);
+
+	const size_t nv12_blob_size =
+	    akoEncodeYuv420Ext(NULL, &s, AKO_YUV_NV12, width, height, nv12, &nv12_blob, &status);
+	assert(status == AKO_OK && nv12_blob_size == blob_size);
+	assert(memcmp(blob, nv12_blob, blob_size) == 0);
+
+	printf("%zux%zu px, tiles: %zu, wavelet: %i, frame: %zu bytes, blob: %zu bytes\n", width, height,
+	       tiles_dimension, (int)wavelet, frame_size, blob_size);
+
+	// Decode, lossless
+	size_t w, h, channels;
+	uint8_t* decoded = akoDecodeYuv420Ext(NULL, blob_size, blob, AKO_YUV_I420, NULL, &w, &h, &status);
+	assert(status == AKO_OK && decoded != NULL && w == width && h == height);
+	assert(memcmp(decoded, i420, frame_size) == 0);
+	akoDefaultFree(decoded);
+
+	decoded = akoDecodeYuv420Ext(NULL, blob_size, blob, AKO_YUV_NV12, NULL, &w, &h, &status);
+	assert(status == AKO_OK && decoded != NULL);
+	assert(memcmp(decoded, nv12, frame_size) == 0);
+	akoDefaultFree(decoded);
+
+	// Normal decoding gives chroma at full resolution, luma untouched
+	decoded = akoDecodeExt(NULL, blob_size, blob, NULL, &channels, &w, &h, &status);
+	assert(status == AKO_OK && decoded != NULL && channels == 3);
+
+	for (size_t i = 0; i < width * height; i++)
+		assert(decoded[i * 3] == i420[i]);
+
+	akoDefaultFree(decoded);
+
+	// Bye!
+	akoDefaultFree(blob);
+	akoDefaultFree(nv12_blob);
+	free(i420);
+	free(nv12);
+}
+
+
+int main()
+{
+	sTest(64, 64, 0, AKO_WAVELET_DD137);
+	sTest(67, 45, 0, AKO_WAVELET_CDF53);
+	sTest(300, 200, 64, AKO_WAVELET_DD137);
+	sTest(301, 203, 32, AKO_WAVELET_HAAR);
+
+	// Not from a Yuv 4:2:0 frame
+	{
+		uint8_t image[16 * 16 * 3] = {0};
+		void* blob = NULL;
+		enum akoStatus status;
+
+		const size_t blob_size = akoEncodeExt(NULL, NULL, 3, 16, 16, image, &blob, &status);
+		assert(status == AKO_OK && blob_size != 0);
+
+		assert(akoDecodeYuv420Ext(NULL, blob_size, blob, AKO_YUV_I420, NULL, NULL, NULL, &status) == NULL);
+		assert(status == AKO_INVALID_COLOR_TRANSFORMATION);
+		akoDefaultFree(blob);
+	}
+
+	return 0;
+}
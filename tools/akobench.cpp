@@ -0,0 +1,854 @@
+/*
+
+MIT License
+
+Copyright (c) 2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#include "allocators.hpp"
+#include "benchmark.hpp"
+#include "json.hpp"
+#include "misc.hpp"
+#include "options.hpp"
+#include "png.hpp"
+#include "statistics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+extern "C"
+{
+#include "ako.h"
+}
+
+#define VERSION_MAJOR 0
+#define VERSION_MINOR 2
+#define VERSION_PATCH 0
+
+#define RESULTS_VERSION 1
+
+
+static const char* STAGES[] = {"total", "format", "wavelet", "compression"};
+
+enum class Load
+{
+	None = 0,
+	Encode,
+	Decode
+};
+
+
+std::vector<std::string> SplitList(const std::string& str)
+{
+	auto list = std::vector<std::string>();
+	size_t start = 0;
+
+	while (start < str.size())
+	{
+		size_t end = str.find(',', start);
+		if (end == std::string::npos)
+			end = str.size();
+
+		if (end != start)
+			list.emplace_back(str.substr(start, end - start));
+
+		start = end + 1;
+	}
+
+	return list;
+}
+
+
+std::string SettingsString(const akoSettings& s)
+{
+	const char* wavelet[] = {"DD137", "CDF53", "HAAR", "NONE"};
+	const char* color[] = {"YCOCG", "SUBTRACT-G", "NONE", "YCOCG"};
+	const char* wrap[] = {"CLAMP", "MIRROR", "REPEAT", "ZERO"};
+	const char* compression[] = {"KAGARI", "MANBAVARAN", "NONE"};
+
+	return std::string(wavelet[s.wavelet]) + " " + color[s.color] + " " + wrap[s.wrap] + " " +
+	       compression[s.compression] + " q" + std::to_string(s.quantization) + " g" + std::to_string(s.gate) + " t" +
+	       std::to_string(s.tiles_dimension) + ((s.tiles_height != 0) ? "x" + std::to_string(s.tiles_height) : "") +
+	       " cl" + std::to_string(s.chroma_loss) + " d" +
+	       std::to_string(s.discard_non_visible) + ((s.order == AKO_ORDER_MORTON) ? " morton" : "") +
+	       ((s.code_blocks != 0) ? " cb" + std::to_string(s.code_blocks) : "") +
+	       ((s.downscale != 0) ? " ds" + std::to_string(s.downscale) : "") +
+	       ((s.target_psnr > 0.0F) ? " psnr" + std::to_string((int)s.target_psnr) : "");
+}
+
+
+static void sPushStages(JsonValue& samples, const std::string& prefix, const Stopwatch& total,
+                        const EventsData& events_data)
+{
+	const double values[] = {total.get_milliseconds(), events_data.format.get_milliseconds(),
+	                         events_data.wavelet.get_milliseconds(), events_data.compression.get_milliseconds()};
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		const auto key = prefix + "." + STAGES[i];
+		JsonValue array = (samples.has(key) == true) ? samples.at(key) : JsonValue::Array();
+		array.push(JsonValue(values[i]));
+		samples.set(key, array);
+	}
+}
+
+
+JsonValue RunCase(const std::string& filename, const PngImage& png, const akoSettings& settings, size_t runs)
+{
+	auto samples = JsonValue::Object();
+	size_t blob_size = 0;
+
+	// One extra run, to warm caches and allocator
+	for (size_t r = 0; r < runs + 1; r++)
+	{
+		Stopwatch total;
+		EventsData events_data;
+		events_data.quiet = true;
+
+		akoCallbacks callbacks = akoDefaultCallbacks();
+		callbacks.events = EventsCallback;
+		callbacks.events_data = &events_data;
+
+		akoStatus status = AKO_ERROR;
+		void* blob = NULL;
+
+		// Encode
+		total.start(true);
+		blob_size = akoEncodeExt(&callbacks, &settings, png.get_channels(), png.get_width(), png.get_height(),
+		                         png.get_data(), &blob, &status);
+		total.pause_stop(false, "");
+
+		if (blob_size == 0)
+			throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "' (" + filename + ")");
+
+		if (r != 0)
+			sPushStages(samples, "encode", total, events_data);
+
+		// Decode
+		total.start(true);
+		uint8_t* image = akoDecodeExt(&callbacks, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+		total.pause_stop(false, "");
+
+		akoDefaultFree(blob);
+		if (image == NULL)
+			throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "' (" + filename + ")");
+
+		akoDefaultFree(image);
+
+		if (r != 0)
+			sPushStages(samples, "decode", total, events_data);
+	}
+
+	// Bye!
+	auto c = JsonValue::Object();
+	c.set("image", JsonValue(filename));
+	c.set("settings", JsonValue(SettingsString(settings)));
+	c.set("width", JsonValue((double)png.get_width()));
+	c.set("height", JsonValue((double)png.get_height()));
+	c.set("channels", JsonValue((double)png.get_channels()));
+	c.set("size", JsonValue((double)blob_size));
+	c.set("samples", samples);
+
+	return c;
+}
+
+
+void AkoBench(const std::vector<std::string>& inputs, const akoSettings& settings, size_t runs,
+              const std::string& filename_output, bool quiet)
+{
+	if (inputs.size() == 0)
+		throw ErrorStr("No input filename specified");
+
+	auto cases = JsonValue::Array();
+
+	for (const auto& filename : inputs)
+	{
+		const auto png = std::unique_ptr<PngImage>(new PngImage(filename));
+		const auto c = RunCase(filename, *png, settings, runs);
+		cases.push(c);
+
+		if (quiet == false)
+		{
+			const auto& samples = c.at("samples");
+			std::printf("%s [%s]: encode %.3f ms, decode %.3f ms (median of %zu), %.2f kB\n", filename.c_str(),
+			            SettingsString(settings).c_str(), Median(ToVector(samples.at("encode.total"))),
+			            Median(ToVector(samples.at("decode.total"))), runs, c.at("size").get_number() / 1000.0);
+		}
+	}
+
+	// Write output
+	if (filename_output != "")
+	{
+		auto results = JsonValue::Object();
+		results.set("akobench", JsonValue((double)RESULTS_VERSION));
+		results.set("libako", JsonValue(std::to_string(akoVersionMajor()) + "." + std::to_string(akoVersionMinor()) +
+		                                "." + std::to_string(akoVersionPatch())));
+		results.set("format", JsonValue((double)akoFormatVersion()));
+		results.set("runs", JsonValue((double)runs));
+		results.set("cases", cases);
+
+		const auto text = results.dump() + "\n";
+		WriteBlob(filename_output, text.data(), text.size());
+	}
+}
+
+
+static double sMegabytesPerSecond(size_t bytes, double milliseconds)
+{
+	return (milliseconds > 0.0) ? ((double)bytes / 1000000.0) / (milliseconds / 1000.0) : 0.0;
+}
+
+
+static JsonValue sCodec(const std::string& name, size_t size, const JsonValue& encode, const JsonValue& decode)
+{
+	auto c = JsonValue::Object();
+	c.set("codec", JsonValue(name));
+	c.set("size", JsonValue((double)size));
+	c.set("encode", encode);
+	c.set("decode", decode);
+	return c;
+}
+
+
+static JsonValue sRawCase(const PngImage& png, size_t runs)
+{
+	// What any codec has to beat, moving the pixels around once
+	const size_t size = png.get_width() * png.get_height() * png.get_channels();
+	auto buffer = std::vector<uint8_t>(size);
+	auto samples = JsonValue::Array();
+
+	for (size_t r = 0; r < runs + 1; r++)
+	{
+		Stopwatch total;
+		total.start(true);
+		std::memcpy(buffer.data(), png.get_data(), size);
+		total.pause_stop(false, "");
+
+		if (r != 0)
+			samples.push(JsonValue(total.get_milliseconds()));
+	}
+
+	return sCodec("raw", size, samples, samples);
+}
+
+
+static JsonValue sPngCase(const std::string& filename, const PngImage& png, int effort, size_t runs)
+{
+	const LodePNGColorType colortype[] = {LCT_GREY, LCT_GREY_ALPHA, LCT_RGB, LCT_RGBA};
+	auto encode = JsonValue::Array();
+	auto decode = JsonValue::Array();
+	size_t blob_size = 0;
+
+	for (size_t r = 0; r < runs + 1; r++)
+	{
+		Stopwatch total;
+
+		// Encode
+		total.start(true);
+		void* blob = EncodePng(png.get_data(), png.get_channels(), png.get_width(), png.get_height(), effort,
+		                       &blob_size);
+		total.pause_stop(false, "");
+
+		if (r != 0)
+			encode.push(JsonValue(total.get_milliseconds()));
+
+		// Decode
+		unsigned char* image = NULL;
+		unsigned width;
+		unsigned height;
+
+		total.start(true);
+		const unsigned error = lodepng_decode_memory(&image, &width, &height, (const unsigned char*)blob, blob_size,
+		                                             colortype[png.get_channels() - 1], 8);
+		total.pause_stop(false, "");
+
+		free(blob);
+		free(image);
+		if (error != 0)
+			throw ErrorStr("LodePng error: '" + std::string(lodepng_error_text(error)) + "' (" + filename + ")");
+
+		if (r != 0)
+			decode.push(JsonValue(total.get_milliseconds()));
+	}
+
+	return sCodec("png-e" + std::to_string(effort), blob_size, encode, decode);
+}
+
+
+int AkoHeadToHead(const std::vector<std::string>& inputs, const akoSettings& settings,
+                  const std::vector<int>& png_efforts, size_t runs, const std::string& filename_output, bool quiet)
+{
+	if (inputs.size() == 0)
+		throw ErrorStr("No input filename specified");
+
+	auto cases = JsonValue::Array();
+	int slower = 0;
+
+	for (const auto& filename : inputs)
+	{
+		const auto png = std::unique_ptr<PngImage>(new PngImage(filename));
+		const size_t raw_size = png->get_width() * png->get_height() * png->get_channels();
+
+		// Same image, same machine, one after the other
+		auto codecs = JsonValue::Array();
+		codecs.push(sRawCase(*png, runs));
+		{
+			const auto c = RunCase(filename, *png, settings, runs);
+			codecs.push(sCodec("ako", (size_t)c.at("size").get_number(), c.at("samples").at("encode.total"),
+			                   c.at("samples").at("decode.total")));
+		}
+		for (const auto effort : png_efforts)
+			codecs.push(sPngCase(filename, *png, effort, runs));
+
+		// Where Ako decodes slower than PNG, at any effort, it is slower
+		// than the format it replaces
+		const double ako_decode = Median(ToVector(codecs.get_array()[1].at("decode")));
+		bool flag = false;
+
+		for (size_t i = 2; i < codecs.get_array().size(); i++)
+		{
+			if (Median(ToVector(codecs.get_array()[i].at("decode"))) < ako_decode)
+				flag = true;
+		}
+
+		slower += (flag == true) ? 1 : 0;
+
+		if (quiet == false)
+		{
+			std::printf("\n%s (%zux%zu px, %zu channels), median of %zu:\n", filename.c_str(), png->get_width(),
+			            png->get_height(), png->get_channels(), runs);
+
+			for (const auto& c : codecs.get_array())
+			{
+				const auto& name = c.at("codec").get_string();
+				const double size = c.at("size").get_number();
+
+				std::printf(" - %-8s encode %9.2f MB/s, decode %9.2f MB/s, %7.3f bpp, %9.2f kB%s\n", name.c_str(),
+				            sMegabytesPerSecond(raw_size, Median(ToVector(c.at("encode")))),
+				            sMegabytesPerSecond(raw_size, Median(ToVector(c.at("decode")))),
+				            size * 8.0 / (double)(png->get_width() * png->get_height()), size / 1000.0,
+				            (name == "ako" && flag == true) ? "  SLOWER DECODE THAN PNG" : "");
+			}
+		}
+
+		auto c = JsonValue::Object();
+		c.set("image", JsonValue(filename));
+		c.set("settings", JsonValue(SettingsString(settings)));
+		c.set("width", JsonValue((double)png->get_width()));
+		c.set("height", JsonValue((double)png->get_height()));
+		c.set("channels", JsonValue((double)png->get_channels()));
+		c.set("codecs", codecs);
+		cases.push(c);
+	}
+
+	if (quiet == false)
+		std::printf("\n%i image(s) where Ako decodes slower than PNG\n", slower);
+
+	// Write output
+	if (filename_output != "")
+	{
+		auto results = JsonValue::Object();
+		results.set("akobench", JsonValue((double)RESULTS_VERSION));
+		results.set("libako", JsonValue(std::to_string(akoVersionMajor()) + "." + std::to_string(akoVersionMinor()) +
+		                                "." + std::to_string(akoVersionPatch())));
+		results.set("format", JsonValue((double)akoFormatVersion()));
+		results.set("lodepng", JsonValue(std::string(LODEPNG_VERSION_STRING)));
+		results.set("runs", JsonValue((double)runs));
+		results.set("head_to_head", cases);
+
+		const auto text = results.dump() + "\n";
+		WriteBlob(filename_output, text.data(), text.size());
+	}
+
+	return (slower == 0) ? 0 : 1;
+}
+
+
+struct LoadImage
+{
+	std::string filename;
+	std::unique_ptr<PngImage> png;
+	std::vector<uint8_t> blob;
+};
+
+
+static void sLoadWorker(const std::vector<LoadImage>& corpus, const akoSettings& settings, Load load,
+                        Allocator allocator, size_t offset, const std::atomic<bool>& stop,
+                        std::vector<double>& latencies, akoStats& stats, std::string& error)
+{
+	akoCallbacks callbacks = AllocatorCallbacks(allocator);
+	callbacks.stats = &stats; // Shared by all workers
+
+	// Every worker starts at a different image, otherwise all
+	// threads will step on the same sizes at the same time
+	for (size_t i = offset; stop.load(std::memory_order_relaxed) == false; i++)
+	{
+		const auto& image = corpus[i % corpus.size()];
+		akoStatus status = AKO_ERROR;
+		void* output = NULL;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		if (load == Load::Encode)
+		{
+			if (akoEncodeExt(&callbacks, &settings, image.png->get_channels(), image.png->get_width(),
+			                 image.png->get_height(), image.png->get_data(), &output, &status) == 0)
+				output = NULL;
+		}
+		else
+			output = akoDecodeExt(&callbacks, image.blob.size(), image.blob.data(), NULL, NULL, NULL, NULL, &status);
+
+		const auto end = std::chrono::steady_clock::now();
+
+		if (output == NULL)
+		{
+			error = "Ako error: '" + std::string(akoStatusString(status)) + "' (" + image.filename + ")";
+			return;
+		}
+
+		callbacks.free(output);
+		AllocatorRecycle(allocator);
+
+		latencies.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+}
+
+
+void AkoLoad(const std::vector<std::string>& inputs, const akoSettings& settings, Load load, Allocator allocator,
+             size_t threads, double duration, const std::string& filename_output, bool quiet)
+{
+	const char* load_name[] = {"NONE", "ENCODE", "DECODE"};
+	const char* allocator_name[] = {"MALLOC", "ARENA", "POOL"};
+
+	if (inputs.size() == 0)
+		throw ErrorStr("No input filename specified");
+
+	// Load corpus, decoding load encodes everything beforehand
+	auto corpus = std::vector<LoadImage>(inputs.size());
+
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		corpus[i].filename = inputs[i];
+		corpus[i].png = std::unique_ptr<PngImage>(new PngImage(inputs[i]));
+
+		if (load == Load::Decode)
+		{
+			akoCallbacks callbacks = akoDefaultCallbacks();
+			akoStatus status = AKO_ERROR;
+			void* blob = NULL;
+
+			const size_t blob_size =
+			    akoEncodeExt(&callbacks, &settings, corpus[i].png->get_channels(), corpus[i].png->get_width(),
+			                 corpus[i].png->get_height(), corpus[i].png->get_data(), &blob, &status);
+
+			if (blob_size == 0)
+				throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "' (" + inputs[i] + ")");
+
+			corpus[i].blob.assign((uint8_t*)blob, (uint8_t*)blob + blob_size);
+			akoDefaultFree(blob);
+		}
+	}
+
+	// Run workers
+	std::atomic<bool> stop(false);
+	auto workers = std::vector<std::thread>();
+	auto latencies = std::vector<std::vector<double>>(threads);
+	auto errors = std::vector<std::string>(threads);
+
+	if (quiet == false)
+		std::printf("%s load, %zu thread(s), %.1f s, %s allocator, %zu image(s) [%s]...\n", load_name[(int)load],
+		            threads, duration, allocator_name[(int)allocator], corpus.size(),
+		            SettingsString(settings).c_str());
+
+	akoStats stats = {};
+	const auto start = std::chrono::steady_clock::now();
+
+	for (size_t t = 0; t < threads; t++)
+		workers.emplace_back(sLoadWorker, std::cref(corpus), std::cref(settings), load, allocator, t, std::cref(stop),
+		                     std::ref(latencies[t]), std::ref(stats), std::ref(errors[t]));
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+	stop.store(true);
+
+	for (auto& w : workers)
+		w.join();
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (const auto& e : errors)
+	{
+		if (e != "")
+			throw ErrorStr(e);
+	}
+
+	// Gather
+	auto all = std::vector<double>();
+	for (size_t t = 0; t < threads; t++)
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+
+	akoStats total;
+	akoStatsRead(&stats, &total);
+
+	if (all.size() == 0)
+		throw ErrorStr("No image completed, try a longer '--duration'");
+
+	const double throughput = (double)all.size() / elapsed;
+	const double mpx = (double)total.pixels / elapsed / 1000000.0;
+	const double p50 = Percentile(all, 50.0);
+	const double p99 = Percentile(all, 99.0);
+	const double p999 = Percentile(all, 99.9);
+	const double max = Percentile(all, 100.0);
+
+	if (quiet == false)
+	{
+		std::printf(" - Throughput: %.2f images/s, %.2f Mpx/s (%zu images)\n", throughput, mpx, all.size());
+		std::printf(" - Latency: p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms\n", p50, p99, p999, max);
+		std::printf(" - Stages, summed over threads: format %.1f ms, wavelet %.1f ms, compression %.1f ms\n",
+		            (double)total.format_ns / 1000000.0, (double)total.wavelet_ns / 1000000.0,
+		            (double)total.compression_ns / 1000000.0);
+	}
+
+	// Write output
+	if (filename_output != "")
+	{
+		auto l = JsonValue::Object();
+		l.set("load", JsonValue(load_name[(int)load]));
+		l.set("allocator", JsonValue(allocator_name[(int)allocator]));
+		l.set("settings", JsonValue(SettingsString(settings)));
+		l.set("threads", JsonValue((double)threads));
+		l.set("duration", JsonValue(elapsed));
+		l.set("images", JsonValue((double)all.size()));
+		l.set("throughput", JsonValue(throughput));
+		l.set("mpx", JsonValue(mpx));
+		l.set("p50", JsonValue(p50));
+		l.set("p99", JsonValue(p99));
+		l.set("p999", JsonValue(p999));
+		l.set("max", JsonValue(max));
+		l.set("format", JsonValue((double)total.format_ns / 1000000.0));
+		l.set("wavelet", JsonValue((double)total.wavelet_ns / 1000000.0));
+		l.set("compression", JsonValue((double)total.compression_ns / 1000000.0));
+		l.set("blob_bytes", JsonValue((double)total.blob_bytes));
+
+		auto corpus_list = JsonValue::Array();
+		for (const auto& image : corpus)
+			corpus_list.push(JsonValue(image.filename));
+		l.set("corpus", corpus_list);
+
+		auto results = JsonValue::Object();
+		results.set("akobench", JsonValue((double)RESULTS_VERSION));
+		results.set("libako", JsonValue(std::to_string(akoVersionMajor()) + "." + std::to_string(akoVersionMinor()) +
+		                                "." + std::to_string(akoVersionPatch())));
+		results.set("format", JsonValue((double)akoFormatVersion()));
+		results.set("load", l);
+
+		const auto text = results.dump() + "\n";
+		WriteBlob(filename_output, text.data(), text.size());
+	}
+}
+
+
+int AkoCompare(const std::string& filename_baseline, const std::string& filename_candidate, double threshold,
+               double confidence)
+{
+	const auto baseline = ReadJson(filename_baseline);
+	const auto candidate = ReadJson(filename_candidate);
+	const double alpha = 1.0 - confidence;
+
+	int regressions = 0;
+	std::printf("Comparing '%s' (a) against '%s' (b), threshold: %.1f%%, confidence: %.0f%%\n",
+	            filename_baseline.c_str(), filename_candidate.c_str(), threshold, confidence * 100.0);
+
+	// Match cases by image and settings
+	for (const auto& b : candidate.at("cases").get_array())
+	{
+		const JsonValue* a = NULL;
+		for (const auto& c : baseline.at("cases").get_array())
+		{
+			if (c.at("image").get_string() == b.at("image").get_string() &&
+			    c.at("settings").get_string() == b.at("settings").get_string())
+				a = &c;
+		}
+
+		std::printf("\n%s [%s]:\n", b.at("image").get_string().c_str(), b.at("settings").get_string().c_str());
+
+		if (a == NULL)
+		{
+			std::printf(" - Only in (b), nothing to compare\n");
+			continue;
+		}
+
+		if (a->at("size").get_number() != b.at("size").get_number())
+			std::printf(" - Size: %.2f kB -> %.2f kB (%+.2f%%)\n", a->at("size").get_number() / 1000.0,
+			            b.at("size").get_number() / 1000.0,
+			            (b.at("size").get_number() / a->at("size").get_number() - 1.0) * 100.0);
+
+		// Per stage
+		for (const auto& item : b.at("samples").get_object())
+		{
+			if (a->at("samples").has(item.first) == false)
+				continue;
+
+			const auto samples_a = ToVector(a->at("samples").at(item.first));
+			const auto samples_b = ToVector(item.second);
+
+			const double median_a = Median(samples_a);
+			const double median_b = Median(samples_b);
+			if (median_a <= 0.0)
+				continue;
+
+			double ci_low;
+			double ci_high;
+			BootstrapRatioOfMedians(samples_a, samples_b, confidence, ci_low, ci_high);
+
+			const double delta = (median_b / median_a - 1.0) * 100.0;
+			const double p = MannWhitneyP(samples_a, samples_b);
+
+			const char* verdict = "";
+			if (p < alpha && delta > threshold)
+			{
+				verdict = "  REGRESSION";
+				regressions++;
+			}
+			else if (p < alpha && delta < -threshold)
+				verdict = "  improvement";
+
+			std::printf(" - %-20s %9.3f -> %9.3f ms, %+7.2f%% [%+.2f%%, %+.2f%%], p: %.4f%s\n", item.first.c_str(),
+			            median_a, median_b, delta, (ci_low - 1.0) * 100.0, (ci_high - 1.0) * 100.0, p, verdict);
+		}
+	}
+
+	for (const auto& a : baseline.at("cases").get_array())
+	{
+		bool found = false;
+		for (const auto& b : candidate.at("cases").get_array())
+		{
+			if (a.at("image").get_string() == b.at("image").get_string() &&
+			    a.at("settings").get_string() == b.at("settings").get_string())
+				found = true;
+		}
+
+		if (found == false)
+			std::printf("\n%s [%s]:\n - Only in (a), nothing to compare\n", a.at("image").get_string().c_str(),
+			            a.at("settings").get_string().c_str());
+	}
+
+	std::printf("\n%i regression(s)\n", regressions);
+	return (regressions == 0) ? 0 : 1;
+}
+
+
+int main(int argc, const char* argv[])
+{
+	akoSettings settings = akoDefaultSettings();
+	std::vector<std::string> inputs;
+	std::string output_filename;
+	std::string baseline_filename;
+	std::string candidate_filename;
+	size_t runs = 10;
+	double threshold = 5.0;
+	double confidence = 0.95;
+	bool quiet = false;
+
+	bool head_to_head = false;
+	std::vector<int> png_efforts;
+
+	Load load = Load::None;
+	Allocator allocator = Allocator::Malloc;
+	size_t threads = 1;
+	double duration = 10.0;
+
+	// Options
+	{
+		auto opts = OptionsManager();
+
+		const auto print_category = opts.add_category("PRINT OPTIONS");
+		opts.add_bool("-v", "--version", "Print program version and license terms.", print_category);
+		opts.add_bool("-h", "--help", "Print this help.", print_category);
+		opts.add_bool("-quiet", "--quiet", "Don't print anything.", print_category);
+
+		const auto io_category = opts.add_category("INPUT/OUTPUT OPTIONS");
+		opts.add_string("-i", "--input", "Input filenames separated by commas. Only PNG files supported.", "", "",
+		                io_category);
+		opts.add_string("-o", "--output", "Json filename where to save results.", "", "", io_category);
+
+		const auto bench_category = opts.add_category("BENCHMARK OPTIONS");
+		opts.add_integer("-r", "--runs", "Encode and decode repetitions per image.", 10, 1, 100000, bench_category);
+		opts.add_bool("-hh", "--head-to-head",
+		              "Instead of benchmarking stages, report Ako throughput and bits per pixel alongside PNG (at "
+		              "'--png-efforts') and a raw copy of the same images. Exits with error where Ako decodes slower "
+		              "than PNG.",
+		              bench_category);
+		opts.add_string("-pe", "--png-efforts", "PNG efforts, from 1 to 10 (see akodec), separated by commas.",
+		                "1,7,10", "", bench_category);
+
+		const auto load_category = opts.add_category("CONCURRENT LOAD OPTIONS");
+		opts.add_string("-l", "--load",
+		                "Instead of benchmarking stages, run '--threads' workers encoding or decoding input images "
+		                "continuously for '--duration' seconds, then report throughput and latency percentiles. "
+		                "Options are: NONE, ENCODE and DECODE.",
+		                "NONE", "NONE ENCODE DECODE", load_category);
+		opts.add_integer("-t", "--threads", "Concurrent workers.",
+		                 (int)std::max(1U, std::thread::hardware_concurrency()), 1, 1024, load_category);
+		opts.add_float("-s", "--duration", "Seconds to keep load.", 10.0F, 0.1F, 86400.0F, load_category);
+		opts.add_string("-al", "--allocator",
+		                "Allocator workers use. Options are: MALLOC, ARENA (bump allocator reset after every image) "
+		                "and POOL (size classes recycled between images).",
+		                "MALLOC", "MALLOC ARENA POOL", load_category);
+
+		const auto encoding_category = opts.add_category("ENCODING OPTIONS (see akoenc)");
+		opts.add_integer("-q", "--quantization", "", 16, 0, 8192, encoding_category);
+		opts.add_integer("-g", "--noise-gate", "", 0, 0, 8192, encoding_category);
+		opts.add_string("-w", "--wavelet", "", "DD137", "DD137 CDF53 HAAR NONE", encoding_category);
+		opts.add_string("-c", "--color", "", "YCOCG", "YCOCG SUBTRACT-G NONE", encoding_category);
+		opts.add_string("-wr", "--wrap", "", "CLAMP", "CLAMP MIRROR REPEAT ZERO", encoding_category);
+		opts.add_integer("-chroma-loss", "--chroma-loss", "", 1, 0, 8192, encoding_category);
+		opts.add_bool("-d", "--discard-non-visible", "", encoding_category);
+		opts.add_integer("-tiles", "--tiles", "", 0, 0, 1073741824, encoding_category);
+		opts.add_integer("-tiles-height", "--tiles-height", "", 0, 0, 1073741824, encoding_category);
+		opts.add_string("-order", "--order", "", "RASTER", "RASTER MORTON", encoding_category);
+		opts.add_integer("-code-blocks", "--code-blocks", "", 0, 0, 131072, encoding_category);
+		opts.add_integer("-downscale", "--downscale", "", 0, 0, 16, encoding_category);
+		opts.add_float("-psnr", "--target-psnr", "", 0.0F, 0.0F, 100.0F, encoding_category);
+
+		const auto compare_category = opts.add_category("COMPARE OPTIONS");
+		opts.add_string("-a", "--baseline", "Json results to compare against.", "", "", compare_category);
+		opts.add_string("-b", "--candidate", "Json results to compare. Matched to baseline by image and settings.",
+		                "", "", compare_category);
+		opts.add_float("-th", "--threshold",
+		               "Slowdown, in percent, from where a significant difference is flagged as a regression.", 5.0F,
+		               0.0F, 1000.0F, compare_category);
+		opts.add_float("-cl", "--confidence", "Confidence level for intervals and tests, from 0.5 to 0.999.", 0.95F,
+		               0.5F, 0.999F, compare_category);
+
+		if (opts.parse_arguments(argc, argv) != 0)
+			return 1;
+
+		// Help message
+		if (opts.get_bool("--help") == true)
+		{
+			std::printf("USAGE\n");
+			std::printf("    akobench [optional options] -i <input filenames> -o <output filename>\n");
+			std::printf("    akobench [optional options] -hh -i <input filenames>\n");
+			std::printf("    akobench [optional options] -l <ENCODE|DECODE> -i <input filenames>\n");
+			std::printf("    akobench [optional options] -a <baseline filename> -b <candidate filename>\n");
+			std::printf("\n    First form benchmarks, second one compares against PNG, third one puts concurrent "
+			            "load, and fourth one compares two benchmark results.\n");
+			std::printf("\n");
+
+			opts.print_help();
+
+			return 0;
+		}
+
+		// Version message
+		if (opts.get_bool("--version") == true)
+		{
+			std::printf("Ako benchmark tool v%i.%i.%i\n", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
+			std::printf(" - libako v%i.%i.%i, format %i\n", akoVersionMajor(), akoVersionMinor(), akoVersionPatch(),
+			            akoFormatVersion());
+			std::printf(" - lodepng %s\n", LODEPNG_VERSION_STRING);
+			std::printf("\n");
+			std::printf("Copyright (c) 2021-2022 Alexander Brandt. Under MIT License.\n");
+			std::printf("\n");
+			std::printf("More information at 'https://github.com/baAlex/Ako'\n");
+			return 0;
+		}
+
+		// Set settings
+		inputs = SplitList(opts.get_string("--input"));
+		output_filename = opts.get_string("--output");
+		baseline_filename = opts.get_string("--baseline");
+		candidate_filename = opts.get_string("--candidate");
+
+		runs = (size_t)opts.get_integer("--runs");
+		threshold = (double)opts.get_float("--threshold");
+		confidence = (double)opts.get_float("--confidence");
+		quiet = opts.get_bool("--quiet");
+
+		head_to_head = opts.get_bool("--head-to-head");
+		for (const auto& e : SplitList(opts.get_string("--png-efforts")))
+		{
+			const int effort = std::atoi(e.c_str());
+			if (effort < 1 || effort > 10)
+			{
+				std::cerr << "Error, invalid value '" << e << "' for option '--png-efforts'.\n";
+				return 1;
+			}
+
+			png_efforts.push_back(effort);
+		}
+
+		load = (Load)opts.get_string_index("--load");
+		allocator = (Allocator)opts.get_string_index("--allocator");
+		threads = (size_t)opts.get_integer("--threads");
+		duration = (double)opts.get_float("--duration");
+
+		settings.quantization = opts.get_integer("--quantization");
+		settings.gate = opts.get_integer("--noise-gate");
+		settings.discard_non_visible = opts.get_bool("--discard-non-visible");
+		settings.wavelet = (akoWavelet)opts.get_string_index("--wavelet");
+		settings.color = (akoColor)opts.get_string_index("--color");
+		settings.wrap = (akoWrap)opts.get_string_index("--wrap");
+		settings.chroma_loss = opts.get_integer("--chroma-loss");
+		settings.tiles_dimension = (size_t)opts.get_integer("--tiles");
+		settings.tiles_height = (size_t)opts.get_integer("--tiles-height");
+		settings.order = (akoOrder)opts.get_string_index("--order");
+		settings.code_blocks = (size_t)opts.get_integer("--code-blocks");
+		settings.downscale = opts.get_integer("--downscale");
+		settings.target_psnr = opts.get_float("--target-psnr");
+	}
+
+	// Benchmark or compare!
+	try
+	{
+		if (baseline_filename != "" || candidate_filename != "")
+		{
+			if (baseline_filename == "" || candidate_filename == "")
+				throw ErrorStr("Comparing requires both '--baseline' and '--candidate'");
+
+			return AkoCompare(baseline_filename, candidate_filename, threshold, confidence);
+		}
+
+		if (load != Load::None)
+		{
+			AkoLoad(inputs, settings, load, allocator, threads, duration, output_filename, quiet);
+			return 0;
+		}
+
+		if (head_to_head == true)
+			return AkoHeadToHead(inputs, settings, png_efforts, runs, output_filename, quiet);
+
+		AkoBench(inputs, settings, runs, output_filename, quiet);
+		return 0;
+	}
+	catch (ErrorStr& e)
+	{
+		std::cout << e.info << "\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,663 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "misc.hpp"
+#include "options.hpp"
+#include "scheduler.hpp"
+#include "statistics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern "C"
+{
+#include "ako.h"
+}
+
+#define VERSION_MAJOR 0
+#define VERSION_MINOR 1
+#define VERSION_PATCH 0
+
+#define MAX_LINE_LENGTH 8192
+
+
+// Protocol, one request per line, one reply line per request:
+//    DECODE <filename>
+//    BATCH <filename>
+//    -> OK <shared memory name> <bytes> <width> <height> <channels>
+//    -> ERROR <message>
+//
+// Both decode, but 'BATCH' ones give way to 'DECODE' ones (interactive), at
+// tile boundaries, whenever these are waiting.
+//
+// Decoded pixels, interleaved, are left in a Posix shared memory object.
+// From there it belongs to the caller: shm_open() it, mmap() it, and
+// shm_unlink() it once done.
+
+
+class Context
+{
+	// A warm decoder, memory stays between requests. Not thread safe, one per worker
+	// and priority. With a scheduler, decoding yields to it after every tile
+  private:
+	std::vector<uint8_t> blob;
+	std::vector<uint8_t> workarea;
+	akoCallbacks callbacks;
+
+	Scheduler* scheduler;
+	size_t worker;
+
+	static void Events(size_t, size_t, akoEvent event, void* data)
+	{
+		const auto context = (const Context*)data;
+		if (event == AKO_EVENT_FORMAT_END) // Last stage of a tile, when decoding
+			context->scheduler->yield(context->worker);
+	}
+
+  public:
+	Context(size_t max_pixels, size_t max_memory, Scheduler* yield_to = nullptr, size_t worker = 0)
+	    : scheduler(yield_to), worker(worker)
+	{
+		callbacks = akoDefaultCallbacks();
+		callbacks.max_pixels = max_pixels;
+		callbacks.max_memory = max_memory;
+
+		if (scheduler != nullptr)
+		{
+			callbacks.events = Events;
+			callbacks.events_data = this;
+		}
+	}
+
+	Context(const Context&) = delete; // Callbacks point to it
+
+	std::string decode(const std::string& filename, const std::string& shm_name)
+	{
+		// Read file
+		{
+			struct stat info; // Directories open fine, and tell absurd sizes
+			if (stat(filename.c_str(), &info) != 0)
+				throw ErrorStr("Error at opening file '" + filename + "'");
+			if (S_ISREG(info.st_mode) == 0)
+				throw ErrorStr("Error at opening file '" + filename + "', not a regular file");
+
+			auto file = std::fstream(filename, std::ios::binary | std::ios_base::in | std::ios::ate);
+
+			if (file.fail() == true)
+				throw ErrorStr("Error at opening file '" + filename + "'");
+
+			const std::streamoff size = file.tellg();
+			if (size < 0)
+				throw ErrorStr("Error at reading file '" + filename + "'");
+
+			blob.resize((size_t)size);
+			file.seekg(0, std::ios::beg);
+			file.read((char*)blob.data(), blob.size());
+
+			if (file.fail() == true)
+				throw ErrorStr("Error at reading file '" + filename + "'");
+		}
+
+		// Decode, in a workarea that only grows
+		akoStatus status = AKO_ERROR;
+		size_t width, height, channels;
+
+		const size_t workarea_size = akoDecodeWorkareaSize(&callbacks, blob.size(), blob.data(), &status);
+		if (workarea_size == 0)
+			throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "'");
+
+		if (workarea.size() < workarea_size)
+			workarea.resize(workarea_size);
+
+		callbacks.workarea = workarea.data();
+		callbacks.workarea_size = workarea.size();
+
+		const uint8_t* image = akoDecodeExt(&callbacks, blob.size(), blob.data(), NULL, &channels, &width, &height,
+		                                    &status);
+		if (image == NULL)
+			throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "'");
+
+		// Hand it in shared memory
+		const size_t size = width * height * channels;
+
+		const int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0)
+			throw ErrorStr("Error at creating shared memory '" + shm_name + "'");
+
+		void* shared = MAP_FAILED;
+		if (ftruncate(fd, (off_t)size) == 0)
+			shared = mmap(NULL, size, PROT_WRITE, MAP_SHARED, fd, 0);
+
+		close(fd);
+
+		if (shared == MAP_FAILED)
+		{
+			shm_unlink(shm_name.c_str());
+			throw ErrorStr("Error at mapping shared memory '" + shm_name + "'");
+		}
+
+		std::memcpy(shared, image, size);
+		munmap(shared, size);
+
+		return "OK " + shm_name + " " + std::to_string(size) + " " + std::to_string(width) + " " +
+		       std::to_string(height) + " " + std::to_string(channels);
+	}
+};
+
+
+static std::string ShmName()
+{
+	static std::atomic<size_t> counter(0);
+	return "/akod-" + std::to_string((long)getpid()) + "-" + std::to_string(counter++);
+}
+
+
+static bool ReadLine(int fd, std::string& buffer, std::string& out_line)
+{
+	// Buffered, what follows a line stays for the next call
+	size_t end;
+	while ((end = buffer.find('\n')) == std::string::npos)
+	{
+		char chunk[4096];
+		const ssize_t size = read(fd, chunk, sizeof(chunk));
+
+		if (size <= 0)
+			return false;
+
+		buffer.append(chunk, (size_t)size);
+
+		if (buffer.size() > MAX_LINE_LENGTH && buffer.find('\n') == std::string::npos)
+			return false; // Nobody sends filenames this long
+	}
+
+	out_line = buffer.substr(0, end);
+	buffer.erase(0, end + 1);
+	return true;
+}
+
+
+static bool WriteLine(int fd, const std::string& line)
+{
+	const std::string text = line + "\n";
+
+	for (size_t done = 0; done < text.size();)
+	{
+		const ssize_t size = write(fd, text.data() + done, text.size() - done);
+		if (size <= 0)
+			return false;
+
+		done += (size_t)size;
+	}
+
+	return true;
+}
+
+
+using Contexts = std::vector<std::unique_ptr<Context>>;
+
+
+static Contexts MakeContexts(Scheduler& scheduler, size_t max_pixels, size_t max_memory)
+{
+	// Two per worker, as an interactive request may run while a batch one is halfway
+	auto contexts = Contexts();
+
+	for (size_t w = 0; w < scheduler.workers_no(); w++)
+	{
+		contexts.emplace_back(new Context(max_pixels, max_memory));
+		contexts.emplace_back(new Context(max_pixels, max_memory, &scheduler, w));
+	}
+
+	return contexts;
+}
+
+
+static void Serve(Scheduler& scheduler, Contexts& contexts, size_t owner, int in_fd, int out_fd)
+{
+	// Requests until the other end closes, each one a job for the scheduler
+	std::string buffer;
+	std::string line;
+
+	while (ReadLine(in_fd, buffer, line) == true)
+	{
+		Scheduler::Priority priority;
+		std::string filename;
+		std::string reply;
+
+		if (line.compare(0, 7, "DECODE ") == 0)
+		{
+			priority = Scheduler::Priority::Interactive;
+			filename = line.substr(7);
+		}
+		else if (line.compare(0, 6, "BATCH ") == 0)
+		{
+			priority = Scheduler::Priority::Batch;
+			filename = line.substr(6);
+		}
+		else
+		{
+			if (WriteLine(out_fd, "ERROR Unknown request") == false)
+				return;
+			continue;
+		}
+
+		std::promise<std::string> promise;
+		scheduler.submit(priority, owner, [&](size_t worker) {
+			try
+			{
+				promise.set_value(contexts[worker * 2 + (size_t)priority]->decode(filename, ShmName()));
+			}
+			catch (ErrorStr& e)
+			{
+				promise.set_value("ERROR " + e.info);
+			}
+			catch (std::exception& e) // Allocations mostly, promise has to be set anyway
+			{
+				promise.set_value("ERROR " + std::string(e.what()));
+			}
+		});
+
+		reply = promise.get_future().get();
+
+		if (WriteLine(out_fd, reply) == false)
+			return;
+	}
+}
+
+
+static bool PeerAllowed(int fd)
+{
+	// Socket file is already only ours, this double checks who
+	// connected, where the system tells: same user, or root
+#if defined(SO_PEERCRED)
+	ucred credentials = {};
+	socklen_t length = sizeof(credentials);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+		return false;
+
+	return (credentials.uid == getuid() || credentials.uid == 0);
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+	uid_t uid;
+	gid_t gid;
+
+	if (getpeereid(fd, &uid, &gid) != 0)
+		return false;
+
+	return (uid == getuid() || uid == 0);
+#else
+	(void)fd;
+	return true;
+#endif
+}
+
+
+static void AkodServer(const std::string& socket_path, size_t threads, size_t max_connections, size_t max_pixels,
+                       size_t max_memory, bool quiet)
+{
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+
+	if (socket_path.size() >= sizeof(address.sun_path))
+		throw ErrorStr("Socket path too long");
+
+	std::strcpy(address.sun_path, socket_path.c_str());
+
+	// Replace a previous socket, never anything else
+	struct stat previous;
+	if (lstat(socket_path.c_str(), &previous) == 0)
+	{
+		if (S_ISSOCK(previous.st_mode) == 0)
+			throw ErrorStr("'" + socket_path + "' exists and is not a socket");
+
+		unlink(socket_path.c_str());
+	}
+
+	// Only the user running us can connect, from bind() on
+	const mode_t previous_mask = umask(0177);
+	const bool bound = (listener >= 0 && bind(listener, (sockaddr*)&address, sizeof(address)) == 0);
+	umask(previous_mask);
+
+	if (bound == false || chmod(socket_path.c_str(), 0600) != 0 || listen(listener, 64) != 0)
+		throw ErrorStr("Error at listening on '" + socket_path + "'");
+
+	if (quiet == false)
+		std::printf("Listening on '%s', %zu worker(s), up to %zu connection(s)...\n", socket_path.c_str(), threads,
+		            max_connections);
+
+	// Connections only read requests and write replies, decoding happens in
+	// scheduler workers, each one with its own warm contexts
+	Scheduler scheduler(threads);
+	Contexts contexts = MakeContexts(scheduler, max_pixels, max_memory);
+
+	// Past 'max_connections' new ones wait in the listen queue, until one closes
+	std::mutex mutex;
+	std::condition_variable closed;
+	size_t connections = 0;
+
+	auto backoff = std::chrono::milliseconds(0);
+
+	for (size_t owner = 0; true; owner++)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			closed.wait(lock, [&]() { return connections < max_connections; });
+		}
+
+		const int fd = accept(listener, NULL, NULL);
+		if (fd < 0)
+		{
+			// Out of descriptors or memory is temporary, wait for connections to
+			// close, the rest (a broken listener) is not going to get better
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			if (errno != EMFILE && errno != ENFILE && errno != ENOBUFS && errno != ENOMEM)
+				throw ErrorStr("Error at accepting connections on '" + socket_path + "'");
+
+			backoff = std::min(std::max(backoff * 2, std::chrono::milliseconds(10)), std::chrono::milliseconds(1000));
+			std::this_thread::sleep_for(backoff);
+			continue;
+		}
+
+		backoff = std::chrono::milliseconds(0);
+
+		if (PeerAllowed(fd) == false)
+		{
+			close(fd);
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			connections++;
+		}
+
+		std::thread([&, fd, owner]() {
+			Serve(scheduler, contexts, owner, fd, fd);
+			close(fd);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			connections--;
+			closed.notify_one();
+		}).detach();
+	}
+}
+
+
+static void AkodClient(const std::string& socket_path, const std::string& filename, size_t requests, size_t threads,
+                       bool batch, bool quiet)
+{
+	// Load test, every thread with its own connection
+	std::atomic<size_t> next(0);
+	auto latencies = std::vector<std::vector<double>>(threads);
+	auto errors = std::vector<std::string>(threads);
+	auto workers = std::vector<std::thread>();
+
+	auto worker = [&](size_t t) {
+		const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+		if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0)
+		{
+			errors[t] = "Error at connecting to '" + socket_path + "'";
+			if (fd >= 0)
+				close(fd);
+			return;
+		}
+
+		std::string buffer;
+		std::string line;
+
+		while (next++ < requests)
+		{
+			const auto start = std::chrono::steady_clock::now();
+
+			if (WriteLine(fd, ((batch == false) ? "DECODE " : "BATCH ") + filename) == false ||
+			    ReadLine(fd, buffer, line) == false)
+			{
+				errors[t] = "Connection closed";
+				break;
+			}
+
+			std::istringstream reply(line);
+			std::string status, name;
+			size_t size = 0;
+			reply >> status >> name >> size;
+
+			if (status != "OK")
+			{
+				errors[t] = "Daemon replied: '" + line + "'";
+				break;
+			}
+
+			// Touch pixels, as a caller would
+			const int shm = shm_open(name.c_str(), O_RDONLY, 0);
+			const void* pixels = (shm >= 0) ? mmap(NULL, size, PROT_READ, MAP_SHARED, shm, 0) : MAP_FAILED;
+
+			if (shm >= 0)
+				close(shm);
+			shm_unlink(name.c_str());
+
+			if (pixels == MAP_FAILED)
+			{
+				errors[t] = "Error at mapping shared memory '" + name + "'";
+				break;
+			}
+
+			Adler32((const uint8_t*)pixels, size);
+			munmap((void*)pixels, size);
+
+			latencies[t].push_back(
+			    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		close(fd);
+	};
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (size_t t = 0; t < threads; t++)
+		workers.emplace_back(worker, t);
+
+	for (auto& w : workers)
+		w.join();
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (const auto& e : errors)
+	{
+		if (e != "")
+			throw ErrorStr(e);
+	}
+
+	// Report
+	auto all = std::vector<double>();
+	for (size_t t = 0; t < threads; t++)
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+
+	if (quiet == false)
+	{
+		std::printf("%zu %s request(s), %zu thread(s):\n", all.size(), (batch == false) ? "interactive" : "batch",
+		            threads);
+		std::printf(" - Throughput: %.2f images/s\n", (double)all.size() / elapsed);
+		std::printf(" - Latency: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", Percentile(all, 50.0),
+		            Percentile(all, 99.0), Percentile(all, 100.0));
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	std::string socket_path;
+	std::string client_path;
+	std::string input_filename;
+	bool pipe = false;
+	bool batch = false;
+	bool quiet = false;
+	size_t threads = 1;
+	size_t max_connections = 64;
+	size_t requests = 1000;
+	size_t max_pixels = 0;
+	size_t max_memory = 0;
+
+	// Options
+	{
+		auto opts = OptionsManager();
+
+		const auto print_category = opts.add_category("PRINT OPTIONS");
+		opts.add_bool("-v", "--version", "Print program version and license terms.", print_category);
+		opts.add_bool("-h", "--help", "Print this help.", print_category);
+		opts.add_bool("-quiet", "--quiet", "Don't print anything.", print_category);
+
+		const auto daemon_category = opts.add_category("DAEMON OPTIONS");
+		opts.add_string("-s", "--socket", "Unix socket where to listen for requests.", "", "", daemon_category);
+		opts.add_bool("-p", "--pipe", "Read requests from standard input, reply to standard output.",
+		              daemon_category);
+		opts.add_integer("-t", "--threads", "Workers decoding, shared by all connections.",
+		                 (int)std::max(1U, std::thread::hardware_concurrency()), 1, 1024, daemon_category);
+		opts.add_integer("-mc", "--max-connections",
+		                 "Connections served at once, past this new ones wait until another closes.", 64, 1, 65536,
+		                 daemon_category);
+		opts.add_integer("-mp", "--max-pixels", "Refuse images with more pixels than this (0 = no limit).", 0, 0,
+		                 2147483647, daemon_category);
+		opts.add_integer("-mm", "--max-memory", "Refuse images needing more megabytes than this (0 = no limit).", 0,
+		                 0, 2147483647, daemon_category);
+
+		const auto client_category = opts.add_category("CLIENT OPTIONS");
+		opts.add_string("-c", "--client", "Instead of serving, load test a daemon listening on this socket.", "", "",
+		                client_category);
+		opts.add_string("-i", "--input", "Filename to request, as seen by the daemon.", "", "", client_category);
+		opts.add_integer("-r", "--requests", "Requests, split among '--threads' connections.", 1000, 1, 2147483647,
+		                 client_category);
+		opts.add_bool("-b", "--batch", "Send 'BATCH' requests, rather than 'DECODE' ones.", client_category);
+
+		if (opts.parse_arguments(argc, argv) != 0)
+			return 1;
+
+		// Help message
+		if (opts.get_bool("--help") == true)
+		{
+			std::printf("USAGE\n");
+			std::printf("    akod [optional options] -s <socket path>\n");
+			std::printf("    akod [optional options] -p\n");
+			std::printf("    akod [optional options] -c <socket path> -i <input filename>\n");
+			std::printf("\n    First two forms decode on request, third one load tests a daemon.\n");
+			std::printf("\n    Requests are lines as 'DECODE <filename>', replies ones as 'OK <shared memory name> "
+			            "<bytes> <width> <height> <channels>', or 'ERROR <message>'. Pixels are left in a Posix "
+			            "shared memory object that caller maps, and unlinks.\n");
+			std::printf("\n    Requests as 'BATCH <filename>' are the same, but take whatever workers 'DECODE' ones "
+			            "leave. These last ones, if waiting, run in between tiles of batch ones.\n");
+			std::printf("\n");
+
+			opts.print_help();
+
+			return 0;
+		}
+
+		// Version message
+		if (opts.get_bool("--version") == true)
+		{
+			std::printf("Ako decoding daemon v%i.%i.%i\n", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
+			std::printf(" - libako v%i.%i.%i, format %i\n", akoVersionMajor(), akoVersionMinor(), akoVersionPatch(),
+			            akoFormatVersion());
+			std::printf("\n");
+			std::printf("Copyright (c) 2021-2022 Alexander Brandt. Under MIT License.\n");
+			std::printf("\n");
+			std::printf("More information at 'https://github.com/baAlex/Ako'\n");
+			return 0;
+		}
+
+		// Set settings
+		socket_path = opts.get_string("--socket");
+		client_path = opts.get_string("--client");
+		input_filename = opts.get_string("--input");
+		pipe = opts.get_bool("--pipe");
+		batch = opts.get_bool("--batch");
+		quiet = opts.get_bool("--quiet");
+		threads = (size_t)opts.get_integer("--threads");
+		max_connections = (size_t)opts.get_integer("--max-connections");
+		requests = (size_t)opts.get_integer("--requests");
+		max_pixels = (size_t)opts.get_integer("--max-pixels");
+		max_memory = (size_t)opts.get_integer("--max-memory") * 1024 * 1024;
+	}
+
+	// Serve!
+	std::signal(SIGPIPE, SIG_IGN); // Clients leaving are not our problem
+
+	try
+	{
+		if (client_path != "")
+		{
+			if (input_filename == "")
+				throw ErrorStr("No input filename specified");
+
+			AkodClient(client_path, input_filename, requests, threads, batch, quiet);
+			return 0;
+		}
+
+		if (pipe == true)
+		{
+			Scheduler scheduler(1);
+			Contexts contexts = MakeContexts(scheduler, max_pixels, max_memory);
+			Serve(scheduler, contexts, 0, STDIN_FILENO, STDOUT_FILENO);
+			return 0;
+		}
+
+		if (socket_path == "")
+			throw ErrorStr("No socket specified, nor '--pipe'");
+
+		AkodServer(socket_path, threads, max_connections, max_pixels, max_memory, quiet);
+	}
+	catch (ErrorStr& e)
+	{
+		std::cout << e.info << "\n";
+		return 1;
+	}
+
+	return 0;
+}
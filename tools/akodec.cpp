@@ -27,8 +27,17 @@ SOFTWARE.
 #include "benchmark.hpp"
 #include "misc.hpp"
 #include "options.hpp"
+#include "png.hpp"
 
-#include "thirdparty/lodepng.h"
+#include <atomic>
+#include <cerrno>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 extern "C"
 {
@@ -40,35 +49,6 @@ extern "C"
 #define TOOLS_VERSION_PATCH 0
 
 
-// clang-format off
-const LodePNGCompressSettings ZLIB_PRESET[10] ={
-	{2, 1, 32768, 3, 256, 1, 0, 0, 0},
-	{2, 1, 8192, 3, 256, 1, 0, 0, 0},
-	{2, 1, 4096, 3, 128, 1, 0, 0, 0},
-	{2, 1, 2048, 3, 128, 1, 0, 0, 0}, // lodepng_default_compress_settings
-	{2, 1, 2048, 3, 92, 1, 0, 0, 0},
-	{2, 1, 1024, 6, 92, 1, 0, 0, 0},
-	{1, 1, 1024, 6, 64, 0, 0, 0, 0},
-	{1, 1, 512, 6, 64, 0, 0, 0, 0},
-	{1, 1, 512, 6, 32, 0, 0, 0, 0},
-	{0, 1, 256, 6, 32, 0, 0, 0, 0}
-};
-
-const LodePNGFilterStrategy PNG_FILTER_PRESET[10] = {
-	LFS_BRUTE_FORCE,
-	LFS_MINSUM,
-	LFS_MINSUM,
-	LFS_MINSUM,
-	LFS_MINSUM,
-	LFS_MINSUM,
-	LFS_MINSUM,
-	LFS_MINSUM,
-	LFS_MINSUM,
-	LFS_ZERO
-};
-// clang-format on
-
-
 class AkoImage
 {
   private:
@@ -97,7 +77,7 @@ class AkoImage
 	size_t         get_blob_size() const   { return blob_size; };
 	// clang-format on
 
-	AkoImage(const std::string& filename, bool quiet, bool benchmark)
+	AkoImage(const std::string& filename, bool quiet, bool benchmark, bool perf_counters, size_t pyramid_levels = 0)
 	{
 		// Read file
 		auto blob = std::vector<uint8_t>();
@@ -122,26 +102,41 @@ class AkoImage
 		akoSettings settings;
 		{
 			Stopwatch total_benchmark;
+			EventsData events_data;
 			akoCallbacks callbacks = akoDefaultCallbacks();
 			akoStatus status = AKO_ERROR;
 
 			if (benchmark == true && quiet == false)
 			{
+				if (perf_counters == true)
+					events_data.open_counters();
+
 				total_benchmark.start(true);
 
-				EventsData events_data;
 				callbacks.events = EventsCallback;
 				callbacks.events_data = &events_data;
 
 				std::printf("Benchmark: \n");
 			}
 
-			data = (void*)akoDecodeExt(&callbacks, blob.size(), blob.data(), &settings, &channels, &width, &height,
-			                           &status);
+			if (pyramid_levels == 0)
+				data = (void*)akoDecodeExt(&callbacks, blob.size(), blob.data(), &settings, &channels, &width,
+				                           &height, &status);
+			else
+				data = (void*)akoDecodePyramidExt(&callbacks, blob.size(), blob.data(), pyramid_levels, &settings,
+				                                  &channels, &width, &height, &status);
 
 			if (benchmark == true && quiet == false)
+			{
 				total_benchmark.pause_stop(true, " - Total: ");
 
+				if (perf_counters == true && data != NULL)
+				{
+					std::printf("Performance counters: \n");
+					events_data.print_counters(width * height);
+				}
+			}
+
 			if (data == NULL)
 				throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "'");
 		}
@@ -160,8 +155,145 @@ class AkoImage
 };
 
 
+static void MakeDirectory(const std::string& path)
+{
+#ifdef _WIN32
+	const int error = _mkdir(path.c_str());
+#else
+	const int error = mkdir(path.c_str(), 0755);
+#endif
+
+	if (error != 0 && errno != EEXIST)
+		throw ErrorStr("Error at creating directory '" + path + "'");
+}
+
+
+static void WritePyramid(const AkoImage& ako, const std::string& name, size_t tile_size, const std::string& format,
+                         int effort, size_t threads, bool verbose)
+{
+	// DeepZoom layout: 'name.dzi' describing it, and 'name_files/level/col_row.format'
+	// with tiles. Level zero is one pixel, the last one the whole image
+	const size_t channels = ako.get_channels();
+	const size_t width = ako.get_width();
+	const size_t height = ako.get_height();
+
+	size_t max_level = 0;
+	for (size_t w = width, h = height; w != 1 || h != 1; max_level++)
+		akoPyramidLevel(channels, width, height, max_level + 1, &w, &h);
+
+	struct Tile
+	{
+		size_t level;
+		size_t col;
+		size_t row;
+	};
+
+	auto tiles = std::vector<Tile>();
+
+	MakeDirectory(name + "_files");
+	for (size_t level = 0; level <= max_level; level++)
+	{
+		size_t w, h;
+		akoPyramidLevel(channels, width, height, max_level - level, &w, &h);
+		MakeDirectory(name + "_files/" + std::to_string(level));
+
+		for (size_t row = 0; row < (h + tile_size - 1) / tile_size; row++)
+			for (size_t col = 0; col < (w + tile_size - 1) / tile_size; col++)
+				tiles.push_back({level, col, row});
+	}
+
+	if (verbose == true)
+		std::printf("Writing pyramid: '%s', %zu levels, %zu tiles, %zu thread(s)...\n", name.c_str(), max_level + 1,
+		            tiles.size(), threads);
+
+	// Write tiles, each worker takes the next one
+	std::atomic<size_t> next(0);
+	auto workers = std::vector<std::thread>();
+	auto errors = std::vector<std::string>(threads);
+
+	auto worker = [&](size_t t) {
+		auto pixels = std::vector<uint8_t>();
+
+		try
+		{
+			for (size_t i = next++; i < tiles.size(); i = next++)
+			{
+				const Tile& tile = tiles[i];
+
+				size_t level_w, level_h;
+				const auto level = (const uint8_t*)ako.get_data() +
+				                   akoPyramidLevel(channels, width, height, max_level - tile.level, &level_w, &level_h);
+
+				const size_t x = tile.col * tile_size;
+				const size_t y = tile.row * tile_size;
+				const size_t w = std::min(tile_size, level_w - x);
+				const size_t h = std::min(tile_size, level_h - y);
+
+				pixels.resize(w * h * channels);
+				for (size_t r = 0; r < h; r++)
+					std::copy(level + ((y + r) * level_w + x) * channels,
+					          level + ((y + r) * level_w + x + w) * channels, pixels.data() + r * w * channels);
+
+				const auto filename = name + "_files/" + std::to_string(tile.level) + "/" +
+				                      std::to_string(tile.col) + "_" + std::to_string(tile.row) + "." + format;
+
+				if (format == "raw")
+					WriteBlob(filename, pixels.data(), pixels.size());
+				else if (format == "ako")
+				{
+					void* blob = NULL;
+					akoStatus status = AKO_ERROR;
+					akoSettings settings = akoDefaultSettings();
+					const size_t blob_size =
+					    akoEncodeExt(NULL, &settings, channels, w, h, pixels.data(), &blob, &status);
+
+					if (blob_size == 0)
+						throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "'");
+
+					WriteBlob(filename, blob, blob_size);
+					akoDefaultFree(blob);
+				}
+				else
+				{
+					size_t blob_size = 0;
+					void* blob = EncodePng(pixels.data(), channels, w, h, effort, &blob_size);
+					WriteBlob(filename, blob, blob_size);
+					std::free(blob);
+				}
+			}
+		}
+		catch (ErrorStr& e)
+		{
+			errors[t] = e.info;
+		}
+	};
+
+	for (size_t t = 0; t < threads; t++)
+		workers.emplace_back(worker, t);
+
+	for (auto& w : workers)
+		w.join();
+
+	for (const auto& e : errors)
+	{
+		if (e != "")
+			throw ErrorStr(e);
+	}
+
+	// Descriptor
+	const auto dzi = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	                 "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\"" +
+	                 std::to_string(tile_size) + "\" Overlap=\"0\" Format=\"" + format + "\">\n  <Size Width=\"" +
+	                 std::to_string(width) + "\" Height=\"" + std::to_string(height) + "\"/>\n</Image>\n";
+
+	WriteBlob(name + ".dzi", dzi.data(), dzi.size());
+}
+
+
 void AkoDec(const std::string& filename_input, const std::string& filename_output, int effort, bool verbose = false,
-            bool quiet = false, bool benchmark = false, bool checksum = false)
+            bool quiet = false, bool benchmark = false, bool perf_counters = false, bool checksum = false,
+            const std::string& pyramid = "", size_t pyramid_tile = 256, const std::string& pyramid_format = "png",
+            size_t threads = 1)
 {
 	if (filename_input == "")
 		throw ErrorStr("No input filename specified");
@@ -177,7 +309,7 @@ void AkoDec(const std::string& filename_input, const std::string& filename_outpu
 		std::printf("Opening input: '%s'...\n", filename_input.c_str());
 	}
 
-	const auto ako = AkoImage(filename_input, quiet, benchmark);
+	const auto ako = AkoImage(filename_input, quiet, benchmark, perf_counters, (pyramid != "") ? 64 : 0);
 
 	if (verbose == true)
 		std::printf("Input data: %zu channels, %zux%zu px, wavelet: %i, color: %i, wrap: %i, compression: %i\n",
@@ -189,36 +321,22 @@ void AkoDec(const std::string& filename_input, const std::string& filename_outpu
 	if (checksum == true)
 		input_checksum = Adler32((uint8_t*)ako.get_data(), ako.get_width() * ako.get_height() * ako.get_channels());
 
+	// Pyramid, from the same decode
+	if (pyramid != "")
+	{
+		WritePyramid(ako, pyramid, pyramid_tile, pyramid_format, effort, threads, verbose);
+
+		if (filename_output == "") // Nowhere to write a whole image, don't encode one
+			return;
+	}
+
 	// Encode
 	if (verbose == true)
 		std::printf("Encoding...\n");
 
 	void* blob = NULL;
 	size_t get_blob_size = 0;
-	{
-		LodePNGState state;
-		lodepng_state_init(&state);
-
-		state.info_raw.bitdepth = 8;
-
-		switch (ako.get_channels())
-		{
-		case 1: state.info_raw.colortype = LCT_GREY; break;
-		case 2: state.info_raw.colortype = LCT_GREY_ALPHA; break;
-		case 3: state.info_raw.colortype = LCT_RGB; break;
-		case 4: state.info_raw.colortype = LCT_RGBA; break;
-		default: throw ErrorStr("Unsupported channels number (" + std::to_string(ako.get_channels()) + ")");
-		}
-
-		state.encoder.zlibsettings = ZLIB_PRESET[10 - effort];
-		state.encoder.filter_strategy = PNG_FILTER_PRESET[10 - effort];
-
-		const unsigned error = lodepng_encode((unsigned char**)(&blob), &get_blob_size, (unsigned char*)ako.get_data(),
-		                                      (unsigned)ako.get_width(), (unsigned)ako.get_height(), &state);
-
-		if (error != 0)
-			throw ErrorStr("LodePng error: '" + std::string(lodepng_error_text(error)) + "'");
-	}
+	blob = EncodePng(ako.get_data(), ako.get_channels(), ako.get_width(), ako.get_height(), effort, &get_blob_size);
 
 	// Write output
 	if (filename_output != "")
@@ -258,7 +376,12 @@ int main(int argc, const char* argv[])
 	bool verbose = false;
 	bool quiet = false;
 	bool benchmark = false;
+	bool perf_counters = false;
 	bool checksum = false;
+	std::string pyramid;
+	size_t pyramid_tile = 256;
+	std::string pyramid_format;
+	size_t threads = 1;
 
 	// Options
 	{
@@ -283,8 +406,23 @@ int main(int argc, const char* argv[])
 
 		const auto extra_category = opts.add_category("EXTRA TOOLS");
 		opts.add_bool("-b", "--benchmark", "", extra_category);
+		opts.add_bool("-perf", "--perf-counters",
+		              "Along '--benchmark', read hardware performance counters around each stage. Linux only.",
+		              extra_category);
 		opts.add_bool("-ch", "--checksum", "", extra_category);
 
+		const auto pyramid_category = opts.add_category("PYRAMID OPTIONS");
+		opts.add_string("-p", "--pyramid",
+		                "Along the output, write a DeepZoom pyramid of tiles with this name ('name.dzi' and "
+		                "'name_files/'). Levels come from the same decode. Without output, only the pyramid is "
+		                "written.",
+		                "", "", pyramid_category);
+		opts.add_integer("-pt", "--pyramid-tile", "Pyramid tiles dimension.", 256, 16, 8192, pyramid_category);
+		opts.add_string("-pf", "--pyramid-format", "Pyramid tiles format. Options are: PNG, RAW and AKO.", "PNG",
+		                "PNG RAW AKO", pyramid_category);
+		opts.add_integer("-t", "--threads", "Concurrent workers writing pyramid tiles.",
+		                 (int)std::max(1U, std::thread::hardware_concurrency()), 1, 1024, pyramid_category);
+
 		if (opts.parse_arguments(argc, argv) != 0)
 			return 1;
 
@@ -324,13 +462,22 @@ int main(int argc, const char* argv[])
 		verbose = opts.get_bool("--verbose");
 		quiet = opts.get_bool("--quiet");
 		benchmark = opts.get_bool("--benchmark");
+		perf_counters = opts.get_bool("--perf-counters");
 		checksum = opts.get_bool("--checksum");
+
+		pyramid = opts.get_string("--pyramid");
+		pyramid_tile = (size_t)opts.get_integer("--pyramid-tile");
+		threads = (size_t)opts.get_integer("--threads");
+
+		const char* extension[] = {"png", "raw", "ako"};
+		pyramid_format = extension[opts.get_string_index("--pyramid-format")];
 	}
 
 	// Decode!
 	try
 	{
-		AkoDec(input_filename, output_filename, effort, verbose, quiet, benchmark, checksum);
+		AkoDec(input_filename, output_filename, effort, verbose, quiet, benchmark, perf_counters, checksum, pyramid,
+		       pyramid_tile, pyramid_format, threads);
 		return 0;
 	}
 	catch (ErrorStr& e)
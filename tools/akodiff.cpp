@@ -0,0 +1,168 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "misc.hpp"
+#include "options.hpp"
+
+#include <chrono>
+
+extern "C"
+{
+#include "ako.h"
+}
+
+#define VERSION_MAJOR 0
+#define VERSION_MINOR 1
+#define VERSION_PATCH 0
+
+
+static std::vector<uint8_t> ReadFile(const std::string& filename)
+{
+	auto file = std::fstream(filename, std::ios::binary | std::ios_base::in | std::ios::ate);
+	if (file.fail() == true)
+		throw ErrorStr("Error at opening file '" + filename + "'");
+
+	auto blob = std::vector<uint8_t>((size_t)file.tellg());
+	file.seekg(0, std::ios::beg);
+	file.read((char*)blob.data(), blob.size());
+
+	if (file.fail() == true)
+		throw ErrorStr("Error at reading file '" + filename + "'");
+
+	return blob;
+}
+
+
+static size_t AkoDiff(const std::string& a_filename, const std::string& b_filename, bool quiet, bool verbose)
+{
+	const auto a = ReadFile(a_filename);
+	const auto b = ReadFile(b_filename);
+
+	akoStatus status;
+	size_t changed_no;
+	size_t tiles_no;
+
+	const auto start = std::chrono::steady_clock::now();
+	akoTileRect* changed =
+	    akoDiffExt(NULL, a.size(), a.data(), b.size(), b.data(), &changed_no, &tiles_no, &status);
+	const auto end = std::chrono::steady_clock::now();
+
+	if (changed == NULL)
+		throw ErrorStr("Ako error: '" + std::string(akoStatusString(status)) + "'");
+
+	// One line per changed tile, as 'x y width height'
+	if (quiet == false)
+	{
+		for (size_t i = 0; i < changed_no; i++)
+			std::printf("%zu %zu %zu %zu\n", changed[i].x, changed[i].y, changed[i].width, changed[i].height);
+	}
+
+	if (verbose == true)
+	{
+		std::printf("Changed tiles: %zu of %zu (%.2f%%), compared in %.3f ms\n", changed_no, tiles_no,
+		            (double)changed_no / (double)tiles_no * 100.0,
+		            std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	akoDefaultFree(changed);
+	return changed_no;
+}
+
+
+int main(int argc, const char* argv[])
+{
+	std::string a_filename;
+	std::string b_filename;
+	bool quiet = false;
+	bool verbose = false;
+
+	// Options
+	{
+		auto opts = OptionsManager();
+
+		const auto print_category = opts.add_category("PRINT OPTIONS");
+		opts.add_bool("-v", "--version", "Print program version and license terms.", print_category);
+		opts.add_bool("-h", "--help", "Print this help.", print_category);
+		opts.add_bool("-quiet", "--quiet", "Don't print changed tiles, only set exit code.", print_category);
+		opts.add_bool("-verbose", "--verbose", "Print a summary after changed tiles.", print_category);
+
+		const auto io_category = opts.add_category("INPUT OPTIONS");
+		opts.add_string("-a", "--a", "First filename.", "", "", io_category);
+		opts.add_string("-b", "--b", "Second filename.", "", "", io_category);
+
+		if (opts.parse_arguments(argc, argv) != 0)
+			return 2;
+
+		// Help message
+		if (opts.get_bool("--help") == true)
+		{
+			std::printf("USAGE\n");
+			std::printf("    akodiff [optional options] -a <filename> -b <filename>\n");
+			std::printf("\n    Prints tiles that differ between two Ako files, one per line as 'x y width height', "
+			            "comparing compressed bytes without decoding them. Files should come from images of the same "
+			            "dimensions, encoded with the same tiles settings. Exits with 0 if no tile changed, 1 if "
+			            "some did, and 2 on errors.\n");
+			std::printf("\n");
+
+			opts.print_help();
+
+			return 0;
+		}
+
+		// Version message
+		if (opts.get_bool("--version") == true)
+		{
+			std::printf("Ako diff tool v%i.%i.%i\n", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
+			std::printf(" - libako v%i.%i.%i, format %i\n", akoVersionMajor(), akoVersionMinor(), akoVersionPatch(),
+			            akoFormatVersion());
+			std::printf("\n");
+			std::printf("Copyright (c) 2021-2022 Alexander Brandt. Under MIT License.\n");
+			std::printf("\n");
+			std::printf("More information at 'https://github.com/baAlex/Ako'\n");
+			return 0;
+		}
+
+		// Set settings
+		a_filename = opts.get_string("--a");
+		b_filename = opts.get_string("--b");
+		quiet = opts.get_bool("--quiet");
+		verbose = opts.get_bool("--verbose");
+	}
+
+	// Diff!
+	try
+	{
+		if (a_filename == "" || b_filename == "")
+			throw ErrorStr("Two input filenames needed");
+
+		return (AkoDiff(a_filename, b_filename, quiet, verbose) == 0) ? 0 : 1;
+	}
+	catch (ErrorStr& e)
+	{
+		std::cout << e.info << "\n";
+		return 2;
+	}
+}
@@ -27,6 +27,7 @@ SOFTWARE.
 #include "benchmark.hpp"
 #include "misc.hpp"
 #include "options.hpp"
+#include "png.hpp"
 
 #include "thirdparty/lodepng.h"
 
@@ -40,75 +41,6 @@ extern "C"
 #define VERSION_PATCH 0
 
 
-class PngImage
-{
-  private:
-	size_t width;
-	size_t height;
-	size_t channels;
-	void* data;
-
-  public:
-	// clang-format off
-	size_t      get_width() const    { return width; };
-	size_t      get_height() const   { return height; };
-	size_t      get_channels() const { return channels; };
-	const void* get_data() const     { return (const void*)(data); };
-	// clang-format on
-
-	PngImage(const std::string& filename)
-	{
-		unsigned char* blob;
-		size_t blob_size;
-
-		LodePNGState state;
-		unsigned error;
-
-		unsigned png_width;
-		unsigned png_height;
-		unsigned char* png_data;
-
-		// Set
-		lodepng_state_init(&state);
-		state.decoder.color_convert = 0; // Do not convert color
-
-		// Load/decode
-		if ((error = lodepng_load_file(&blob, &blob_size, filename.c_str())) != 0)
-			throw ErrorStr("LodePng error: '" + std::string(lodepng_error_text(error)) + "'");
-
-		if ((error = lodepng_decode(&png_data, &png_width, &png_height, &state, blob, blob_size)) != 0)
-			throw ErrorStr("LodePng error: '" + std::string(lodepng_error_text(error)) + "'");
-
-		// Validate
-		switch (state.info_png.color.colortype)
-		{
-		case LCT_GREY: channels = 1; break;
-		case LCT_GREY_ALPHA: channels = 2; break;
-		case LCT_RGB: channels = 3; break;
-		case LCT_RGBA: channels = 4; break;
-		default: throw ErrorStr("Unsupported channels number (" + std::to_string(state.info_png.color.colortype) + ")");
-		}
-
-		if (state.info_png.color.bitdepth != 8)
-			throw ErrorStr("Unsupported bits per pixel-component (" + std::to_string(state.info_png.color.bitdepth) +
-			               ")");
-
-		// Bye!
-		data = (void*)png_data;
-		width = (size_t)png_width;
-		height = (size_t)png_height;
-
-		lodepng_state_cleanup(&state);
-		free(blob);
-	}
-
-	~PngImage()
-	{
-		free(data);
-	}
-};
-
-
 size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const akoSettings* settings, size_t channels,
                   size_t width, size_t height, const void* in, void** out, akoStatus* out_status)
 {
@@ -137,11 +69,42 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 			std::printf("Target: %.2f kB, error: %.2f kB...\n", (double)target_size / 1000.0F,
 			            (double)error_margin / 1000.0F);
 
+		// Candidates that overshoot stop early, with nothing to show. Their size is
+		// then taken as a byte past the limit, a lower bound, yet enough for
+		// comparisons below as it is already beyond the margin
+		auto capped_callbacks = *callbacks;
+		capped_callbacks.max_output_size = target_size + error_margin;
+		bool last_capped = false;
+
+		auto encode_candidate = [&](const akoSettings& candidate_settings) -> size_t
+		{
+			void* candidate = NULL;
+			akoStatus status = AKO_ERROR;
+
+			const size_t size = akoEncodeExt(&capped_callbacks, &candidate_settings, channels, width, height, in,
+			                                 &candidate, &status);
+
+			last_capped = (status == AKO_OUTPUT_LIMIT_EXCEEDED);
+			if (last_capped == true)
+				return capped_callbacks.max_output_size + 1;
+
+			*out_status = status;
+
+			if (candidate != NULL) // Keep last complete one
+			{
+				if (*out != NULL)
+					callbacks->free(*out);
+				*out = candidate;
+			}
+
+			return size;
+		};
+
 		// Ceil zero
 		auto new_settings = *settings;
 		new_settings.quantization = 0;
 
-		size_t ceil_size = akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
+		size_t ceil_size = encode_candidate(new_settings);
 
 		// Exponentially find a floor
 		new_settings.quantization = 1;
@@ -156,7 +119,7 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 			ceil_size = floor_size;
 			ceil_q = floor_q;
 
-			floor_size = akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
+			floor_size = encode_candidate(new_settings);
 			floor_q = new_settings.quantization;
 
 			if (verbose == true)
@@ -171,7 +134,7 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 		       std::abs(floor_q - ceil_q) > 1)
 		{
 			new_settings.quantization = (ceil_q + floor_q) / 2;
-			last_size = akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
+			last_size = encode_candidate(new_settings);
 
 			if (last_size > target_size)
 			{
@@ -206,10 +169,13 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 				std::printf(" - Q: %i\n", ceil_q);
 
 			new_settings.quantization = ceil_q;
-			if (last_size == ceil_size)
+			if (last_size == ceil_size && last_capped == false)
 				return last_size;
 		}
 
+		if (*out != NULL)
+			callbacks->free(*out);
+
 		return akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
 	}
 
@@ -218,7 +184,8 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 
 
 void AkoEnc(const akoSettings& settings, const std::string& filename_input, const std::string& filename_output,
-            int ratio = 0, bool verbose = false, bool quiet = false, bool benchmark = false, bool checksum = false)
+            int ratio = 0, bool verbose = false, bool quiet = false, bool benchmark = false, bool perf_counters = false,
+            bool checksum = false, float time_budget = 0.0F)
 {
 	if (filename_input == "")
 		throw ErrorStr("No input filename specified");
@@ -253,6 +220,12 @@ void AkoEnc(const akoSettings& settings, const std::string& filename_input, cons
 		std::printf(", color: %i", (int)settings.color);
 		std::printf(", wrap: %i", (int)settings.wrap);
 		std::printf(", compression %i", (int)settings.compression);
+		std::printf(", tiles: %zux%zu", settings.tiles_dimension,
+		            (settings.tiles_height != 0) ? settings.tiles_height : settings.tiles_dimension);
+		std::printf(", order: %i", (int)settings.order);
+		std::printf(", code-blocks: %zu", settings.code_blocks);
+		std::printf(", downscale: %i", settings.downscale);
+		std::printf(", target psnr: %.2f", (double)settings.target_psnr);
 		std::printf(", chroma loss: %i", (int)settings.chroma_loss);
 		std::printf(", discard non-visible: %i]\n", (int)settings.discard_non_visible);
 	}
@@ -261,20 +234,25 @@ void AkoEnc(const akoSettings& settings, const std::string& filename_input, cons
 	size_t blob_size = 0;
 	{
 		Stopwatch total_benchmark;
+		EventsData events_data;
 		akoCallbacks callbacks = akoDefaultCallbacks();
 		akoStatus status = AKO_ERROR;
 
+		callbacks.time_budget = time_budget;
+
 		if (benchmark == true && quiet == false)
 		{
-			total_benchmark.start(true);
-
 			if (ratio == 0)
 			{
-				EventsData events_data;
+				if (perf_counters == true)
+					events_data.open_counters();
+
 				callbacks.events = EventsCallback;
 				callbacks.events_data = &events_data;
 				std::printf("Benchmark: \n");
 			}
+
+			total_benchmark.start(true);
 		}
 
 		blob_size = EncodePass(verbose, ratio, &callbacks, &settings, png.get_channels(), png.get_width(),
@@ -286,6 +264,12 @@ void AkoEnc(const akoSettings& settings, const std::string& filename_input, cons
 				std::printf("Benchmark: \n");
 
 			total_benchmark.pause_stop(true, " - Total: ");
+
+			if (ratio == 0 && perf_counters == true && blob_size != 0)
+			{
+				std::printf("Performance counters: \n");
+				events_data.print_counters(png.get_width() * png.get_height());
+			}
 		}
 
 		if (blob_size == 0)
@@ -328,9 +312,11 @@ int main(int argc, const char* argv[])
 	std::string input_filename;
 	std::string output_filename;
 	int ratio = 0;
+	float time_budget = 0.0F;
 	bool verbose = false;
 	bool quiet = false;
 	bool benchmark = false;
+	bool perf_counters = false;
 	bool checksum = false;
 
 	// Options
@@ -381,9 +367,45 @@ int main(int argc, const char* argv[])
 		              "Discard pixels that do not contribute to the final image (those in transparent areas). For "
 		              "lossless compression do not set this option.",
 		              encoding_category);
+		opts.add_integer("-tiles", "--tiles",
+		                 "Divide the image in tiles of the provided dimension, a power of two from 8. Set it to zero "
+		                 "to not use tiles.",
+		                 0, 0, 1073741824, encoding_category);
+		opts.add_integer("-tiles-height", "--tiles-height",
+		                 "Tiles height, a power of two from 8, for rectangular tiles. Set it to zero to use the same "
+		                 "than '--tiles'. If '--tiles' is zero the image is divided in strips of full width, which "
+		                 "suit line oriented sources like screen or camera captures.",
+		                 0, 0, 1073741824, encoding_category);
+		opts.add_string("-order", "--order",
+		                "Order in which tiles are processed and stored. Options are: RASTER and MORTON. With MORTON "
+		                "tiles close in the image are also close in time, improving locality when encoding big "
+		                "memory mapped sources.",
+		                "RASTER", "RASTER MORTON", encoding_category);
+		opts.add_integer("-code-blocks", "--code-blocks",
+		                 "Entropy code wavelet planes in independent blocks of the provided dimension, a power of two "
+		                 "from 8, rather than in a single stream per tile. Costs some bytes, in exchange regions "
+		                 "of a tile can be decoded, and in parallel. Set it to zero to disable it.",
+		                 0, 0, 131072, encoding_category);
+		opts.add_integer("-downscale", "--downscale",
+		                 "Encode at a smaller resolution, half the size per unit. Finest wavelet levels are dropped, "
+		                 "so no resampling pass is needed. Tiles dimensions are divided accordingly.",
+		                 0, 0, 16, encoding_category);
+		opts.add_float("-time-budget", "--time-budget",
+		               "Milliseconds the encoding should take. Remaining tiles switch to cheaper wavelets (CDF53, "
+		               "then HAAR) whenever, at the speed measured so far, the budget is at risk. Set it to zero "
+		               "to disable it.",
+		               0.0F, 0.0F, 86400000.0F, encoding_category);
+		opts.add_float("-psnr", "--target-psnr",
+		               "Quality to aim for, in decibels. Picks, per tile, the largest quantization that keeps the "
+		               "Psnr at or above the provided value, overriding '--quantization'. Set it to zero to "
+		               "disable it.",
+		               0.0F, 0.0F, 100.0F, encoding_category);
 
 		const auto extra_category = opts.add_category("EXTRA TOOLS");
 		opts.add_bool("-b", "--benchmark", "", extra_category);
+		opts.add_bool("-perf", "--perf-counters",
+		              "Along '--benchmark', read hardware performance counters around each stage. Linux only.",
+		              extra_category);
 		opts.add_bool("-ch", "--checksum", "", extra_category);
 
 		const auto experimental_category = opts.add_category("EXPERIMENTAL");
@@ -432,6 +454,7 @@ int main(int argc, const char* argv[])
 		verbose = opts.get_bool("--verbose");
 		quiet = opts.get_bool("--quiet");
 		benchmark = opts.get_bool("--benchmark");
+		perf_counters = opts.get_bool("--perf-counters");
 		checksum = opts.get_bool("--checksum");
 
 		settings.quantization = opts.get_integer("--quantization");
@@ -441,7 +464,14 @@ int main(int argc, const char* argv[])
 		settings.color = (akoColor)opts.get_string_index("--color");
 		settings.wrap = (akoWrap)opts.get_string_index("--wrap");
 		settings.chroma_loss = opts.get_integer("--chroma-loss");
-
+		settings.tiles_dimension = (size_t)opts.get_integer("--tiles");
+		settings.tiles_height = (size_t)opts.get_integer("--tiles-height");
+		settings.order = (akoOrder)opts.get_string_index("--order");
+		settings.code_blocks = (size_t)opts.get_integer("--code-blocks");
+		settings.downscale = opts.get_integer("--downscale");
+		settings.target_psnr = opts.get_float("--target-psnr");
+
+		time_budget = opts.get_float("--time-budget");
 		ratio = opts.get_integer("--dev-ratio");
 		settings.compression = (akoCompression)opts.get_string_index("--dev-compression");
 	}
@@ -449,7 +479,8 @@ int main(int argc, const char* argv[])
 	// Encode!
 	try
 	{
-		AkoEnc(settings, input_filename, output_filename, ratio, verbose, quiet, benchmark, checksum);
+		AkoEnc(settings, input_filename, output_filename, ratio, verbose, quiet, benchmark, perf_counters, checksum,
+		       time_budget);
 		return 0;
 	}
 	catch (ErrorStr& e)
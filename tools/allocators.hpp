@@ -0,0 +1,276 @@
+/*
+
+MIT License
+
+Copyright (c) 2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ALLOCATORS_HPP
+#define ALLOCATORS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C"
+{
+#include "ako.h"
+}
+
+
+// Allocators to plug into akoCallbacks. As callbacks receive no user data,
+// every thread keeps its own state. Whatever a thread allocates, the same
+// thread should free.
+
+enum class Allocator
+{
+	Malloc = 0,
+	Arena,
+	Pool
+};
+
+
+const size_t ALLOCATOR_HEAD_SIZE = 16; // Keeps returned memory aligned as malloc() does
+
+
+class Arena
+{
+	// Bump allocator, free() does nothing and reset() recycles everything at once.
+	// After a reset, chunks merge into a single one big enough for next time
+
+  private:
+	struct Chunk
+	{
+		uint8_t* data;
+		size_t size;
+		size_t used;
+	};
+
+	std::vector<Chunk> chunks;
+	size_t total_size = 0;
+
+	static size_t& capacity(void* ptr)
+	{
+		return *(size_t*)((uint8_t*)ptr - ALLOCATOR_HEAD_SIZE);
+	}
+
+  public:
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	~Arena()
+	{
+		for (auto& c : chunks)
+			std::free(c.data);
+	}
+
+	void* allocate(size_t size)
+	{
+		size = (size + ALLOCATOR_HEAD_SIZE - 1) & ~(ALLOCATOR_HEAD_SIZE - 1);
+		const size_t needed = size + ALLOCATOR_HEAD_SIZE;
+
+		if (chunks.size() == 0 || chunks.back().used + needed > chunks.back().size)
+		{
+			const size_t chunk_size = std::max(needed, std::max(total_size, (size_t)(1 << 20)));
+			uint8_t* data = (uint8_t*)std::malloc(chunk_size);
+			if (data == NULL)
+				return NULL;
+
+			chunks.push_back({data, chunk_size, 0});
+			total_size += chunk_size;
+		}
+
+		Chunk& c = chunks.back();
+		void* ptr = c.data + c.used + ALLOCATOR_HEAD_SIZE;
+		c.used += needed;
+
+		capacity(ptr) = size;
+		return ptr;
+	}
+
+	void* reallocate(void* ptr, size_t size)
+	{
+		if (ptr == NULL)
+			return allocate(size);
+
+		const size_t old_capacity = capacity(ptr);
+		if (size <= old_capacity)
+			return ptr;
+
+		// Grow geometrically, the encoder reallocates its output once per tile
+		void* new_ptr = allocate(std::max(size, old_capacity * 2));
+		if (new_ptr != NULL)
+			std::memcpy(new_ptr, ptr, old_capacity);
+
+		return new_ptr;
+	}
+
+	void reset()
+	{
+		if (chunks.size() > 1)
+		{
+			for (auto& c : chunks)
+				std::free(c.data);
+
+			chunks.clear();
+			uint8_t* data = (uint8_t*)std::malloc(total_size);
+			if (data != NULL)
+				chunks.push_back({data, total_size, 0});
+			else
+				total_size = 0;
+		}
+		else if (chunks.size() == 1)
+			chunks.back().used = 0;
+	}
+};
+
+
+class Pool
+{
+	// Power-of-two size classes, freed blocks go to a list and
+	// are recycled by later allocations of the same class
+
+  private:
+	static const size_t CLASSES_NO = 48;
+	std::vector<void*> free_lists[CLASSES_NO];
+
+	static size_t& class_of(void* ptr)
+	{
+		return *(size_t*)((uint8_t*)ptr - ALLOCATOR_HEAD_SIZE);
+	}
+
+  public:
+	Pool() = default;
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	~Pool()
+	{
+		for (auto& list : free_lists)
+			for (auto ptr : list)
+				std::free((uint8_t*)ptr - ALLOCATOR_HEAD_SIZE);
+	}
+
+	void* allocate(size_t size)
+	{
+		size_t c = 4;
+		while (((size_t)1 << c) < size && c < CLASSES_NO - 1)
+			c++;
+
+		if (free_lists[c].size() != 0)
+		{
+			void* ptr = free_lists[c].back();
+			free_lists[c].pop_back();
+			return ptr;
+		}
+
+		uint8_t* block = (uint8_t*)std::malloc(((size_t)1 << c) + ALLOCATOR_HEAD_SIZE);
+		if (block == NULL)
+			return NULL;
+
+		class_of(block + ALLOCATOR_HEAD_SIZE) = c;
+		return block + ALLOCATOR_HEAD_SIZE;
+	}
+
+	void* reallocate(void* ptr, size_t size)
+	{
+		if (ptr == NULL)
+			return allocate(size);
+
+		const size_t old_size = (size_t)1 << class_of(ptr);
+		if (size <= old_size)
+			return ptr;
+
+		void* new_ptr = allocate(size);
+		if (new_ptr != NULL)
+		{
+			std::memcpy(new_ptr, ptr, old_size);
+			release(ptr);
+		}
+
+		return new_ptr;
+	}
+
+	void release(void* ptr)
+	{
+		if (ptr != NULL)
+			free_lists[class_of(ptr)].push_back(ptr);
+	}
+};
+
+
+inline Arena& ThreadArena()
+{
+	static thread_local Arena arena;
+	return arena;
+}
+
+inline Pool& ThreadPool()
+{
+	static thread_local Pool pool;
+	return pool;
+}
+
+// clang-format off
+inline void* ArenaMalloc(size_t size)             { return ThreadArena().allocate(size); }
+inline void* ArenaRealloc(void* ptr, size_t size) { return ThreadArena().reallocate(ptr, size); }
+inline void  ArenaFree(void* ptr)                 { (void)ptr; }
+
+inline void* PoolMalloc(size_t size)              { return ThreadPool().allocate(size); }
+inline void* PoolRealloc(void* ptr, size_t size)  { return ThreadPool().reallocate(ptr, size); }
+inline void  PoolFree(void* ptr)                  { ThreadPool().release(ptr); }
+// clang-format on
+
+
+inline akoCallbacks AllocatorCallbacks(Allocator allocator)
+{
+	akoCallbacks callbacks = akoDefaultCallbacks();
+
+	if (allocator == Allocator::Arena)
+	{
+		callbacks.malloc = ArenaMalloc;
+		callbacks.realloc = ArenaRealloc;
+		callbacks.free = ArenaFree;
+	}
+	else if (allocator == Allocator::Pool)
+	{
+		callbacks.malloc = PoolMalloc;
+		callbacks.realloc = PoolRealloc;
+		callbacks.free = PoolFree;
+	}
+
+	return callbacks;
+}
+
+
+inline void AllocatorRecycle(Allocator allocator)
+{
+	// Call once everything allocated for an image was freed
+	if (allocator == Allocator::Arena)
+		ThreadArena().reset();
+}
+
+#endif
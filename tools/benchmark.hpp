@@ -28,8 +28,17 @@ SOFTWARE.
 #define BENCHMARK_HPP
 
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 extern "C"
 {
 #include "ako.h"
@@ -40,7 +49,7 @@ class Stopwatch
 {
   private:
 	std::chrono::steady_clock::time_point last_point;
-	std::chrono::duration<double, std::milli> duration;
+	std::chrono::duration<double, std::milli> duration{};
 
   public:
 	void start(bool fresh_start)
@@ -59,6 +68,173 @@ class Stopwatch
 		if (print == true)
 			std::cout << name << duration.count() << " ms" << suffix << std::endl;
 	}
+
+	double get_milliseconds() const
+	{
+		return duration.count();
+	}
+};
+
+
+class PerfCounters
+{
+  public:
+	enum Counter
+	{
+		CYCLES = 0,
+		INSTRUCTIONS,
+		CACHE_MISSES,
+		BRANCH_MISSES,
+		TLB_MISSES,
+		COUNTERS_NO
+	};
+
+  private:
+	int fd[COUNTERS_NO];
+	size_t group_order[COUNTERS_NO]; // Position of every counter in a group read
+	size_t group_size = 0;
+
+	uint64_t last_point[COUNTERS_NO];
+	uint64_t total[COUNTERS_NO];
+
+#if defined(__linux__)
+	static int open_counter(uint32_t type, uint64_t config, int group_fd)
+	{
+		perf_event_attr attr = {};
+		attr.size = sizeof(perf_event_attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = (group_fd == -1) ? 1 : 0;
+		attr.exclude_kernel = 1; // Allowed with the usual 'perf_event_paranoid' of 2
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+
+		return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+	}
+#endif
+
+	bool read_group(uint64_t* out) const
+	{
+#if defined(__linux__)
+		uint64_t values[COUNTERS_NO + 1]; // Counters number, followed by values
+		if (fd[CYCLES] == -1 || read(fd[CYCLES], values, sizeof(values)) <= 0)
+			return false;
+
+		for (size_t c = 0; c < COUNTERS_NO; c++)
+			out[c] = (fd[c] != -1) ? values[1 + group_order[c]] : 0;
+
+		return true;
+#else
+		(void)out;
+		return false;
+#endif
+	}
+
+  public:
+	PerfCounters()
+	{
+		for (size_t c = 0; c < COUNTERS_NO; c++)
+		{
+			fd[c] = -1;
+			group_order[c] = 0;
+			last_point[c] = 0;
+			total[c] = 0;
+		}
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters()
+	{
+#if defined(__linux__)
+		for (size_t c = 0; c < COUNTERS_NO; c++)
+			if (fd[c] != -1)
+				close(fd[c]);
+#endif
+	}
+
+	bool open()
+	{
+#if defined(__linux__)
+		const uint64_t tlb = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+		// Cycles lead the group, without it there is nothing to measure
+		if ((fd[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1)) == -1)
+			return false;
+
+		group_order[CYCLES] = group_size++;
+
+		// Others are optional, not every machine (or VM) exposes them
+		const struct
+		{
+			Counter counter;
+			uint32_t type;
+			uint64_t config;
+		} others[] = {{INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+		              {CACHE_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+		              {BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+		              {TLB_MISSES, PERF_TYPE_HW_CACHE, tlb}};
+
+		for (const auto& o : others)
+		{
+			if ((fd[o.counter] = open_counter(o.type, o.config, fd[CYCLES])) != -1)
+				group_order[o.counter] = group_size++;
+		}
+
+		ioctl(fd[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(fd[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// clang-format off
+	bool     is_open() const              { return (fd[CYCLES] != -1); }
+	bool     has(Counter c) const         { return (fd[c] != -1); }
+	uint64_t get(Counter c) const         { return total[c]; }
+	// clang-format on
+
+	void start(bool fresh_start)
+	{
+		if (fresh_start == true)
+			for (size_t c = 0; c < COUNTERS_NO; c++)
+				total[c] = 0;
+
+		read_group(last_point);
+	}
+
+	void pause_stop()
+	{
+		uint64_t now[COUNTERS_NO];
+		if (read_group(now) == false)
+			return;
+
+		for (size_t c = 0; c < COUNTERS_NO; c++)
+			total[c] += (now[c] - last_point[c]);
+	}
+
+	void print(const std::string& name, size_t pixels) const
+	{
+		if (is_open() == false)
+			return;
+
+		const double px = (double)((pixels != 0) ? pixels : 1);
+		std::printf("%s%.2f Mcycles", name.c_str(), (double)total[CYCLES] / 1000000.0);
+
+		if (has(INSTRUCTIONS) == true && total[CYCLES] != 0)
+			std::printf(", IPC: %.2f", (double)total[INSTRUCTIONS] / (double)total[CYCLES]);
+		if (has(CACHE_MISSES) == true)
+			std::printf(", cache misses: %.4f/px", (double)total[CACHE_MISSES] / px);
+		if (has(BRANCH_MISSES) == true)
+			std::printf(", branch misses: %.4f/px", (double)total[BRANCH_MISSES] / px);
+		if (has(TLB_MISSES) == true)
+			std::printf(", TLB misses: %.4f/px", (double)total[TLB_MISSES] / px);
+
+		std::printf("\n");
+	}
 };
 
 
@@ -67,6 +243,32 @@ struct EventsData
 	Stopwatch format;
 	Stopwatch wavelet;
 	Stopwatch compression;
+	bool quiet = false; // Measure without printing
+
+	// Optional, opened with open_counters()
+	bool counters = false;
+	PerfCounters format_counters;
+	PerfCounters wavelet_counters;
+	PerfCounters compression_counters;
+
+	bool open_counters()
+	{
+		counters = format_counters.open() && wavelet_counters.open() && compression_counters.open();
+		return counters;
+	}
+
+	void print_counters(size_t pixels) const
+	{
+		if (counters == false)
+		{
+			std::printf(" - Performance counters not available\n");
+			return;
+		}
+
+		format_counters.print(" - Format: ", pixels);
+		wavelet_counters.print(" - Wavelet transformation: ", pixels);
+		compression_counters.print(" - Compression: ", pixels);
+	}
 };
 
 
@@ -74,19 +276,47 @@ void EventsCallback(size_t tile_no, size_t total_tiles, akoEvent e, void* raw_da
 {
 	EventsData* stopwatches = (EventsData*)raw_data;
 
+	// Counters go inside stopwatches, to not measure the later
 	if (e == AKO_EVENT_FORMAT_START)
+	{
 		stopwatches->format.start((bool)(tile_no == 0));
+		if (stopwatches->counters == true)
+			stopwatches->format_counters.start((bool)(tile_no == 0));
+	}
 	else if (e == AKO_EVENT_WAVELET_START)
+	{
 		stopwatches->wavelet.start((bool)(tile_no == 0));
+		if (stopwatches->counters == true)
+			stopwatches->wavelet_counters.start((bool)(tile_no == 0));
+	}
 	else if (e == AKO_EVENT_COMPRESSION_START)
+	{
 		stopwatches->compression.start((bool)(tile_no == 0));
+		if (stopwatches->counters == true)
+			stopwatches->compression_counters.start((bool)(tile_no == 0));
+	}
 
 	else if (e == AKO_EVENT_FORMAT_END)
-		stopwatches->format.pause_stop((bool)(tile_no == total_tiles - 1), " - Format: ");
+	{
+		if (stopwatches->counters == true)
+			stopwatches->format_counters.pause_stop();
+		stopwatches->format.pause_stop((bool)(stopwatches->quiet == false && tile_no == total_tiles - 1),
+		                                  " - Format: ");
+	}
 	else if (e == AKO_EVENT_WAVELET_END)
-		stopwatches->wavelet.pause_stop((bool)(tile_no == total_tiles - 1), " - Wavelet transformation: ");
+	{
+		if (stopwatches->counters == true)
+			stopwatches->wavelet_counters.pause_stop();
+		stopwatches->wavelet.pause_stop((bool)(stopwatches->quiet == false && tile_no == total_tiles - 1),
+		                                  " - Wavelet transformation: ");
+	}
 	else if (e == AKO_EVENT_COMPRESSION_END)
-		stopwatches->compression.pause_stop((bool)(tile_no == total_tiles - 1), " - Compression: ");
+	{
+		if (stopwatches->counters == true)
+			stopwatches->compression_counters.pause_stop();
+		stopwatches->compression.pause_stop((bool)(stopwatches->quiet == false && tile_no == total_tiles - 1),
+		                                  " - Compression: ");
+	}
 }
 
 #endif
@@ -0,0 +1,321 @@
+/*
+
+MIT License
+
+Copyright (c) 2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "misc.hpp"
+
+
+// Just enough Json to save and load benchmark results, no
+// unicode escapes and numbers are always doubles
+
+
+class JsonValue
+{
+  public:
+	enum Type
+	{
+		NIL = 0,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+  private:
+	Type type = NIL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::map<std::string, JsonValue> object;
+
+  public:
+	JsonValue() {}
+	JsonValue(bool v) : type(BOOLEAN), boolean(v) {}
+	JsonValue(double v) : type(NUMBER), number(v) {}
+	JsonValue(const std::string& v) : type(STRING), string(v) {}
+	JsonValue(const char* v) : type(STRING), string(v) {} // Otherwise literals become booleans
+
+	static JsonValue Array()
+	{
+		JsonValue v;
+		v.type = ARRAY;
+		return v;
+	}
+
+	static JsonValue Object()
+	{
+		JsonValue v;
+		v.type = OBJECT;
+		return v;
+	}
+
+	// clang-format off
+	Type                                    get_type() const    { return type; }
+	bool                                    get_boolean() const { return boolean; }
+	double                                  get_number() const  { return number; }
+	const std::string&                      get_string() const  { return string; }
+	const std::vector<JsonValue>&           get_array() const   { return array; }
+	const std::map<std::string, JsonValue>& get_object() const  { return object; }
+	// clang-format on
+
+	bool has(const std::string& key) const
+	{
+		return (type == OBJECT && object.count(key) != 0);
+	}
+
+	const JsonValue& at(const std::string& key) const
+	{
+		if (has(key) == false)
+			throw ErrorStr("Json error: missing key '" + key + "'");
+		return object.at(key);
+	}
+
+	void push(const JsonValue& v)
+	{
+		array.emplace_back(v);
+	}
+
+	void set(const std::string& key, const JsonValue& v)
+	{
+		object[key] = v;
+	}
+
+	std::string dump(int indentation = 0) const
+	{
+		const std::string tab(indentation + 1, '\t');
+		const std::string tab_end(indentation, '\t');
+		std::string str;
+
+		switch (type)
+		{
+		case NIL: return "null";
+		case BOOLEAN: return (boolean == true) ? "true" : "false";
+		case NUMBER:
+		{
+			char buffer[32];
+			std::snprintf(buffer, sizeof(buffer), "%.9g", number);
+			return buffer;
+		}
+		case STRING: return Escape(string);
+		case ARRAY:
+			// Arrays of numbers in one line, they are long
+			str = "[";
+			for (size_t i = 0; i < array.size(); i++)
+				str += ((i != 0) ? ", " : "") + array[i].dump(indentation + 1);
+			return str + "]";
+		case OBJECT:
+			str = "{\n";
+			for (auto it = object.begin(); it != object.end(); it++)
+			{
+				str += ((it != object.begin()) ? ",\n" : "") + tab + Escape(it->first) + ": ";
+				str += it->second.dump(indentation + 1);
+			}
+			return str + "\n" + tab_end + "}";
+		}
+
+		return "null";
+	}
+
+	static std::string Escape(const std::string& in)
+	{
+		std::string out = "\"";
+		for (const auto c : in)
+		{
+			if (c == '"' || c == '\\')
+				out += '\\';
+			out += c;
+		}
+
+		return out + "\"";
+	}
+
+	static JsonValue Parse(const std::string& text)
+	{
+		size_t cursor = 0;
+		JsonValue v = ParseValue(text, cursor);
+
+		SkipWhitespace(text, cursor);
+		if (cursor != text.size())
+			throw ErrorStr("Json error: trailing characters");
+
+		return v;
+	}
+
+  private:
+	static void SkipWhitespace(const std::string& text, size_t& cursor)
+	{
+		while (cursor < text.size() &&
+		       (text[cursor] == ' ' || text[cursor] == '\t' || text[cursor] == '\n' || text[cursor] == '\r'))
+			cursor++;
+	}
+
+	static void Expect(const std::string& text, size_t& cursor, const std::string& token)
+	{
+		if (text.compare(cursor, token.size(), token) != 0)
+			throw ErrorStr("Json error: expected '" + token + "' at " + std::to_string(cursor));
+		cursor += token.size();
+	}
+
+	static std::string ParseString(const std::string& text, size_t& cursor)
+	{
+		std::string str;
+		Expect(text, cursor, "\"");
+
+		for (; cursor < text.size() && text[cursor] != '"'; cursor++)
+		{
+			if (text[cursor] == '\\' && cursor + 1 < text.size())
+				cursor++;
+			str += text[cursor];
+		}
+
+		Expect(text, cursor, "\"");
+		return str;
+	}
+
+	static JsonValue ParseValue(const std::string& text, size_t& cursor)
+	{
+		SkipWhitespace(text, cursor);
+		if (cursor >= text.size())
+			throw ErrorStr("Json error: premature end");
+
+		const char c = text[cursor];
+
+		if (c == '{')
+		{
+			JsonValue v = Object();
+			cursor++;
+
+			SkipWhitespace(text, cursor);
+			if (cursor < text.size() && text[cursor] == '}')
+				return (cursor++, v);
+
+			while (true)
+			{
+				SkipWhitespace(text, cursor);
+				const std::string key = ParseString(text, cursor);
+				SkipWhitespace(text, cursor);
+				Expect(text, cursor, ":");
+				v.object[key] = ParseValue(text, cursor);
+
+				SkipWhitespace(text, cursor);
+				if (cursor < text.size() && text[cursor] == ',')
+					cursor++;
+				else
+					break;
+			}
+
+			Expect(text, cursor, "}");
+			return v;
+		}
+		else if (c == '[')
+		{
+			JsonValue v = Array();
+			cursor++;
+
+			SkipWhitespace(text, cursor);
+			if (cursor < text.size() && text[cursor] == ']')
+				return (cursor++, v);
+
+			while (true)
+			{
+				v.array.emplace_back(ParseValue(text, cursor));
+
+				SkipWhitespace(text, cursor);
+				if (cursor < text.size() && text[cursor] == ',')
+					cursor++;
+				else
+					break;
+			}
+
+			Expect(text, cursor, "]");
+			return v;
+		}
+		else if (c == '"')
+			return JsonValue(ParseString(text, cursor));
+		else if (text.compare(cursor, 4, "true") == 0)
+			return (cursor += 4, JsonValue(true));
+		else if (text.compare(cursor, 5, "false") == 0)
+			return (cursor += 5, JsonValue(false));
+		else if (text.compare(cursor, 4, "null") == 0)
+			return (cursor += 4, JsonValue());
+
+		// Number
+		size_t len = 0;
+		double number = 0.0;
+		try
+		{
+			number = std::stod(text.substr(cursor, 32), &len);
+		}
+		catch (...)
+		{
+			throw ErrorStr("Json error: unexpected character at " + std::to_string(cursor));
+		}
+
+		cursor += len;
+		return JsonValue(number);
+	}
+};
+
+
+inline std::vector<double> ToVector(const JsonValue& array)
+{
+	auto v = std::vector<double>();
+	for (const auto& item : array.get_array())
+		v.emplace_back(item.get_number());
+
+	return v;
+}
+
+
+inline JsonValue ReadJson(const std::string& filename)
+{
+	auto file = std::fstream(filename, std::ios::binary | std::ios_base::in | std::ios::ate);
+	if (file.fail() == true)
+		throw ErrorStr("Error at opening file '" + filename + "'");
+
+	std::string text;
+	text.resize((size_t)file.tellg());
+	file.seekg(0, std::ios::beg);
+
+	file.read(&text[0], (std::streamsize)text.size());
+	if (file.fail() == true)
+		throw ErrorStr("Error at reading file '" + filename + "'");
+
+	return JsonValue::Parse(text);
+}
+
+#endif
@@ -0,0 +1,168 @@
+/*
+
+MIT License
+
+Copyright (c) 2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef PNG_HPP
+#define PNG_HPP
+
+#include <cstdlib>
+#include <string>
+
+#include "misc.hpp"
+#include "thirdparty/lodepng.h"
+
+
+class PngImage
+{
+  private:
+	size_t width;
+	size_t height;
+	size_t channels;
+	void* data;
+
+  public:
+	// clang-format off
+	size_t      get_width() const    { return width; };
+	size_t      get_height() const   { return height; };
+	size_t      get_channels() const { return channels; };
+	const void* get_data() const     { return (const void*)(data); };
+	// clang-format on
+
+	PngImage(const std::string& filename)
+	{
+		unsigned char* blob;
+		size_t blob_size;
+
+		LodePNGState state;
+		unsigned error;
+
+		unsigned png_width;
+		unsigned png_height;
+		unsigned char* png_data;
+
+		// Set
+		lodepng_state_init(&state);
+		state.decoder.color_convert = 0; // Do not convert color
+
+		// Load/decode
+		if ((error = lodepng_load_file(&blob, &blob_size, filename.c_str())) != 0)
+			throw ErrorStr("LodePng error: '" + std::string(lodepng_error_text(error)) + "'");
+
+		if ((error = lodepng_decode(&png_data, &png_width, &png_height, &state, blob, blob_size)) != 0)
+			throw ErrorStr("LodePng error: '" + std::string(lodepng_error_text(error)) + "'");
+
+		// Validate
+		switch (state.info_png.color.colortype)
+		{
+		case LCT_GREY: channels = 1; break;
+		case LCT_GREY_ALPHA: channels = 2; break;
+		case LCT_RGB: channels = 3; break;
+		case LCT_RGBA: channels = 4; break;
+		default: throw ErrorStr("Unsupported channels number (" + std::to_string(state.info_png.color.colortype) + ")");
+		}
+
+		if (state.info_png.color.bitdepth != 8)
+			throw ErrorStr("Unsupported bits per pixel-component (" + std::to_string(state.info_png.color.bitdepth) +
+			               ")");
+
+		// Bye!
+		data = (void*)png_data;
+		width = (size_t)png_width;
+		height = (size_t)png_height;
+
+		lodepng_state_cleanup(&state);
+		free(blob);
+	}
+
+	~PngImage()
+	{
+		free(data);
+	}
+};
+
+
+// Indexed by '10 - effort', effort going from 1 (fastest) to 10
+// clang-format off
+const LodePNGCompressSettings ZLIB_PRESET[10] ={
+	{2, 1, 32768, 3, 256, 1, 0, 0, 0},
+	{2, 1, 8192, 3, 256, 1, 0, 0, 0},
+	{2, 1, 4096, 3, 128, 1, 0, 0, 0},
+	{2, 1, 2048, 3, 128, 1, 0, 0, 0}, // lodepng_default_compress_settings
+	{2, 1, 2048, 3, 92, 1, 0, 0, 0},
+	{2, 1, 1024, 6, 92, 1, 0, 0, 0},
+	{1, 1, 1024, 6, 64, 0, 0, 0, 0},
+	{1, 1, 512, 6, 64, 0, 0, 0, 0},
+	{1, 1, 512, 6, 32, 0, 0, 0, 0},
+	{0, 1, 256, 6, 32, 0, 0, 0, 0}
+};
+
+const LodePNGFilterStrategy PNG_FILTER_PRESET[10] = {
+	LFS_BRUTE_FORCE,
+	LFS_MINSUM,
+	LFS_MINSUM,
+	LFS_MINSUM,
+	LFS_MINSUM,
+	LFS_MINSUM,
+	LFS_MINSUM,
+	LFS_MINSUM,
+	LFS_MINSUM,
+	LFS_ZERO
+};
+// clang-format on
+
+
+inline void* EncodePng(const void* data, size_t channels, size_t width, size_t height, int effort,
+                       size_t* out_size)
+{
+	LodePNGState state;
+	lodepng_state_init(&state);
+
+	state.info_raw.bitdepth = 8;
+
+	switch (channels)
+	{
+	case 1: state.info_raw.colortype = LCT_GREY; break;
+	case 2: state.info_raw.colortype = LCT_GREY_ALPHA; break;
+	case 3: state.info_raw.colortype = LCT_RGB; break;
+	case 4: state.info_raw.colortype = LCT_RGBA; break;
+	default: throw ErrorStr("Unsupported channels number (" + std::to_string(channels) + ")");
+	}
+
+	state.encoder.zlibsettings = ZLIB_PRESET[10 - effort];
+	state.encoder.filter_strategy = PNG_FILTER_PRESET[10 - effort];
+
+	void* blob = NULL;
+	const unsigned error = lodepng_encode((unsigned char**)(&blob), out_size, (const unsigned char*)data,
+	                                      (unsigned)width, (unsigned)height, &state);
+	lodepng_state_cleanup(&state);
+
+	if (error != 0)
+		throw ErrorStr("LodePng error: '" + std::string(lodepng_error_text(error)) + "'");
+
+	return blob;
+}
+
+#endif
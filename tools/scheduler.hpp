@@ -0,0 +1,203 @@
+/*
+
+MIT License
+
+Copyright (c) 2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Workers running jobs of two priority classes. Interactive jobs always go first,
+// batch ones take what capacity remains. Within a class, owners (a connection, a
+// client) take turns, so one with many queued jobs doesn't starve the others.
+//
+// Preemption is cooperative: batch jobs call yield() at tile boundaries (from the
+// 'events' callback, as an example) and if interactive jobs are waiting, these run
+// right there, in the same worker, before the batch job continues. Latency for an
+// interactive job is then at most one tile of a batch job. As an interactive job
+// may run while a batch job is halfway, jobs need state of their own per class.
+
+class Scheduler
+{
+  public:
+	enum class Priority
+	{
+		Interactive = 0,
+		Batch = 1
+	};
+
+	using Job = std::function<void(size_t worker)>;
+
+  private:
+	class Queue
+	{
+		// Round robin between owners, a fifo each
+	  private:
+		std::map<size_t, std::deque<Job>> jobs;
+		std::deque<size_t> turns;
+
+	  public:
+		bool empty() const
+		{
+			return turns.empty();
+		}
+
+		void push(size_t owner, Job job)
+		{
+			auto& owner_jobs = jobs[owner];
+			if (owner_jobs.empty() == true)
+				turns.push_back(owner);
+
+			owner_jobs.push_back(std::move(job));
+		}
+
+		Job pop()
+		{
+			const size_t owner = turns.front();
+			turns.pop_front();
+
+			auto& owner_jobs = jobs[owner];
+			Job job = std::move(owner_jobs.front());
+			owner_jobs.pop_front();
+
+			if (owner_jobs.empty() == false)
+				turns.push_back(owner);
+			else
+				jobs.erase(owner);
+
+			return job;
+		}
+	};
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	Queue queues[2];
+	bool stop = false;
+
+	std::atomic<size_t> interactive_waiting;
+	std::atomic<size_t> preempted;
+	std::vector<std::thread> workers;
+
+	void work(size_t worker)
+	{
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [&]() {
+					return stop == true || queues[0].empty() == false || queues[1].empty() == false;
+				});
+
+				if (queues[0].empty() == false)
+				{
+					job = queues[0].pop();
+					interactive_waiting--;
+				}
+				else if (queues[1].empty() == false)
+					job = queues[1].pop();
+				else
+					return; // Stopping, and nothing left
+			}
+
+			job(worker);
+		}
+	}
+
+  public:
+	Scheduler(size_t workers_no) : interactive_waiting(0), preempted(0)
+	{
+		for (size_t w = 0; w < workers_no; w++)
+			workers.emplace_back(&Scheduler::work, this, w);
+	}
+
+	~Scheduler()
+	{
+		// Queued jobs still run
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+
+		condition.notify_all();
+
+		for (auto& w : workers)
+			w.join();
+	}
+
+	void submit(Priority priority, size_t owner, Job job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queues[(int)priority].push(owner, std::move(job));
+
+			if (priority == Priority::Interactive)
+				interactive_waiting++;
+		}
+
+		condition.notify_one();
+	}
+
+	void yield(size_t worker)
+	{
+		// Only batch jobs should call it, cheap when there is nothing to do
+		while (interactive_waiting.load(std::memory_order_relaxed) != 0)
+		{
+			Job job;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (queues[0].empty() == true)
+					return;
+
+				job = queues[0].pop();
+				interactive_waiting--;
+			}
+
+			preempted++;
+			job(worker);
+		}
+	}
+
+	size_t workers_no() const
+	{
+		return workers.size();
+	}
+
+	size_t preemptions() const
+	{
+		return preempted.load();
+	}
+};
+
+#endif
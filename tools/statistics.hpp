@@ -0,0 +1,159 @@
+/*
+
+MIT License
+
+Copyright (c) 2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+inline double Median(std::vector<double> samples)
+{
+	if (samples.size() == 0)
+		return 0.0;
+
+	std::sort(samples.begin(), samples.end());
+	const size_t half = samples.size() / 2;
+
+	return (samples.size() % 2 != 0) ? samples[half] : (samples[half - 1] + samples[half]) / 2.0;
+}
+
+
+inline double Percentile(std::vector<double> samples, double p)
+{
+	// Nearest rank
+	if (samples.size() == 0)
+		return 0.0;
+
+	std::sort(samples.begin(), samples.end());
+	const double rank = std::ceil((p / 100.0) * (double)samples.size());
+
+	return samples[(size_t)std::max(1.0, std::min(rank, (double)samples.size())) - 1];
+}
+
+
+inline double MannWhitneyP(const std::vector<double>& a, const std::vector<double>& b)
+{
+	// Two-sided p-value, using the normal approximation with tie correction.
+	// (with less than ~8 samples per side, take the result with a grain of salt)
+
+	const double n1 = (double)a.size();
+	const double n2 = (double)b.size();
+	const double n = n1 + n2;
+
+	if (a.size() == 0 || b.size() == 0)
+		return 1.0;
+
+	// Rank both samples together
+	struct Item
+	{
+		double value;
+		bool from_a;
+	};
+
+	std::vector<Item> all;
+	for (const auto v : a)
+		all.push_back({v, true});
+	for (const auto v : b)
+		all.push_back({v, false});
+
+	std::sort(all.begin(), all.end(), [](const Item& x, const Item& y) { return (x.value < y.value); });
+
+	double rank_sum_a = 0.0;
+	double ties = 0.0;
+
+	for (size_t i = 0; i < all.size();)
+	{
+		size_t j = i;
+		while (j < all.size() && all[j].value == all[i].value)
+			j++;
+
+		const double t = (double)(j - i);
+		const double average_rank = ((double)i + (double)j + 1.0) / 2.0; // Ranks start at one
+		ties += (t * t * t - t);
+
+		for (size_t k = i; k < j; k++)
+			if (all[k].from_a == true)
+				rank_sum_a += average_rank;
+
+		i = j;
+	}
+
+	// U statistic and its normal approximation
+	const double u = rank_sum_a - (n1 * (n1 + 1.0)) / 2.0;
+	const double mean = (n1 * n2) / 2.0;
+	const double variance = ((n1 * n2) / 12.0) * ((n + 1.0) - ties / (n * (n - 1.0)));
+
+	if (variance <= 0.0)
+		return 1.0;
+
+	const double z = std::max(0.0, std::fabs(u - mean) - 0.5) / std::sqrt(variance); // With continuity correction
+	return std::erfc(z / std::sqrt(2.0));
+}
+
+
+inline void BootstrapRatioOfMedians(const std::vector<double>& a, const std::vector<double>& b, double confidence,
+                                    double& out_low, double& out_high, size_t resamples = 2000)
+{
+	// Confidence interval of median(b) / median(a), by percentile bootstrap.
+	// Fixed seed, so comparing the same files always prints the same
+
+	std::mt19937 generator(1);
+	std::vector<double> ratios;
+	std::vector<double> resample_a(a.size());
+	std::vector<double> resample_b(b.size());
+
+	out_low = 0.0;
+	out_high = 0.0;
+
+	if (a.size() == 0 || b.size() == 0)
+		return;
+
+	std::uniform_int_distribution<size_t> pick_a(0, a.size() - 1);
+	std::uniform_int_distribution<size_t> pick_b(0, b.size() - 1);
+
+	for (size_t r = 0; r < resamples; r++)
+	{
+		for (auto& v : resample_a)
+			v = a[pick_a(generator)];
+		for (auto& v : resample_b)
+			v = b[pick_b(generator)];
+
+		const double median_a = Median(resample_a);
+		if (median_a > 0.0)
+			ratios.push_back(Median(resample_b) / median_a);
+	}
+
+	const double tail = (1.0 - confidence) / 2.0 * 100.0;
+	out_low = Percentile(ratios, tail);
+	out_high = Percentile(ratios, 100.0 - tail);
+}
+
+#endif